@@ -34,6 +34,7 @@
 #include <QPainter>
 #include <QFile>
 #include "color.h"
+#include "lpub.h"
 
 void BackgroundItem::setBackground(
   QPixmap                 *pixmap,
@@ -59,7 +60,8 @@ void BackgroundItem::setBackground(
 
   int bt = int(borderData.thickness);
 
-  QColor penColor,brushColor;  
+  QColor penColor;
+  QBrush brush;
   QRectF prect(bt/2,bt/2,pixmap->width()-bt,pixmap->height()-bt); // was -1-bt
 
   pixmap->setAlphaChannel(*pixmap);
@@ -94,19 +96,25 @@ void BackgroundItem::setBackground(
           }
         }
       }
-      brushColor = Qt::transparent;
+      brush = Qt::transparent;
     }
     break;
     case BackgroundData::BgTransparent:
-      brushColor = Qt::transparent;
+      brush = Qt::transparent;
     break;
     case BackgroundData::BgColor:
     case BackgroundData::BgSubmodelColor:
-      if (backgroundData.type == BackgroundData::BgColor) {
-        brushColor = LDrawColor::color(backgroundData.string);
+    {
+      QString color = backgroundData.type == BackgroundData::BgColor ?
+                        backgroundData.string : _subModel.value(submodelLevel);
+      int     code;
+
+      if (LDrawColor::code(color,code)) {
+        brush = LDrawColor::brush(code);
       } else {
-        brushColor = LDrawColor::color(_subModel.value(submodelLevel));
+        brush = LDrawColor::color(color);
       }
+    }
     break;
   }
 
@@ -138,7 +146,7 @@ void BackgroundItem::setBackground(
   pen.setCapStyle(Qt::RoundCap);
   pen.setJoinStyle(Qt::RoundJoin);
   painter.setPen(pen);
-  painter.setBrush(brushColor);
+  painter.setBrush(brush);
   painter.setRenderHints(QPainter::HighQualityAntialiasing,true);
   painter.setRenderHints(QPainter::Antialiasing,true);
 
@@ -190,6 +198,7 @@ void PlacementBackgroundItem::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
   QGraphicsItem::mouseMoveEvent(event);
   if (isSelected() && (flags() & QGraphicsItem::ItemIsMovable)) {
     positionChanged = true;
+    gui->page.graph.dragged(this);
   }
 }
 
@@ -0,0 +1,374 @@
+
+/****************************************************************************
+**
+** Copyright (C) 2007-2009 Kevin Clague. All rights reserved.
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.trolltech.com/products/qt/opensource.html
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+/****************************************************************************
+ *
+ * This file implements exporting from the command line.
+ *
+ * Please see lpub.h for an overall description of how the files in LPub
+ * make up the LPub program.
+ *
+ ***************************************************************************/
+
+#include <QFileInfo>
+#include <QDir>
+#include <QThread>
+#include <QThreadPool>
+#include <QProcess>
+#include <QCoreApplication>
+#include <stdio.h>
+
+#include "batch.h"
+#include "lpub.h"
+#include "name.h"
+#include "lmessagebox.h"
+#include "renderspool.h"
+#include "plilibrary.h"
+
+bool batchRequested(const QStringList &arguments)
+{
+  return arguments.contains("--export")  ||
+         arguments.contains("--prewarm") ||
+         arguments.contains("--render-worker");
+}
+
+bool parsePages(
+  const QString &spec,
+  int            maxPages,
+  QList<int>    &pages)
+{
+  pages.clear();
+
+  if (spec == "") {
+    for (int i = 1; i <= maxPages; i++) {
+      pages << i;
+    }
+    return maxPages > 0;
+  }
+
+  QStringList ranges = spec.split(",",QString::SkipEmptyParts);
+  QRegExp     rx("^(\\d+)(-(\\d*))?$");
+
+  foreach (QString range, ranges) {
+    if ( ! rx.exactMatch(range.trimmed())) {
+      return false;
+    }
+    int first = rx.cap(1).toInt();
+    int last  = first;
+    if (rx.cap(2) != "") {
+      last = rx.cap(3) == "" ? maxPages : rx.cap(3).toInt();
+    }
+    if (first < 1 || last > maxPages || first > last) {
+      return false;
+    }
+    for (int i = first; i <= last; i++) {
+      pages << i;
+    }
+  }
+  return pages.size() > 0;
+}
+
+static int usage(const QString &problem)
+{
+  fprintf(stderr,"%s: %s\n"
+                 "usage: lpub --export (pdf|png|jpg|bmp) [--pages <pages>] "
+                 "[--jobs <n>] [--spool <dir>] [--output <name>] <model>\n"
+                 "       lpub --prewarm <parts> [--colors <codes>] <model>\n"
+                 "       lpub --render-worker <dir> [--idle <seconds>]\n",
+                 LPUB,qPrintable(problem));
+  return 2;
+}
+
+/*
+ * Render workers run on this machine for an export, on a spool of their
+ * own.  The workers are stopped and the spool removed when this goes out
+ * of scope.
+ */
+
+class LocalWorkers {
+  public:
+    LocalWorkers() {}
+
+    void start(const QString &_spool, int count)
+    {
+      spool = _spool;
+
+      QStringList arguments;
+      arguments << "--render-worker" << spool;
+
+      for (int i = 0; i < count; i++) {
+        QProcess *worker = new QProcess;
+        worker->setProcessChannelMode(QProcess::ForwardedChannels);
+        worker->start(QCoreApplication::applicationFilePath(),arguments);
+        workers << worker;
+      }
+    }
+
+    ~LocalWorkers()
+    {
+      if (spool == "") {
+        return;
+      }
+      foreach (QProcess *worker, workers) {
+        worker->kill();
+        worker->waitForFinished();
+        delete worker;
+      }
+
+      QStringList dirs;
+      dirs << "queue" << "claimed" << "done" << "failed" << "tmp";
+
+      foreach (QString dirName, dirs) {
+        QDir dir(spool + "/" + dirName);
+        foreach (QString file, dir.entryList(QDir::Files)) {
+          dir.remove(file);
+        }
+        QDir().rmdir(dir.path());
+      }
+      QDir().rmdir(spool);
+    }
+
+  private:
+    QString           spool;
+    QList<QProcess *> workers;
+};
+
+/*
+ * Load the model, and write out the pages asked for.  The return value
+ * is the program's exit status.
+ */
+
+int Gui::batchExport(const QStringList &arguments)
+{
+  QString format;
+  QString pageSpec;
+  QString output;
+  QString spool;
+  QString fileName;
+  int     jobs = qMax(1,QThread::idealThreadCount());
+
+  for (int i = 1; i < arguments.size(); i++) {
+    QString arg = arguments[i];
+
+    if (arg == "--export" || arg == "--pages" ||
+        arg == "--jobs"   || arg == "--output" || arg == "--spool") {
+      if (i + 1 == arguments.size()) {
+        return usage(QString("%1 needs a value") .arg(arg));
+      }
+      QString value = arguments[++i];
+      if (arg == "--export") {
+        format = value.toLower();
+      } else if (arg == "--pages") {
+        pageSpec = value;
+      } else if (arg == "--jobs") {
+        bool ok;
+        jobs = value.toInt(&ok);
+        if ( ! ok || jobs < 1) {
+          return usage(QString("bad number of jobs \"%1\"") .arg(value));
+        }
+      } else if (arg == "--spool") {
+        spool = value;
+      } else {
+        output = value;
+      }
+    } else if (arg.startsWith("-")) {
+      return usage(QString("unknown option \"%1\"") .arg(arg));
+    } else if (fileName == "") {
+      fileName = arg;
+    } else {
+      return usage("only one model can be exported at a time");
+    }
+  }
+
+  if (format != "pdf" && format != "png" && format != "jpg" && format != "bmp") {
+    return usage(QString("cannot export to \"%1\"") .arg(format));
+  }
+  if (fileName == "") {
+    return usage("no model given");
+  }
+
+  QThreadPool::globalInstance()->setMaxThreadCount(jobs);
+
+  QFileInfo info(fileName);
+  if ( ! info.exists()) {
+    LMessageBox::critical(NULL,tr(LPUB),
+                          tr("Cannot find %1") .arg(fileName));
+    return 1;
+  }
+
+  // with no spool to share, run as many renders at once as jobs says,
+  // in workers of our own
+
+  LocalWorkers localWorkers;
+
+  if (spool == "" && jobs > 1) {
+    spool = QString("%1/lpub-spool-%2")
+              .arg(QDir::tempPath())
+              .arg(QCoreApplication::applicationPid());
+    localWorkers.start(spool,jobs);
+  }
+  RenderSpool::setPath(spool);
+
+  // output is relative to where we were started, not the model
+
+  if (output != "") {
+    output = QFileInfo(output).absoluteFilePath();
+  } else if (format == "pdf") {
+    output = info.absolutePath() + "/" + info.completeBaseName() + ".pdf";
+  } else {
+    output = info.absolutePath();
+  }
+
+  QString modelName = info.absoluteFilePath();
+  openFile(modelName);
+  displayPage();
+
+  QList<int> pages;
+  if ( ! parsePages(pageSpec,maxPages,pages)) {
+    return usage(QString("bad pages \"%1\", the model has %2")
+                   .arg(pageSpec) .arg(maxPages));
+  }
+
+  // queue every render first so the render workers can all get going,
+  // then lay the pages out again with the images they made
+
+  if (RenderSpool::enabled()) {
+    RenderSpool::setDeferred(true);
+    for (int i = 0; i < pages.size(); i++) {
+      displayPageNum = pages[i];
+      displayPage();
+    }
+    RenderSpool::setDeferred(false);
+  }
+
+  bool ok;
+  if (format == "pdf") {
+    ok = printToFile(output,pages);
+  } else {
+    QDir().mkpath(output);
+    ok = exportAs(output,"." + format,pages);
+  }
+
+  return ok && LMessageBox::errors() == 0 ? 0 : 1;
+}
+
+/*
+ * Load the model for its parts list settings, and render the parts the
+ * parts file uses into the parts list library.  The return value is the
+ * program's exit status.
+ */
+
+int Gui::batchPrewarm(const QStringList &arguments)
+{
+  QString partsName;
+  QString colorList;
+  QString fileName;
+
+  for (int i = 1; i < arguments.size(); i++) {
+    QString arg = arguments[i];
+
+    if (arg == "--prewarm" || arg == "--colors") {
+      if (i + 1 == arguments.size()) {
+        return usage(QString("%1 needs a value") .arg(arg));
+      }
+      QString value = arguments[++i];
+      if (arg == "--prewarm") {
+        partsName = value;
+      } else {
+        colorList = value;
+      }
+    } else if (arg.startsWith("-")) {
+      return usage(QString("unknown option \"%1\"") .arg(arg));
+    } else if (fileName == "") {
+      fileName = arg;
+    } else {
+      return usage("only one model can be given");
+    }
+  }
+
+  if (fileName == "") {
+    return usage("no model given");
+  }
+  if ( ! PliLibrary::enabled()) {
+    LMessageBox::critical(NULL,tr(LPUB),
+                          tr("There is no parts list image library.\n"
+                             "Please set one up in Preferences."));
+    return 1;
+  }
+
+  // the parts file is relative to where we were started, not the model
+
+  partsName = QFileInfo(partsName).absoluteFilePath();
+
+  QFileInfo info(fileName);
+  if ( ! info.exists()) {
+    LMessageBox::critical(NULL,tr(LPUB),
+                          tr("Cannot find %1") .arg(fileName));
+    return 1;
+  }
+
+  QString modelName = info.absoluteFilePath();
+  openFile(modelName);
+
+  QStringList colors = colorList.split(",",QString::SkipEmptyParts);
+  for (int i = 0; i < colors.size(); i++) {
+    colors[i] = colors[i].trimmed();
+  }
+
+  int rendered = prewarmParts(partsName,colors,NULL);
+  if (rendered < 0) {
+    return 1;
+  }
+
+  fprintf(stdout,"%s: %d parts list images are in the library\n",LPUB,rendered);
+  return LMessageBox::errors() == 0 ? 0 : 1;
+}
+
+/*
+ * Render jobs from a spool until killed, or until idle for as long as
+ * --idle says.
+ */
+
+int renderWorker(const QStringList &arguments)
+{
+  QString spool;
+  int     idle = 0;
+
+  for (int i = 1; i < arguments.size(); i++) {
+    QString arg = arguments[i];
+
+    if (arg == "--render-worker" || arg == "--idle") {
+      if (i + 1 == arguments.size()) {
+        return usage(QString("%1 needs a value") .arg(arg));
+      }
+      QString value = arguments[++i];
+      if (arg == "--render-worker") {
+        spool = value;
+      } else {
+        bool ok;
+        idle = value.toInt(&ok);
+        if ( ! ok || idle < 0) {
+          return usage(QString("bad idle time \"%1\"") .arg(value));
+        }
+      }
+    } else {
+      return usage(QString("unknown option \"%1\"") .arg(arg));
+    }
+  }
+
+  return RenderSpool::work(spool,idle);
+}
@@ -0,0 +1,87 @@
+
+/****************************************************************************
+**
+** Copyright (C) 2007-2009 Kevin Clague. All rights reserved.
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.trolltech.com/products/qt/opensource.html
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+/****************************************************************************
+ *
+ * LPub can run from the command line without showing its window, for
+ * making instructions unattended:
+ *
+ *   lpub --export (pdf|png|jpg|bmp) [--pages <pages>] [--jobs <n>]
+ *        [--spool <directory>] [--output <file or directory>] model.mpd
+ *
+ * Pages are given like 1-20,25,30- and default to all of them.  Jobs is
+ * how many threads LPub may use for its own work (such as rotating
+ * parts); it defaults to one per processor.  Without --spool, it is also
+ * how many renders are run at once, by render workers LPub starts on a
+ * spool of its own.  PDFs go to model.pdf and images go next to the
+ * model unless --output says otherwise.
+ *
+ * With --spool, renders are handed to render workers through a spool
+ * directory (see renderspool.h):
+ *
+ *   lpub --render-worker <spool directory> [--idle <seconds>]
+ *
+ * A worker renders until it has had nothing to do for the idle time, or
+ * forever if no idle time is given.
+ *
+ * Parts list images can be rendered into the shared parts list library
+ * (see plilibrary.h) ahead of time:
+ *
+ *   lpub --prewarm <parts file> [--colors <codes>] model.mpd
+ *
+ * The parts are the ones the parts file uses, in the colors it uses
+ * them in, or in each of the colors given like 4,14,71.  The model's
+ * parts list settings are used, since the library files images under
+ * them.
+ *
+ * No dialogs are shown.  Problems are reported on stderr, and the exit
+ * status is non-zero if anything went wrong.
+ *
+ * Please see lpub.h for an overall description of how the files in LPub
+ * make up the LPub program.
+ *
+ ***************************************************************************/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <QStringList>
+#include <QList>
+
+/*
+ * True when the command line asks for LPub to run headless.
+ */
+
+bool batchRequested(const QStringList &arguments);
+
+/*
+ * Turn a page list like 1-20,25,30- into page numbers.
+ */
+
+bool parsePages(
+  const QString &spec,
+  int            maxPages,
+  QList<int>    &pages);
+
+/*
+ * Run as a render worker.  The return value is the program's exit
+ * status.
+ */
+
+int renderWorker(const QStringList &arguments);
+
+#endif
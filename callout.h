@@ -34,6 +34,7 @@
 #include "placement.h"
 #include "where.h"
 #include "numberitem.h"
+#include "pagearena.h"
 
 #include <QGraphicsItem>
 #include <QGraphicsRectItem>
@@ -54,6 +55,8 @@ class QGraphicsView;
 
 class Callout : public Steps {
   public:
+    PAGE_ARENA_ALLOCATED
+
     Step                  *parentStep;
     PlacementType          parentRelativeType;
     QGraphicsView         *view;
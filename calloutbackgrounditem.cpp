@@ -221,6 +221,7 @@ void CalloutBackgroundItem::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
     if (delta.x() || delta.y()) {
       callout->drawTips(delta);
       positionChanged = true;
+      gui->page.graph.dragged(this);
     }
   }
 }
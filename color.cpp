@@ -18,52 +18,212 @@
 #include "color.h"
 
 #include <QMessageBox>
-#include <QFile>
+#include <QStringList>
 #include <QTextStream>
-#include <QRegExp>
 #include "lpub_preferences.h"
+#include "lmessagebox.h"
+#include "ldrawzip.h"
 
-QHash<QString, QColor>  LDrawColor::name2color;
-QHash<QString, QString> LDrawColor::color2name;
+QVector<LDrawColorEntry> LDrawColor::entries;
+QHash<QString, int>      LDrawColor::name2code;
+QHash<QString, QString>  LDrawColor::color2name;
+
+/*
+ * Codes beyond this are not kept in the table.
+ */
+
+#define MAX_CODE 0x10000
+
+/*
+ * The short names used to annotate parts in the parts list, for the
+ * original LDraw colors and their transparent versions.
+ */
+
+static const struct {
+  int         code;
+  const char *abbreviation;
+} abbreviations[] = {
+  {  1, "B"   }, {  2, "G"   }, {  3, "DC"  }, {  4, "R"   },
+  {  5, "M"   }, {  6, "Br"  }, {  9, "LB"  }, { 10, "LG"  },
+  { 11, "C"   }, { 12, "LR"  }, { 13, "P"   }, { 14, "Y"   },
+  { 22, "Ppl" }, { 25, "O"   },
+
+  { 32+1,  "TB"   }, { 32+2,  "TG"   }, { 32+3,  "TDC"  }, { 32+4,  "TR"  },
+  { 32+5,  "TM"   }, { 32+6,  "TBr"  }, { 32+9,  "TLB"  }, { 32+10, "TLG" },
+  { 32+11, "TC"   }, { 32+12, "TLR"  }, { 32+13, "TP"   }, { 32+14, "TY"  },
+  { 32+22, "TPpl" }, { 32+25, "TO"   },
+};
+
+/*
+ * #RRGGBB and 0xRRGGBB
+ */
+
+static bool hexColor(const QString &value, QColor &color)
+{
+  QString hex = value.trimmed();
+
+  if (hex.startsWith("#")) {
+    hex.remove(0,1);
+  } else if (hex.startsWith("0x",Qt::CaseInsensitive)) {
+    hex.remove(0,2);
+  } else {
+    return false;
+  }
+
+  bool ok;
+  uint rgb = hex.toUInt(&ok,16);
+  if ( ! ok || hex.isEmpty()) {
+    return false;
+  }
+  color = QColor(QRgb(rgb & 0xffffff));
+  color.setAlpha(0xff);
+  return true;
+}
+
+static inline bool isDirect(int code)
+{
+  return code >= 0x2000000 && code < 0x4000000;
+}
 
 /*
  * This constructor reads in the LDraw ldconfig.ldr file and extracts
  * the color codes, color names, and color values and puts them in
- * the xlate (name to color translate) hash table.
+ * the table of color entries.
  */
 LDrawColor::LDrawColor ()
 {
-  name2color.clear();
+  entries.clear();
+  name2code.clear();
   color2name.clear();
+
+  for (unsigned a = 0; a < sizeof(abbreviations)/sizeof(abbreviations[0]); a++) {
+    if (abbreviations[a].code >= entries.size()) {
+      entries.resize(abbreviations[a].code + 1);
+    }
+    entries[abbreviations[a].code].abbreviation = abbreviations[a].abbreviation;
+  }
+
   QString fileName(Preferences::ldrawPath + "/ldconfig.ldr");
-  QFile file(fileName);
-  if (! file.open(QFile::ReadOnly | QFile::Text)) {
-    QMessageBox::warning(NULL,QMessageBox::tr("LDrawColor"),
-                              QMessageBox::tr("Cannot read file %1\n%2.")
-                                          .arg(fileName)
-                                          .arg(file.errorString()));
+  QByteArray contents;
+  if (! LDrawZip::read(fileName,contents)) {
+    LMessageBox::warning(NULL,QMessageBox::tr("LDrawColor"),
+                              QMessageBox::tr("Cannot read file %1.")
+                                          .arg(fileName));
     return;
   }
-  QRegExp rx("^\\s*0\\s+!COLOUR\\s+(\\w+)\\s+"
-             "CODE\\s+(\\d+)\\s+VALUE\\s+#([\\da-fA-F]+)");
-  QTextStream in(&file);
+
+  /*
+   * 0 !COLOUR name CODE n VALUE #RRGGBB EDGE #RRGGBB|n [ALPHA a] [finish]
+   *
+   * Edges can be given as another code, which may come later in the
+   * file, so those are filled in at the end.
+   */
+
+  QHash<int, int> edgeCodes;
+  QTextStream in(contents);
   while ( ! in.atEnd()) {
-    QString line = in.readLine(0);
-    if (line.contains(rx)) {
-      bool ok;
-      QRgb hex = rx.cap(3).toLong(&ok,16);
-      QColor color(hex);
-      color.setAlpha(0xff);
-      QString name = rx.cap(1).toLower();
-      name2color.insert(name,color);
-      name = rx.cap(2).toLower();
-      name2color.insert(name,color);
-      name = rx.cap(1);
-      QString code = rx.cap(2);          
-      color2name.insert(code,name);
-      color2name.insert(color.name(),name);
+    QString line = in.readLine(0).simplified();
+    if ( ! line.startsWith("0 !COLOUR ")) {
+      continue;
+    }
+    QStringList tokens = line.split(' ');
+    if (tokens.size() < 7 || tokens[3] != "CODE" || tokens[5] != "VALUE") {
+      continue;
+    }
+    bool ok;
+    int code = tokens[4].toInt(&ok);
+    QColor color;
+    if ( ! ok || code < 0 || code >= MAX_CODE || ! hexColor(tokens[6],color)) {
+      continue;
+    }
+    if (code >= entries.size()) {
+      entries.resize(code + 1);
+    }
+
+    LDrawColorEntry &entry = entries[code];
+    entry.defined = true;
+    entry.name    = tokens[2];
+    entry.color   = color;
+    entry.edge    = Qt::black;
+    entry.alpha   = 0xff;
+    entry.finish  = 0;
+
+    for (int t = 7; t < tokens.size(); t++) {
+      const QString &token = tokens[t];
+      if (token == "EDGE" && t + 1 < tokens.size()) {
+        QColor edge;
+        if (hexColor(tokens[++t],edge)) {
+          entry.edge = edge;
+        } else {
+          int edgeCode = tokens[t].toInt(&ok);
+          if (ok) {
+            edgeCodes.insert(code,edgeCode);
+          }
+        }
+      } else if (token == "ALPHA" && t + 1 < tokens.size()) {
+        entry.alpha   = tokens[++t].toInt();
+        entry.finish |= LDrawColorEntry::Transparent;
+      } else if (token == "LUMINANCE") {
+        entry.finish |= LDrawColorEntry::Luminous;
+      } else if (token == "CHROME") {
+        entry.finish |= LDrawColorEntry::Chrome;
+      } else if (token == "PEARLESCENT") {
+        entry.finish |= LDrawColorEntry::Pearlescent;
+      } else if (token == "METAL") {
+        entry.finish |= LDrawColorEntry::Metal;
+      } else if (token == "MATERIAL") {
+        entry.finish |= LDrawColorEntry::Material;
+      } else if (token == "RUBBER") {
+        entry.finish |= LDrawColorEntry::Rubber;
+      }
     }
+
+    entry.brush = QBrush(color);
+
+    name2code.insert(entry.name.toLower(),code);
+    color2name.insert(color.name(),entry.name);
+  }
+
+  QHash<int, int>::const_iterator i;
+  for (i = edgeCodes.constBegin(); i != edgeCodes.constEnd(); ++i) {
+    entries[i.key()].edge = color(i.value());
+  }
+}
+
+/*
+ * This function provides the color table entry for an LDraw color code,
+ * or NULL if ldconfig.ldr does not define it.
+ */
+const LDrawColorEntry *LDrawColor::entry(int code)
+{
+  if (code >= 0 && code < entries.size() && entries[code].defined) {
+    return &entries[code];
   }
+  return NULL;
+}
+
+/*
+ * This function turns an LDraw color code, or a name from ldconfig.ldr,
+ * into a color code.
+ */
+bool LDrawColor::code(const QString &nickname, int &code)
+{
+  bool ok;
+  code = nickname.toInt(&ok);
+  if (ok) {
+    return true;
+  }
+  QString trimmed = nickname.trimmed();
+  if (trimmed.startsWith("0x",Qt::CaseInsensitive)) {
+    code = trimmed.mid(2).toInt(&ok,16);
+    return ok && isDirect(code);
+  }
+  QHash<QString, int>::const_iterator i = name2code.constFind(trimmed.toLower());
+  if (i != name2code.constEnd()) {
+    code = i.value();
+    return true;
+  }
+  return false;
 }
 
 /*
@@ -72,22 +232,39 @@ LDrawColor::LDrawColor ()
  */
 QColor LDrawColor::color(QString nickname)
 {
-  QString lower(nickname.toLower());
-  if (name2color.contains(lower)) {
-    return name2color[lower];
-  } else {
-    QRegExp rx("\\s*(0x|#)([\\da-fA-F]+)\\s*$");
-    if (nickname.contains(rx)) {
-      QString prefix("0xf"+rx.cap(2));
-      bool ok;
-      QRgb rgb = prefix.toLong(&ok,16);
-      QColor color(rgb);
-      color.setAlpha(0xff);
-      return color;
-    } else {
-      return Qt::black;
-    }
+  int c;
+  if (code(nickname,c) && (entry(c) || isDirect(c))) {
+    return color(c);
+  }
+  QColor value;
+  if (hexColor(nickname,value)) {
+    return value;
   }
+  return Qt::black;
+}
+
+QColor LDrawColor::color(int code)
+{
+  if (isDirect(code)) {
+    QColor value(QRgb(code & 0xffffff));
+    value.setAlpha(0xff);
+    return value;
+  }
+  const LDrawColorEntry *e = entry(code);
+  return e ? e->color : QColor(Qt::black);
+}
+
+/*
+ * This function provides the brush used to paint backgrounds in a color.
+ * Like color(), it is opaque, even for transparent colors.
+ */
+QBrush LDrawColor::brush(int code)
+{
+  if (isDirect(code)) {
+    return QBrush(color(code));
+  }
+  const LDrawColorEntry *e = entry(code);
+  return e ? e->brush : QBrush(Qt::black);
 }
 
 /*
@@ -97,9 +274,61 @@ QColor LDrawColor::color(QString nickname)
  */
 QString LDrawColor::name(QString code)
 {
-  if (color2name.contains(code)) {
-    return color2name[code];
-  } else {
-    return "";
+  bool ok;
+  int c = code.toInt(&ok);
+  if (ok) {
+    const LDrawColorEntry *e = entry(c);
+    return e ? e->name : "";
+  }
+  return color2name.value(code,"");
+}
+
+/*
+ * These functions provide the color used for the edge lines of
+ * parts in the given color.  ldconfig.ldr gives edges either as
+ * a hexadecimal value, or as another color code.
+ */
+QColor LDrawColor::edge(QString code)
+{
+  int c;
+  if (LDrawColor::code(code,c)) {
+    return edge(c);
+  }
+  return Qt::black;
+}
+
+QColor LDrawColor::edge(int code)
+{
+  const LDrawColorEntry *e = entry(code);
+  return e ? e->edge : QColor(Qt::black);
+}
+
+/*
+ * These functions tell if a color is a plain opaque color, and not
+ * transparent, chrome, metallic, pearlescent, glowing or speckled.
+ * Colors that are not in ldconfig.ldr are not plain.
+ */
+bool LDrawColor::isPlain(QString code)
+{
+  bool ok;
+  int c = code.toInt(&ok);
+  return ok && isPlain(c);
+}
+
+bool LDrawColor::isPlain(int code)
+{
+  const LDrawColorEntry *e = entry(code);
+  return e && e->isPlain();
+}
+
+/*
+ * This function provides the short name for a color used to annotate
+ * parts in the parts list.
+ */
+QString LDrawColor::abbreviation(int code)
+{
+  if (code >= 0 && code < entries.size()) {
+    return entries[code].abbreviation;
   }
+  return "";
 }
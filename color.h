@@ -21,6 +21,55 @@
 #include <QHash>
 #include <QString>
 #include <QColor>
+#include <QBrush>
+#include <QVector>
+
+/*
+ * Everything LPub knows about one LDraw color code, worked out once when
+ * ldconfig.ldr is read.
+ */
+
+class LDrawColorEntry {
+  public:
+    enum Finish {
+      Transparent = 1,
+      Chrome      = 2,
+      Pearlescent = 4,
+      Metal       = 8,
+      Material    = 16,
+      Luminous    = 32,
+      Rubber      = 64
+    };
+
+    bool    defined;
+    QString name;
+    QColor  color;          // opaque
+    QColor  edge;
+    int     alpha;
+    int     finish;
+    QBrush  brush;          // color, for painting backgrounds
+    QString abbreviation;   // for PLI annotations
+
+    LDrawColorEntry()
+    {
+      defined = false;
+      color   = Qt::black;
+      edge    = Qt::black;
+      alpha   = 0xff;
+      finish  = 0;
+      brush   = QBrush(Qt::black);
+    }
+
+    /*
+     * Plain colors are opaque, and not chrome, metallic, pearlescent,
+     * glowing or speckled.
+     */
+
+    bool isPlain() const
+    {
+      return defined && (finish & ~Rubber) == 0;
+    }
+};
 
 /*
  * This class encapsulates LDraw color codes, color names and Qt's Qcolor
@@ -32,31 +81,69 @@
  *
  * We also need a color dialog that is tailored to LDraw names first, and then
  * arbitrary colors second.
+ *
+ * Color codes index a table directly, so looking one up costs nothing.
+ * Direct colors (0x2RRGGBB, and 0x3RRGGBB for transparent ones) are not
+ * in the table, and are worked out from the code itself.
  */
 
 class LDrawColor {
   private:
-    static QHash<QString, QColor>  name2color;
-    static QHash<QString, QString> color2name;
+    static QVector<LDrawColorEntry> entries;     // by code
+    static QHash<QString, int>      name2code;   // lower case name
+    static QHash<QString, QString>  color2name;  // QColor::name()
   public:
 
     /*
      * This constructor reads in the LDraw ldconfig.ldr file and extracts
      * the color codes, color names, and color values and puts them in
-     * the xlate (name to color translate) hash table.
+     * the table of color entries.
      */
     LDrawColor ();
     /*
-     * This function provides the translate from LDraw color names and codes
+     * This function provides the color table entry for an LDraw color code,
+     * or NULL if ldconfig.ldr does not define it.
+     */
+    static const LDrawColorEntry *entry(int code);
+    /*
+     * This function turns an LDraw color code, or a name from ldconfig.ldr,
+     * into a color code.
+     */
+    static bool code(const QString &nickname, int &code);
+    /*
+     * These functions provide the translate from LDraw color names and codes
      * to QColor.
      */
     static QColor color(QString nickname);
+    static QColor color(int code);
+    /*
+     * This function provides the brush used to paint backgrounds in a
+     * color.  Like color(), it is opaque.
+     */
+    static QBrush brush(int code);
     /*
      * This function provides the translate from QColor back to LDraw color
      * names.  If there is no translation the hexadecimal value for the
      * color is returned as a string.
      */
     static QString name(QString code);
+    /*
+     * These functions provide the color used for the edge lines of
+     * parts in the given color.
+     */
+    static QColor edge(QString code);
+    static QColor edge(int code);
+    /*
+     * These functions tell if a color is a plain opaque color, and not
+     * transparent, chrome, metallic, pearlescent, glowing or speckled.
+     */
+    static bool isPlain(QString code);
+    static bool isPlain(int code);
+    /*
+     * This function provides the short name for a color used to annotate
+     * parts in the parts list.
+     */
+    static QString abbreviation(int code);
 };
 
 #endif
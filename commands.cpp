@@ -34,14 +34,13 @@ InsertLineCommand::InsertLineCommand(
 void InsertLineCommand::undo()
 {
   ldrawFile->deleteLine(here.modelName,here.lineNumber);
-  gui->showLine(here);
+  gui->redrawLater(here);
 }
 
 void InsertLineCommand::redo()
 {
   ldrawFile->insertLine(here.modelName,here.lineNumber,line);
-  gui->showLine(here);
-  gui->displayPage();
+  gui->redrawLater(here);
 }
 
 AppendLineCommand::AppendLineCommand(
@@ -60,15 +59,13 @@ AppendLineCommand::AppendLineCommand(
 void AppendLineCommand::undo()
 {
   ldrawFile->deleteLine(here.modelName,here.lineNumber+1);
-  gui->showLine(here);
-  gui->displayPage();
+  gui->redrawLater(here);
 }
 
 void AppendLineCommand::redo()
 {
   ldrawFile->insertLine(here.modelName,here.lineNumber+1,line);
-  gui->showLine(here);
-  gui->displayPage();
+  gui->redrawLater(here);
 }
 
 DeleteLineCommand::DeleteLineCommand(
@@ -85,16 +82,14 @@ DeleteLineCommand::DeleteLineCommand(
 void DeleteLineCommand::undo()
 {
   ldrawFile->insertLine(here.modelName,here.lineNumber,deletedLine);
-  gui->showLine(here);
-  gui->displayPage();
+  gui->redrawLater(here);
 }
 
 void DeleteLineCommand::redo()
 {
   deletedLine = ldrawFile->readLine(here.modelName, here.lineNumber);
   ldrawFile->deleteLine(here.modelName,here.lineNumber);
-  gui->showLine(here);
-  gui->displayPage();
+  gui->redrawLater(here);
 }
 
 ReplaceLineCommand::ReplaceLineCommand(
@@ -114,8 +109,7 @@ ReplaceLineCommand::ReplaceLineCommand(
 void ReplaceLineCommand::undo()
 {
   ldrawFile->replaceLine(here.modelName,here.lineNumber,oldLine);
-  gui->showLine(here);
-  gui->displayPage();
+  gui->redrawLater(here);
 }
 
 void ReplaceLineCommand::redo()
@@ -123,8 +117,30 @@ void ReplaceLineCommand::redo()
   ldrawFile->replaceLine(here.modelName,
                          here.lineNumber,
                          newLine);
-  gui->showLine(here);
-  gui->displayPage();
+  gui->redrawLater(here);
+}
+
+EditLinesCommand::EditLinesCommand(
+  LDrawFile        *_ldrawFile,
+  const LDrawEdits &_edits,
+  QUndoCommand     *parent)
+  : QUndoCommand(parent)
+{
+  setText("editLines");
+  ldrawFile = _ldrawFile;
+  edits     = _edits;
+}
+
+void EditLinesCommand::undo()
+{
+  edits = ldrawFile->edit(undoEdits);
+  gui->redrawLater(Where(undoEdits.fileName(),undoEdits.firstLine()));
+}
+
+void EditLinesCommand::redo()
+{
+  undoEdits = ldrawFile->edit(edits);
+  gui->redrawLater(Where(edits.fileName(),edits.firstLine()));
 }
 
 ContentsChangeCommand::ContentsChangeCommand(
@@ -157,7 +173,7 @@ void ContentsChangeCommand::redo()
     isRedo = true;
   } else {
     gui->maxPages = -1;
-    gui->displayPage();
+    gui->redrawLater();
   }
 }
 
@@ -171,5 +187,5 @@ void ContentsChangeCommand::undo()
     position,
     addedChars.size(),
     removedChars);
-  gui->displayPage();
+  gui->redrawLater();
 }
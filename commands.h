@@ -62,13 +62,16 @@
  *
  * The editWindow disconnects contentsChange events, updates the document's
  * plain text, and then reconnects contentsChange.
+ *
+ * Changes that touch many lines of a file (removing LPub formatting, say)
+ * stage them in an LDrawEdits and push one EditLinesCommand, which makes
+ * them in a single pass over the file, and undoes them the same way.
  * 
  ***************************************************************************/
 
 #include <QUndoCommand>
 #include "where.h"
-
-class LDrawFile;
+#include "ldrawfiles.h"
 
 class InsertLineCommand : public QUndoCommand
 {
@@ -137,6 +140,22 @@ private:
   QString    oldLine;
 };
 
+class EditLinesCommand : public QUndoCommand
+{
+public:
+  EditLinesCommand(LDrawFile        *ldrawFile,
+                   const LDrawEdits &edits,
+                   QUndoCommand     *parent = 0);
+
+  void undo();
+  void redo();
+
+private:
+  LDrawFile  *ldrawFile;
+  LDrawEdits  edits;       // what redo does
+  LDrawEdits  undoEdits;   // what undo does
+};
+
 class ContentsChangeCommand : public QUndoCommand
 {
 public:
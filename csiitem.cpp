@@ -342,6 +342,7 @@ void CsiItem::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
       //placeGrabbers();
     }
     QGraphicsPixmapItem::mouseMoveEvent(event);
+    gui->page.graph.dragged(this);
   }
 }
 
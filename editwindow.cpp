@@ -32,22 +32,40 @@
 #include "editwindow.h"
 #include "highlighter.h"
 #include "ldrawfiles.h"
+#include "lineview.h"
 
 EditWindow *editWindow;
 
+/*
+ * Submodels with more lines than this are shown in a LineView, which
+ * only ever looks at the lines on the screen.
+ */
+
+#define LARGE_FILE_LINES 20000
+
 EditWindow::EditWindow()
 {
     editWindow  = this;
+    ldrawFile   = NULL;
     _textEdit   = new QTextEdit;
+    lineView    = new LineView;
 
     highlighter = new Highlighter(_textEdit->document());
     _textEdit->setLineWrapMode(QTextEdit::NoWrap);
     _textEdit->setUndoRedoEnabled(true);
+    lineView->setFont(_textEdit->font());
+
+    connect(lineView, SIGNAL(lineChanged(int, const QString &, const QString &)),
+            this,     SLOT(  lineChanged(int, const QString &, const QString &)));
 
     createActions();
     createToolBars();
 
-    setCentralWidget(_textEdit);
+    stack = new QStackedWidget;
+    stack->addWidget(_textEdit);
+    stack->addWidget(lineView);
+
+    setCentralWidget(stack);
 
     resize(800,600);
 }
@@ -64,7 +82,7 @@ void EditWindow::createActions()
     copyAct->setShortcut(tr("Ctrl+C"));
     copyAct->setStatusTip(tr("Copy the current selection's contents to the "
                              "clipboard"));
-    connect(copyAct, SIGNAL(triggered()), _textEdit, SLOT(copy()));
+    connect(copyAct, SIGNAL(triggered()), this, SLOT(copyLine()));
 
     pasteAct = new QAction(QIcon(":/images/paste.png"), tr("&Paste"), this);
     pasteAct->setShortcut(tr("Ctrl+V"));
@@ -102,12 +120,23 @@ void EditWindow::contentsChange(
   QString addedChars;
 
   if (charsAdded) {
-    addedChars = _textEdit->toPlainText();
-    if (addedChars.size() == 0) {
+    QTextDocument *document = _textEdit->document();
+
+    // the document always ends in a paragraph separator the text
+    // does not have
+
+    int end = qMin(position + charsAdded,document->characterCount() - 1);
+
+    if (end <= position) {
       return;
     }
 
-    addedChars = addedChars.mid(position,charsAdded);
+    QTextCursor cursor(document);
+    cursor.setPosition(position);
+    cursor.setPosition(end,QTextCursor::KeepAnchor);
+
+    addedChars = cursor.selectedText();
+    addedChars.replace(QChar::ParagraphSeparator,'\n');
   }
 
   contentsChange(fileName, position, charsRemoved, addedChars);
@@ -144,27 +173,78 @@ void EditWindow::pageUpDown(
 
 void EditWindow::showLine(int lineNumber)
 {
-  _textEdit->moveCursor(QTextCursor::Start,QTextCursor::MoveAnchor);
-  for (int i = 0; i < lineNumber; i++) {
-    _textEdit->moveCursor(QTextCursor::Down,QTextCursor::MoveAnchor);
+  if (large()) {
+    lineView->showLine(lineNumber);
+    return;
+  }
+
+  // go straight to the line rather than stepping down to it
+
+  QTextBlock block = _textEdit->document()->findBlockByNumber(lineNumber);
+  QTextCursor cursor = _textEdit->textCursor();
+
+  if (block.isValid()) {
+    cursor.setPosition(block.position());
+  } else {
+    cursor.movePosition(QTextCursor::End);
   }
+  _textEdit->setTextCursor(cursor);
   _textEdit->moveCursor(QTextCursor::EndOfLine,QTextCursor::KeepAnchor);
   _textEdit->ensureCursorVisible();
   
   pageUpDown(QTextCursor::Up, QTextCursor::KeepAnchor);
 }
 
+/*
+ * A line edited in the LineView goes to the LDraw file the same way as
+ * typing in the QTextEdit does, so it can be undone.
+ */
+
+void EditWindow::lineChanged(
+  int            lineNumber,
+  const QString &oldLine,
+  const QString &newLine)
+{
+  int position = ldrawFile->linePosition(fileName,lineNumber);
+
+  contentsChange(fileName, position, oldLine.size(), newLine);
+}
+
+void EditWindow::copyLine()
+{
+  if (large()) {
+    QApplication::clipboard()->setText(lineView->currentText());
+  } else {
+    _textEdit->copy();
+  }
+}
+
 void EditWindow::displayFile(
-  LDrawFile     *ldrawFile,
+  LDrawFile     *_ldrawFile,
   const QString &_fileName)
 {
   fileName = _fileName;
+  ldrawFile = _ldrawFile;
   disconnect(_textEdit->document(), SIGNAL(contentsChange(int,int,int)),
              this,                  SLOT(  contentsChange(int,int,int)));
-  if (fileName == "") {
+  if (fileName != "" && ldrawFile->size(fileName) > LARGE_FILE_LINES) {
     _textEdit->document()->clear();
+    lineView->setFile(ldrawFile,fileName);
+    stack->setCurrentWidget(lineView);
+    cutAct->setEnabled(false);
+    pasteAct->setEnabled(false);
+    copyAct->setEnabled(true);
   } else {
-    _textEdit->setPlainText(ldrawFile->contents(fileName).join("\n"));
+    if (fileName == "") {
+      _textEdit->document()->clear();
+    } else {
+      _textEdit->setPlainText(ldrawFile->contents(fileName).join("\n"));
+    }
+    lineView->setFile(NULL,"");
+    stack->setCurrentWidget(_textEdit);
+    pasteAct->setEnabled(true);
+    copyAct->setEnabled(_textEdit->textCursor().hasSelection());
+    cutAct->setEnabled(_textEdit->textCursor().hasSelection());
   }
   _textEdit->document()->setModified(false);
   connect(_textEdit->document(), SIGNAL(contentsChange(int,int,int)),
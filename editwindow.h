@@ -34,6 +34,8 @@
 #include <QTextCursor>
 
 class QTextEdit;
+class QStackedWidget;
+class LineView;
 class LDrawFile;
 class Highlighter;
 class QString;
@@ -53,10 +55,18 @@ private:
     void createMenus();
     void createToolBars();
 
-    QDockWidget *dock;
-    QTextEdit   *_textEdit;
-    Highlighter *highlighter;
-    QString      fileName;  // of file currently being displayed
+    QDockWidget    *dock;
+    QStackedWidget *stack;
+    QTextEdit      *_textEdit;
+    LineView       *lineView;  // for files too big for _textEdit
+    Highlighter    *highlighter;
+    LDrawFile      *ldrawFile;
+    QString         fileName;  // of file currently being displayed
+
+    bool large()
+    {
+      return stack->currentWidget() == (QWidget *) lineView;
+    }
 
     QMenu    *editMenu;
     QToolBar *editToolBar;
@@ -71,6 +81,8 @@ signals:
 
 private slots:
     void contentsChange(int position, int charsRemoved, int charsAdded);
+    void lineChanged(int lineNumber, const QString &oldLine, const QString &newLine);
+    void copyLine();
     // Maybe this helps resizing the editwindow (Jaco)
     void redraw();
 
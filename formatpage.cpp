@@ -32,6 +32,7 @@
 #include "callout.h"
 #include "lpub.h"
 #include "ranges.h"
+#include "pagearena.h"
 #include "range.h"
 #include "step.h"
 #include "meta.h"
@@ -62,6 +63,8 @@ void Gui::clearPage(
     view->pageBackgroundItem = NULL;
   }
   scene->clear();
+
+  PageArena::release();
 }
 
 /*********************************************
@@ -230,9 +233,13 @@ int Gui::addGraphicsPageItems(
   view->pageBackgroundItem = pageBg;
   pageBg->setPos(0,0);
 
-  // Set up the placement aspects of the page in the Qt space
+  // Set up the placement aspects of the page in the Qt space.  The page
+  // is the root of the page's placement graph, which is kept with the
+  // page so drags can place things again without redrawing it.
+
+  page->graph.clear();
 
-  Placement plPage;
+  Placement &plPage = page->graph.root;
   plPage.relativeType = PageType;
 
   plPage.setSize(pW,pH);
@@ -300,7 +307,7 @@ int Gui::addGraphicsPageItems(
       pageNumber->placement.setValue(placementData);
     }
     
-    plPage.appendRelativeTo(pageNumber);
+    page->graph.add(&plPage,pageNumber,pageNumber);
     plPage.placeRelative(pageNumber);
     pageNumber->setPos(pageNumber->loc[XX],pageNumber->loc[YY]);
     
@@ -344,8 +351,10 @@ int Gui::addGraphicsPageItems(
         
         if (placementData.relativeTo == PageNumberType &&
             page->meta.LPub.page.dpn.value()) {
+          page->graph.add(pageNumber,instanceCount,instanceCount);
           pageNumber->placeRelative(instanceCount);
         } else {
+          page->graph.add(&plPage,instanceCount,instanceCount);
           plPage.placeRelative(instanceCount);
         }
         instanceCount->setPos(instanceCount->loc[XX],instanceCount->loc[YY]);
@@ -386,9 +395,11 @@ int Gui::addGraphicsPageItems(
               pld.offsets[1]    = insert.offsets[1];
               
               pixmap->placement.setValue(pld);
+              pixmap->relativeType = InsertType;
 
               int margin[2] = {0, 0};
 
+              page->graph.add(&plPage,pixmap,pixmap);
               plPage.placeRelative(pixmap, margin);
               pixmap->setPos(pixmap->loc[XX],pixmap->loc[YY]);
               pixmap->relativeToSize[0] = plPage.size[XX];
@@ -410,9 +421,11 @@ int Gui::addGraphicsPageItems(
             pld.offsets[1]    = insert.offsets[1];
 
             text->placement.setValue(pld);
+            text->relativeType = InsertType;
 
             int margin[2] = {0, 0};
 
+            page->graph.add(&plPage,text,text);
             plPage.placeRelative(text, margin);
             text->setPos(text->loc[XX],text->loc[YY]);
             text->relativeToSize[0] = plPage.size[XX];
@@ -513,6 +526,9 @@ int Gui::addGraphicsPageItems(
           step->pli.setPos(step->pli.loc[XX],
                            step->pli.loc[YY]);
 
+          page->graph.show(step->csiItem,step->csiItem);
+          page->graph.show(&step->pli,step->pli.background);
+
           // allocate QGraphicsTextItem for step number
       
           if ( ! step->onlyChild()) {
@@ -527,6 +543,7 @@ int Gui::addGraphicsPageItems(
                                step->stepNumber.loc[YY]);
             stepNumber->relativeToSize[0] = step->stepNumber.relativeToSize[0];
             stepNumber->relativeToSize[1] = step->stepNumber.relativeToSize[1];
+            page->graph.show(&step->stepNumber,stepNumber);
           } else if (step->pli.background) {
             step->pli.background->setFlag(QGraphicsItem::ItemIsMovable,false);
           }
@@ -544,6 +561,8 @@ int Gui::addGraphicsPageItems(
             // add the callout's graphics items to the scene
 
             callout->addGraphicsItems(0,0,csiRect,pageBg,true);
+            page->graph.show(callout,callout->background);
+            page->graph.show(callout,callout->underpinnings);
 
             // foreach pointer
             //   add the pointer to the graphics scene
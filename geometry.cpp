@@ -0,0 +1,224 @@
+
+/****************************************************************************
+**
+** Copyright (C) 2007-2009 Kevin Clague. All rights reserved.
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.trolltech.com/products/qt/opensource.html
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+/****************************************************************************
+ *
+ * This class knows the real size of parts.  The first time a part (or
+ * submodel) is asked about, its LDraw file and everything it references
+ * are read, and the axis aligned bounding box of the geometry is
+ * remembered.  The renderers use these to size their images to what
+ * is actually going to be drawn, rather than to the whole page.
+ *
+ * Please see lpub.h for an overall description of how the files in LPub
+ * make up the LPub program.
+ *
+ ***************************************************************************/
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <math.h>
+#include "geometry.h"
+#include "ldrawfiles.h"
+#include "ldrawzip.h"
+#include "lpub_preferences.h"
+#include "paths.h"
+
+QHash<QString, PartGeometry::Entry> PartGeometry::cache;
+QStringList                         PartGeometry::searchPaths;
+
+#define MAX_GEOMETRY_DEPTH 64
+
+void BoundingBox::add(
+  const BoundingBox &child,
+  const float        pos[3],
+  const float        matrix[3][3])
+{
+  if ( ! child.valid) {
+    add(pos[0],pos[1],pos[2]);
+    return;
+  }
+
+  // transform the center, and grow the half extents by the absolute
+  // value of the matrix, which gives the box around the rotated box
+
+  for (int d = 0; d < 3; d++) {
+    float c = pos[d];
+    float h = 0;
+    for (int k = 0; k < 3; k++) {
+      c += matrix[d][k]*child.center(k);
+      h += fabs(matrix[d][k])*child.half(k);
+    }
+    min[d] = c - h < min[d] ? c - h : min[d];
+    max[d] = c + h > max[d] ? c + h : max[d];
+  }
+  valid = true;
+}
+
+float BoundingBox::radius() const
+{
+  if ( ! valid) {
+    return 0;
+  }
+  float sum = 0;
+  for (int d = 0; d < 3; d++) {
+    float reach = qMax(fabs(min[d]),fabs(max[d]));
+    sum += reach*reach;
+  }
+  return sqrt(sum);
+}
+
+QString PartGeometry::findFile(const QString &name, bool &library)
+{
+  if (searchPaths.size() == 0) {
+    searchPaths << "/parts/" << "/p/" << "/models/" <<
+                   "/Unofficial/parts/" << "/Unofficial/p/" <<
+                   "/Unofficial/LSynth/" <<
+                   "/Helpers/" << "/Custom/" << "/Development/";
+  }
+
+  // submodels are written to the tmp directory for the renderers
+
+  QString tmpName = QDir::currentPath() + "/" + Paths::tmpDir + "/" + name;
+  library = false;
+  if (QFile::exists(tmpName)) {
+    return tmpName;
+  }
+
+  library = true;
+  for (int i = 0; i < searchPaths.size(); i++) {
+    QString testName = Preferences::ldrawPath + searchPaths[i] + name;
+    if (LDrawZip::exists(testName)) {
+      return testName;
+    }
+  }
+
+  library = false;
+  return QString();
+}
+
+bool PartGeometry::readFile(
+  const QString     &fileName,
+        BoundingBox &box,
+        int          depth)
+{
+  QByteArray contents;
+  if ( ! LDrawZip::read(fileName,contents)) {
+    return false;
+  }
+
+  QTextStream in(contents);
+
+  while ( ! in.atEnd()) {
+    QString line = in.readLine(0);
+    QStringList tokens;
+
+    split(line,tokens);
+
+    if (tokens.size() == 15 && tokens[0] == "1") {
+      float pos[3], matrix[3][3];
+      for (int d = 0; d < 3; d++) {
+        pos[d] = tokens[2+d].toFloat();
+      }
+      for (int e = 0; e < 9; e++) {
+        matrix[e/3][e%3] = tokens[5+e].toFloat();
+      }
+      BoundingBox child;
+      lookup(tokens[14],child,depth + 1);
+      box.add(child,pos,matrix);
+    } else if (tokens.size() >= 8 && tokens[0].size() == 1 &&
+               tokens[0][0] >= '2' && tokens[0][0] <= '5') {
+
+      // the control points of optional lines are not drawn
+
+      int type     = tokens[0].toInt();
+      int vertices = type == 2 || type == 5 ? 2 : type;
+
+      for (int v = 0; v < vertices && 4 + v*3 < tokens.size(); v++) {
+        box.add(tokens[2+v*3].toFloat(),
+                tokens[3+v*3].toFloat(),
+                tokens[4+v*3].toFloat());
+      }
+    }
+  }
+  return true;
+}
+
+bool PartGeometry::lookup(
+  const QString     &mcName,
+        BoundingBox &box,
+        int          depth)
+{
+  QString name = mcName.trimmed().toLower().replace('\\','/');
+
+  QHash<QString, Entry>::iterator i = cache.find(name);
+
+  if (i != cache.end()) {
+    if (i.value().loading) {
+      return false;
+    }
+    box = i.value().box;
+    return box.valid;
+  }
+
+  if (depth > MAX_GEOMETRY_DEPTH) {
+    return false;
+  }
+
+  bool    library;
+  QString fileName = findFile(name,library);
+
+  Entry entry;
+  entry.library = library;
+  entry.loading = true;
+  cache.insert(name,entry);
+
+  if (fileName != "") {
+    readFile(fileName,entry.box,depth);
+  }
+
+  entry.loading = false;
+  cache.insert(name,entry);
+
+  box = entry.box;
+  return box.valid;
+}
+
+bool PartGeometry::boundingBox(const QString &name, BoundingBox &box)
+{
+  box.clear();
+  return lookup(name,box,0);
+}
+
+bool PartGeometry::fileBoundingBox(const QString &fileName, BoundingBox &box)
+{
+  box.clear();
+  return readFile(fileName,box,0) && box.valid;
+}
+
+void PartGeometry::clearModels()
+{
+  QHash<QString, Entry>::iterator i = cache.begin();
+  while (i != cache.end()) {
+    if (i.value().library) {
+      ++i;
+    } else {
+      i = cache.erase(i);
+    }
+  }
+}
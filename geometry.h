@@ -0,0 +1,118 @@
+
+/****************************************************************************
+**
+** Copyright (C) 2007-2009 Kevin Clague. All rights reserved.
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.trolltech.com/products/qt/opensource.html
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+/****************************************************************************
+ *
+ * This class knows the real size of parts.  The first time a part (or
+ * submodel) is asked about, its LDraw file and everything it references
+ * are read, and the axis aligned bounding box of the geometry is
+ * remembered.  The renderers use these to size their images to what
+ * is actually going to be drawn, rather than to the whole page.
+ *
+ * Please see lpub.h for an overall description of how the files in LPub
+ * make up the LPub program.
+ *
+ ***************************************************************************/
+
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+class BoundingBox {
+  public:
+    float min[3];
+    float max[3];
+    bool  valid;
+
+    BoundingBox()
+    {
+      clear();
+    }
+    void clear()
+    {
+      for (int d = 0; d < 3; d++) {
+        min[d] =  1e23f;
+        max[d] = -1e23f;
+      }
+      valid = false;
+    }
+    void add(float x, float y, float z)
+    {
+      float v[3] = { x, y, z };
+      for (int d = 0; d < 3; d++) {
+        min[d] = v[d] < min[d] ? v[d] : min[d];
+        max[d] = v[d] > max[d] ? v[d] : max[d];
+      }
+      valid = true;
+    }
+    float center(int d) const
+    {
+      return valid ? (min[d] + max[d])/2 : 0;
+    }
+    float half(int d) const
+    {
+      return valid ? (max[d] - min[d])/2 : 0;
+    }
+
+    /* add a child box placed by an LDraw type 1 position and matrix */
+
+    void add(const BoundingBox &child, const float pos[3], const float matrix[3][3]);
+
+    /* the radius of the sphere around the origin that holds the box */
+
+    float radius() const;
+};
+
+class PartGeometry {
+  private:
+    class Entry {
+      public:
+        BoundingBox box;
+        bool        library;    // found in the LDraw library
+        bool        loading;    // guards against recursive references
+        Entry()
+        {
+          library = false;
+          loading = false;
+        }
+    };
+    static QHash<QString, Entry> cache;
+    static QStringList           searchPaths;
+
+    static QString findFile(const QString &name, bool &library);
+    static bool    readFile(const QString &fileName, BoundingBox &box, int depth);
+    static bool    lookup(const QString &name, BoundingBox &box, int depth);
+  public:
+
+    /* the bounding box of a part, primitive or submodel by name */
+
+    static bool boundingBox(const QString &name, BoundingBox &box);
+
+    /* the bounding box of an LDraw file that is not remembered, e.g.
+       the scratch files handed to the renderers */
+
+    static bool fileBoundingBox(const QString &fileName, BoundingBox &box);
+
+    /* forget submodels, because they are being rewritten */
+
+    static void clearModels();
+};
+
+#endif
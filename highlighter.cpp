@@ -27,130 +27,238 @@
 #include <QtGui>
 
 #include "highlighter.h"
+#include "meta.h"
+
+QHash<QString, int> Highlighter::metaKeywords;
+
+void Highlighter::initMetaKeywords()
+{
+    /* the meta-commands LPub parses */
+
+    Meta meta;
+
+    QHash<QString, AbstractMeta *>::const_iterator entry;
+    for (entry = meta.list.constBegin(); entry != meta.list.constEnd(); ++entry) {
+        AbstractMeta *command = entry.value();
+        int kind;
+
+        if (command == &meta.LPub) {
+            kind = LPubMeta;
+        } else if (command == &meta.LSynth) {
+            kind = LSynthMeta;
+        } else if (command == &meta.MLCad ||
+                   command == &meta.rotStep ||
+                   command == &meta.bfx) {
+            kind = MLCadMeta;
+        } else {
+            kind = OfficialMeta;
+        }
+        metaKeywords[entry.key()] = kind;
+    }
+
+    /* Meta::parse takes these as !LPUB */
+
+    metaKeywords["LPUB"]  = LPubMeta;
+    metaKeywords["PLIST"] = LPubMeta;
+    metaKeywords["!SYNTH"] = LSynthMeta;
+
+    /* the ones LPub passes over, but are still worth seeing */
+
+    const char *official[] = {
+        "FILE", "NOFILE", "Author", "BFC", "!CATEGORY", "!CMDLINE",
+        "!COLOUR", "!HELP", "!HISTORY", "!KEYWORDS", "!LDRAW_ORG",
+        "LDRAW_ORG", "!LICENSE", "Name", "PAUSE", "PRINT", "SAVE", "WRITE",
+        "Official", "Unofficial", "Un-official", "Original", "~Moved", "//"
+    };
+    for (unsigned i = 0; i < sizeof(official)/sizeof(official[0]); i++) {
+        metaKeywords[official[i]] = OfficialMeta;
+    }
+
+    const char *MLCad[] = { "ROTATION", "GROUP", "GHOST", "BACKGROUND" };
+    for (unsigned i = 0; i < sizeof(MLCad)/sizeof(MLCad[0]); i++) {
+        metaKeywords[MLCad[i]] = MLCadMeta;
+    }
+}
 
 Highlighter::Highlighter(QTextDocument *parent)
     : QSyntaxHighlighter(parent)
 {
-    HighlightingRule rule;
+    if (metaKeywords.isEmpty()) {
+        initMetaKeywords();
+    }
 
     officialMetaFormat.setForeground(Qt::blue);
     officialMetaFormat.setFontWeight(QFont::Bold);
-    QStringList officialMetaPatterns;
-    officialMetaPatterns 
-       << "\\bFILE[^\n]*" 
-       << "\\bNOFILE[^\n]*"
-
-       << "\\bAuthor[^\n]*" 
-       << "\\bBFC[^\n]*"
-       << "\\b!CATEGORY[^\n]*"
-       << "\\bCLEAR[^\n]*"
-       << "\\b!CMDLINE[^\n]*"
-       << "\\b!COLOUR[^\n]*"
-       << "\\b!HELP[^\n]*"
-       << "\\b!HISTORY[^\n]*"
-       << "\\b!KEYWORDS[^\n]*"
-       << "\\b!LDRAW_ORG[^\n]*"
-       << "\\bLDRAW_ORG[^\n]*"
-       << "\\b!LICENSE[^\n]*"
-       << "\\bName[^\n]*" 
-       << "\\bPAUSE[^\n]*"
-       << "\\bPRINT[^\n]*"
-       << "\\bSAVE[^\n]*"
-       << "\\bSTEP[^\n]*\\b"
-       << "\\bWRITE[^\n]*\\b"
-
-       << "\\bOfficial[^\n]*"
-       << "\\bUnofficial[^\n]*" 
-       << "\\bUn-official[^\n]*" 
-       << "\\bOriginal LDraw[^\n]*"
-
-       << "\\b~Moved to[^\n]*"
-       << "\\b//[^\n]*"
-       ;
-    foreach (QString pattern, officialMetaPatterns) {
-        rule.pattern = QRegExp(pattern);
-        rule.format = officialMetaFormat;
-        highlightingRules.append(rule);
-    }
 
     MLCadMetaFormat.setForeground(Qt::darkBlue);
     MLCadMetaFormat.setFontWeight(QFont::Bold);
-    QStringList MLCadMetaPatterns;
-    MLCadMetaPatterns 
-       << "\\bROTATION\\b[^\n]*" 
-       << "\\bROTSTEP\\b[^\n]*" 
-       << "\\bBUFEXCHG\\b[^\n]*"
-       << "\\bMLCAD\\b[^\n]*"
-       << "\\bGROUP\\b[^\n]*"
-       << "\\bGHOST\\b[^\n]*"
-       << "\\bBACKGROUND\\b[^\n]*";
-    foreach (QString pattern, MLCadMetaPatterns) {
-        rule.pattern = QRegExp(pattern);
-        rule.format = MLCadMetaFormat;
-        highlightingRules.append(rule);
-    }
 
     LPubMetaFormat.setForeground(Qt::darkRed);
     LPubMetaFormat.setFontWeight(QFont::Bold);
-    QStringList LPubMetaPatterns;
-    LPubMetaPatterns
-      << "\\bLPUB\\b[^\n]*"
-      << "\\b!LPUB\\b[^\n]*"
-      << "\\bPLIST\\b[^\n]*";
-
-    foreach (QString pattern, LPubMetaPatterns) {
-        rule.pattern = QRegExp(pattern);
-        rule.format = LPubMetaFormat;
-        highlightingRules.append(rule);
-    }
 
     LSynthMetaFormat.setFontWeight(QFont::Bold);
     LSynthMetaFormat.setForeground(Qt::red);
-    QStringList LSynthMetaPatterns;
-    LSynthMetaPatterns
-      << "\\bSYNTH\\b[^\n]*"
-      << "\\b!SYNTH\\b[^\n]*";
-    foreach (QString pattern, LSynthMetaPatterns) {
-        rule.pattern = QRegExp(pattern);
-        rule.format = LSynthMetaFormat;
-        highlightingRules.append(rule);
-    }
 
     multiLineCommentFormat.setForeground(Qt::darkGreen);
 
-    commentStartExpression = QRegExp("\\bLPUB FOO BEGIN\\b+[^\n]*");
-    commentEndExpression   = QRegExp("\\bLPUB FOO END\\b+[^\n]*");
+    lineTypeFormat.setFontWeight(QFont::Bold);
+    colorFormat.setForeground(Qt::darkMagenta);
+    fileNameFormat.setForeground(Qt::darkCyan);
+
+    metaFormats[OfficialMeta] = &officialMetaFormat;
+    metaFormats[MLCadMeta]    = &MLCadMetaFormat;
+    metaFormats[LPubMeta]     = &LPubMetaFormat;
+    metaFormats[LSynthMeta]   = &LSynthMetaFormat;
 }
 
 void Highlighter::highlightBlock(const QString &text)
 {
-    foreach (HighlightingRule rule, highlightingRules) {
-        QRegExp expression(rule.pattern);
-        int index = text.indexOf(expression);
-        while (index >= 0) {
-            int length = expression.matchedLength();
-            setFormat(index, length, rule.format);
-            index = text.indexOf(expression, index + length);
+    QList<QTextLayout::FormatRange> ranges;
+    int state = previousBlockState();
+
+    formats(text,state,ranges);
+
+    foreach (QTextLayout::FormatRange range, ranges) {
+        setFormat(range.start, range.length, range.format);
+    }
+    setCurrentBlockState(state);
+}
+
+/*
+ * Find the next token at or after end.  On return start..end is the
+ * token.
+ */
+
+static bool nextToken(const QChar *data, int size, int &start, int &end)
+{
+    start = end;
+    while (start < size && (data[start] == ' ' || data[start] == '\t')) {
+        start++;
+    }
+    end = start;
+    while (end < size && data[end] != ' ' && data[end] != '\t') {
+        end++;
+    }
+    return start < size;
+}
+
+static inline bool isToken(
+    const QChar *data, int start, int end, const char *word)
+{
+    return QString::fromRawData(data + start, end - start) ==
+           QLatin1String(word);
+}
+
+static inline void addRange(
+    QList<QTextLayout::FormatRange> &ranges,
+    int                              start,
+    int                              end,
+    const QTextCharFormat           &format)
+{
+    QTextLayout::FormatRange range;
+    range.start  = start;
+    range.length = end - start;
+    range.format = format;
+    ranges.append(range);
+}
+
+/*
+ * Is this the BEGIN or END line of a multi-line comment?
+ */
+
+static bool isComment(
+    const QChar *data, int size, int start, int end, const char *which)
+{
+    if ( ! isToken(data,start,end,"0")) {
+        return false;
+    }
+    if ( ! nextToken(data,size,start,end) ||
+         ! (isToken(data,start,end,"LPUB") || isToken(data,start,end,"!LPUB"))) {
+        return false;
+    }
+    return nextToken(data,size,start,end) && isToken(data,start,end,"FOO") &&
+           nextToken(data,size,start,end) && isToken(data,start,end,which);
+}
+
+void Highlighter::formats(
+  const QString                   &text,
+  int                             &state,
+  QList<QTextLayout::FormatRange> &ranges)
+{
+    const QChar *data = text.constData();
+    int          size = text.size();
+    int          start, end = 0;
+
+    if ( ! nextToken(data,size,start,end)) {
+        if (state != 1) {
+            state = 0;
         }
+        return;
     }
-    setCurrentBlockState(0);
-
-    int startIndex = 0;
-    if (previousBlockState() != 1)
-        startIndex = text.indexOf(commentStartExpression);
-
-    while (startIndex >= 0) {
-        int endIndex = text.indexOf(commentEndExpression, startIndex);
-        int commentLength;
-        if (endIndex == -1) {
-            setCurrentBlockState(1);
-            commentLength = text.length() - startIndex;
-        } else {
-            commentLength = endIndex - startIndex
-                            + commentEndExpression.matchedLength();
+
+    if (state == 1) {
+        addRange(ranges,0,size,multiLineCommentFormat);
+        if (isComment(data,size,start,end,"END")) {
+            state = 0;
+        }
+        return;
+    }
+    state = 0;
+
+    if (end - start != 1 || data[start] < '0' || data[start] > '5') {
+        return;
+    }
+
+    char type = data[start].toLatin1();
+
+    addRange(ranges,start,end,lineTypeFormat);
+
+    if (type == '0') {
+        int lineStart = start;
+
+        if ( ! nextToken(data,size,start,end)) {
+            return;
+        }
+
+        int length = end - start;
+        if (length > 1 && data[end - 1] == ':') {
+            length--;                             // Name: and Author:
+        }
+        if (length > 2 && data[start] == '/' && data[start + 1] == '/') {
+            length = 2;                           // //comment
+        }
+
+        QHash<QString, int>::const_iterator i =
+          metaKeywords.constFind(QString::fromRawData(data + start, length));
+
+        if (i != metaKeywords.constEnd()) {
+            addRange(ranges,start,size,*metaFormats[i.value()]);
+        }
+
+        if (isComment(data,size,lineStart,lineStart + 1,"BEGIN")) {
+            addRange(ranges,start,size,multiLineCommentFormat);
+            state = 1;
+        }
+        return;
+    }
+
+    // every other line type is followed by its color
+
+    if ( ! nextToken(data,size,start,end)) {
+        return;
+    }
+    addRange(ranges,start,end,colorFormat);
+
+    // and type 1 has a position and matrix then the file name
+
+    if (type == '1') {
+        for (int i = 0; i < 12; i++) {
+            if ( ! nextToken(data,size,start,end)) {
+                return;
+            }
+        }
+        if (nextToken(data,size,start,end)) {
+            addRange(ranges,start,size,fileNameFormat);
         }
-        setFormat(startIndex, commentLength, multiLineCommentFormat);
-        startIndex = text.indexOf(commentStartExpression,
-                                                startIndex + commentLength);
     }
 }
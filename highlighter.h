@@ -21,6 +21,11 @@
  * This implements a syntax highlighter class that works with the editwindow
  * to display LDraw files with syntax highlighting.
  *
+ * The type of an LDraw line is given by its first token, and the kind of
+ * a meta-command by the token after the 0, so each line is highlighted
+ * in one pass from left to right, without regular expressions.  The
+ * meta-commands LPub understands are taken from Meta's keyword table.
+ *
  * Please see lpub.h for an overall description of how the files in LPub
  * make up the LPub program.
  *
@@ -33,6 +38,7 @@
 
 #include <QHash>
 #include <QTextCharFormat>
+#include <QTextLayout>
 
 class QTextDocument;
 
@@ -43,25 +49,43 @@ class Highlighter : public QSyntaxHighlighter
 public:
     Highlighter(QTextDocument *parent = 0);
 
+    /*
+     * The formats for one line, for views that draw the text themselves.
+     * state says whether the line before ended inside a multi-line
+     * comment, and is updated for the line after.
+     */
+
+    void formats(
+      const QString                   &text,
+      int                             &state,
+      QList<QTextLayout::FormatRange> &ranges);
+
 protected:
     void highlightBlock(const QString &text);
 
 private:
-    struct HighlightingRule
-    {
-        QRegExp pattern;
-        QTextCharFormat format;
+    enum MetaKind {
+      OfficialMeta,
+      MLCadMeta,
+      LPubMeta,
+      LSynthMeta
     };
-    QVector<HighlightingRule> highlightingRules;
 
-    QRegExp commentStartExpression;
-    QRegExp commentEndExpression;
+    /* the first word after the 0 of every meta-command we color */
+
+    static QHash<QString, int> metaKeywords;
+    static void initMetaKeywords();
+
+    QTextCharFormat *metaFormats[4];
 
     QTextCharFormat officialMetaFormat;
     QTextCharFormat MLCadMetaFormat;
     QTextCharFormat LPubMetaFormat;
     QTextCharFormat LSynthMetaFormat;
     QTextCharFormat multiLineCommentFormat;
+    QTextCharFormat lineTypeFormat;
+    QTextCharFormat colorFormat;
+    QTextCharFormat fileNameFormat;
 };
 
 #endif
@@ -31,16 +31,21 @@
 #include <QFile>
 #include <QList>
 #include <QRegExp>
+#include <QHash>
+#include <QSet>
+#include <QtConcurrentMap>
+#include <string.h>
 #include "name.h"
 #include "paths.h"
+#include "lmessagebox.h"
 
 LDrawSubFile::LDrawSubFile(
-  const QStringList &contents,
+  const LineArena   &contents,
   QDateTime   &datetime,
   bool         unofficialPart,
   bool         generated)
 {
-  _contents << contents;
+  _contents = contents;
   _datetime = datetime;
   _modified = false;
   _numSteps = 0;
@@ -67,6 +72,15 @@ void LDrawFile::insert(const QString     &mcFileName,
                       QDateTime   &datetime,
                       bool         unofficialPart,
                       bool         generated)
+{
+  insert(mcFileName,LineArena(contents),datetime,unofficialPart,generated);
+}
+
+void LDrawFile::insert(const QString     &mcFileName, 
+                       const LineArena   &contents, 
+                             QDateTime   &datetime,
+                             bool         unofficialPart,
+                             bool         generated)
 {
   QString    fileName = mcFileName.toLower();
   QMap<QString, LDrawSubFile>::iterator i = _subFiles.find(fileName);
@@ -144,6 +158,15 @@ QDateTime LDrawFile::lastModified(const QString &mcFileName)
   return QDateTime();
 }
 
+void LDrawFile::setLastModified(const QString &mcFileName, const QDateTime &datetime)
+{
+  QString fileName = mcFileName.toLower();
+  QMap<QString, LDrawSubFile>::iterator i = _subFiles.find(fileName);
+  if (i != _subFiles.end()) {
+    i.value()._datetime = datetime;
+  }
+}
+
 bool LDrawFile::contains(const QString &file)
 {
   for (int i = 0; i < _subFileOrder.size(); i++) {
@@ -191,7 +214,7 @@ QStringList LDrawFile::contents(const QString &mcFileName)
   QMap<QString, LDrawSubFile>::iterator i = _subFiles.find(fileName);
 
   if (i != _subFiles.end()) {
-    return i.value()._contents;
+    return i.value()._contents.toStringList();
   } else {
     return _emptyList;
   }
@@ -206,7 +229,7 @@ void LDrawFile::setContents(const QString     &mcFileName,
   if (i != _subFiles.end()) {
     i.value()._modified = true;
     //i.value()._datetime = QDateTime::currentDateTime();
-    i.value()._contents = contents;
+    i.value()._contents.setLines(contents);
     i.value()._changedSinceLastWrite = true;
   }
 }
@@ -237,7 +260,7 @@ QString LDrawFile::readLine(const QString &mcFileName, int lineNumber)
   QMap<QString, LDrawSubFile>::iterator i = _subFiles.find(fileName);
 
   if (i != _subFiles.end()) {
-    return i.value()._contents[lineNumber];
+    return i.value()._contents.at(lineNumber);
   }
   QString empty;
   return empty;
@@ -262,7 +285,7 @@ void LDrawFile::replaceLine(const QString &mcFileName, int lineNumber, const QSt
   QMap<QString, LDrawSubFile>::iterator i = _subFiles.find(fileName);
 
   if (i != _subFiles.end()) {
-    i.value()._contents[lineNumber] = line;
+    i.value()._contents.replace(lineNumber,line);
     i.value()._modified = true;
 //    i.value()._datetime = QDateTime::currentDateTime();
     i.value()._changedSinceLastWrite = true;
@@ -282,18 +305,125 @@ void LDrawFile::deleteLine(const QString &mcFileName, int lineNumber)
   }
 }
 
+LDrawEdits LDrawFile::edit(const LDrawEdits &edits)
+{
+  LDrawEdits undo(edits.fileName());
+
+  QString fileName = edits.fileName().toLower();
+  QMap<QString, LDrawSubFile>::iterator i = _subFiles.find(fileName);
+
+  if (i == _subFiles.end() || edits.isEmpty()) {
+    return undo;
+  }
+
+  const LineArena &old  = i.value()._contents;
+  int              size = old.size();
+  LineArena        lines;
+
+  lines.reserve(old.bytes(),size + edits._edits.size());
+
+  QMap<int, LDrawEdit>::const_iterator e = edits._edits.constBegin();
+
+  for (int n = 0; n <= size; n++) {
+
+    while (e != edits._edits.constEnd() && e.key() < n) {
+      ++e;
+    }
+
+    if (e != edits._edits.constEnd() && e.key() == n) {
+      const LDrawEdit &edit = e.value();
+
+      foreach (const QString &line, edit.inserted) {
+        undo.deleteLine(lines.size());
+        lines.append(line);
+      }
+      if (n < size) {
+        if (edit.deleted) {
+          undo.insertLine(lines.size(),old.at(n));
+          continue;
+        }
+        if (edit.replaced) {
+          undo.replaceLine(lines.size(),old.at(n));
+          lines.append(edit.replacement);
+          continue;
+        }
+      }
+    }
+
+    // unchanged lines are copied without decoding them
+
+    if (n < size) {
+      QByteArray bytes = old.view(n);
+      lines.appendUtf8(bytes.constData(),bytes.size());
+    }
+  }
+
+  i.value()._contents = lines;
+  i.value()._modified = true;
+  i.value()._changedSinceLastWrite = true;
+
+  return undo;
+}
+
+/*
+ * Apply an edit made in the editor, which sees the file as one string.
+ * Only the lines the edit touches are replaced.
+ */
+
 void LDrawFile::changeContents(const QString &mcFileName, 
                           int      position, 
                           int      charsRemoved, 
                     const QString &charsAdded)
 {
   QString fileName = mcFileName.toLower();
-  if (charsRemoved || charsAdded.size()) {
-    QString all = contents(fileName).join("\n");
-    all.remove(position,charsRemoved);
-    all.insert(position,charsAdded);
-    setContents(fileName,all.split("\n"));
+  QMap<QString, LDrawSubFile>::iterator i = _subFiles.find(fileName);
+
+  if (i == _subFiles.end() || (charsRemoved == 0 && charsAdded.size() == 0)) {
+    return;
   }
+
+  LineArena &lines = i.value()._contents;
+
+  if (lines.isEmpty()) {
+    lines.append("");
+  }
+
+  int firstLine, firstColumn;
+  int lastLine,  lastColumn;
+
+  lines.locate(position,             firstLine,firstColumn);
+  lines.locate(position+charsRemoved,lastLine, lastColumn);
+
+  QString edited = lines.at(firstLine).left(firstColumn) + 
+                   charsAdded +
+                   lines.at(lastLine).mid(lastColumn);
+
+  lines.replace(firstLine,lastLine - firstLine + 1,edited.split("\n"));
+
+  i.value()._modified = true;
+  i.value()._changedSinceLastWrite = true;
+}
+
+int LDrawFile::linePosition(const QString &mcFileName, int lineNumber)
+{
+  QString fileName = mcFileName.toLower();
+  QMap<QString, LDrawSubFile>::iterator i = _subFiles.find(fileName);
+
+  if (i != _subFiles.end()) {
+    return i.value()._contents.position(lineNumber);
+  }
+  return 0;
+}
+
+QString LDrawFile::readChars(const QString &mcFileName, int position, int count)
+{
+  QString fileName = mcFileName.toLower();
+  QMap<QString, LDrawSubFile>::iterator i = _subFiles.find(fileName);
+
+  if (i != _subFiles.end()) {
+    return i.value()._contents.mid(position,count);
+  }
+  return _emptyString;
 }
 
 void LDrawFile::unrendered()
@@ -351,11 +481,139 @@ int LDrawFile::instances(const QString &mcFileName, bool mirrored)
   return instances;
 }
 
+/*
+ * The loaders look at the raw bytes of each line rather than running
+ * regular expressions over every one of them.  LDraw's meta commands
+ * are all ASCII, so these matchers only need to know about white space
+ * and keywords.
+ */
+
+static inline bool isBlank(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+static inline const char *skipBlanks(const char *p, const char *end)
+{
+  while (p < end && isBlank(*p)) {
+    p++;
+  }
+  return p;
+}
+
+/*
+ * If word is at p, move p past it.
+ */
+
+static inline bool keyword(const char *&p, const char *end, const char *word)
+{
+  const char *q = p;
+  while (*word) {
+    if (q == end || *q != *word) {
+      return false;
+    }
+    q++;
+    word++;
+  }
+  p = q;
+  return true;
+}
+
+enum LineKind {
+  OtherLine,
+  FileLine,            // 0 FILE name
+  NoFileLine,          // 0 NOFILE
+  PartLine,            // 1 ...
+  UnofficialPartLine   // 0 [!]LDRAW_ORG or 0 [!]Unofficial Part
+};
+
+/*
+ * Work out what a line is.  For 0 FILE lines, name is set to where the
+ * name starts.
+ */
+
+static LineKind lineKind(
+  const char  *p,
+  const char  *end,
+  const char *&name)
+{
+  p = skipBlanks(p,end);
+
+  if (p == end) {
+    return OtherLine;
+  }
+  if (*p == '1') {
+    return p + 1 < end && isBlank(p[1]) ? PartLine : OtherLine;
+  }
+  if (*p != '0' || p + 1 == end || ! isBlank(p[1])) {
+    return OtherLine;
+  }
+  p = skipBlanks(p + 1,end);
+
+  const char *q = p;
+
+  if (keyword(q,end,"FILE") && q < end && isBlank(*q)) {
+    name = skipBlanks(q,end);
+    return FileLine;
+  }
+  q = p;
+  if (keyword(q,end,"NOFILE") && skipBlanks(q,end) == end) {
+    return NoFileLine;
+  }
+  q = p;
+  if (q < end && *q == '!') {
+    q++;
+  }
+  if (keyword(q,end,"LDRAW_ORG") || keyword(q,end,"Unofficial Part")) {
+    return UnofficialPartLine;
+  }
+  return OtherLine;
+}
+
+/*
+ * Add a line of a file to an arena.  Plain ASCII (which is nearly all of
+ * LDraw) reads the same in any encoding, so it is copied as it is, and
+ * only other lines go through the locale's codec, as QTextStream would.
+ */
+
+static void appendLine(LineArena &lines, const char *p, const char *eol)
+{
+  for (const char *q = p; q < eol; q++) {
+    if (*q & 0x80) {
+      lines.append(QString::fromLocal8Bit(p,eol - p));
+      return;
+    }
+  }
+  lines.appendUtf8(p,eol - p);
+}
+
+/*
+ * Find the end of the line at p, without its \r\n, and where the next
+ * line starts.
+ */
+
+static inline const char *lineEnd(
+  const char  *p,
+  const char  *end,
+  const char *&next)
+{
+  const char *eol = static_cast<const char *>(memchr(p,'\n',end - p));
+  if (eol == 0) {
+    eol = end;
+  }
+  next = eol < end ? eol + 1 : end;
+
+  if (eol > p && eol[-1] == '\r') {
+    eol--;
+  }
+  return eol;
+}
+
 void LDrawFile::loadFile(const QString &fileName)
 {
     QFile file(fileName);
-    if (!file.open(QFile::ReadOnly | QFile::Text)) {
-        QMessageBox::warning(NULL, 
+    if (!file.open(QFile::ReadOnly)) {
+        LMessageBox::warning(NULL, 
                              QMessageBox::tr(LPUB),
                              QMessageBox::tr("Cannot read file %1:\n%2.")
                              .arg(fileName)
@@ -367,37 +625,14 @@ void LDrawFile::loadFile(const QString &fileName)
 
     empty();
     
-    // allow files ldr suffix to allow for MPD
-    
-    bool mpd = false;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
 
-    QTextStream in(&file);
+    // allow files ldr suffix to allow for MPD
 
-    QStringList contents;
-    QString     mpdName;
-    QRegExp sof("^\\s*0\\s+FILE\\s+(.*)$");
-    QRegExp part("^\\s*1\\s+.*$");
-
-    while ( ! in.atEnd()) {
-      const QString line = in.readLine(0);
-      if (line.contains(sof)) {
-        mpd = true;
-        break;
-      }
-      if (line.contains(part)) {
-        mpd = false;
-        break;
-      }
-    }
-    
-    file.close();
+    QDateTime datetime = QFileInfo(fileName).lastModified();
 
-    QApplication::setOverrideCursor(Qt::WaitCursor);
-    
-    if (mpd) {
-      QDateTime datetime = QFileInfo(fileName).lastModified();
-      loadMPDFile(fileName,datetime);
-    } else {
+    if ( ! loadMPDFile(file,datetime,true)) {
+      file.close();
       QFileInfo fileInfo(fileName);
       loadLDRFile(fileInfo.absolutePath(),fileInfo.fileName());
     }
@@ -408,107 +643,276 @@ void LDrawFile::loadFile(const QString &fileName)
 void LDrawFile::loadMPDFile(const QString &fileName, QDateTime &datetime)
 {
     QFile file(fileName);
-    if (!file.open(QFile::ReadOnly | QFile::Text)) {
-        QMessageBox::warning(NULL, 
+    if (!file.open(QFile::ReadOnly)) {
+        LMessageBox::warning(NULL, 
                              QMessageBox::tr(LPUB),
                              QMessageBox::tr("Cannot read file %1:\n%2.")
                              .arg(fileName)
                              .arg(file.errorString()));
         return;
     }
+    loadMPDFile(file,datetime,false);
+}
 
-    QTextStream in(&file);
-
-    QStringList contents;
-    QString     mpdName;
-    QRegExp sofRE("^\\s*0\\s+FILE\\s+(.*)$");
-    QRegExp eofRE("^\\s*0\\s+NOFILE\\s*$");
-    QRegExp upRE1( "^\\s*0\\s+(LDRAW_ORG|Unofficial Part)");
-    QRegExp upRE2( "^\\s*0\\s+!(LDRAW_ORG|Unofficial Part)");
-    bool    unofficialPart = false;
+/*
+ * Split an MPD file into its submodels in one pass over the file, which
+ * is memory mapped when the platform allows.  When sniffing, the file
+ * is only taken to be an MPD if a 0 FILE line comes before the first
+ * part, and false is returned (with nothing loaded) if it is not.
+ */
 
-    while ( ! in.atEnd()) {
+bool LDrawFile::loadMPDFile(QFile &file, QDateTime &datetime, bool sniff)
+{
+    qint64      size = file.size();
+    uchar      *mapped = size > 0 ? file.map(0,size) : 0;
+    QByteArray  buffer;
+    const char *data;
 
-      const QString line = in.readLine(0);
+    if (mapped) {
+      data = reinterpret_cast<const char *>(mapped);
+    } else {
+      buffer = file.readAll();
+      data = buffer.constData();
+      size = buffer.size();
+    }
 
-      bool sof = line.contains(sofRE);
-      bool eof = line.contains(eofRE);
+    const char *end = data + size;
+    LineArena   contents;
+    QString     mpdName;
+    bool        unofficialPart = false;
+    bool        mpd = ! sniff;
+
+    for (const char *p = data; p < end; ) {
+      const char *next;
+      const char *eol  = lineEnd(p,end,next);
+      const char *name = 0;
+      LineKind    kind = lineKind(p,eol,name);
+
+      if ( ! mpd) {
+        if (kind == FileLine) {
+          mpd = true;
+        } else if (kind == PartLine) {
+          break;
+        }
+      }
 
-      if (sof || eof) {
+      if (kind == FileLine || kind == NoFileLine) {
         if ( ! mpdName.isEmpty()) {
           insert(mpdName,contents,datetime,unofficialPart);
           unofficialPart = false;
         }
         contents.clear();
-        if (sof) {
-          mpdName = sofRE.cap(1);
+        if (kind == FileLine) {
+          mpdName = QString::fromLocal8Bit(name,eol - name);
         } else {
           mpdName.clear();
         }
-      } else if ( ! mpdName.isEmpty() && line != "") {
-        if (line.contains(upRE1)||line.contains(upRE2)) {
+      } else if ( ! mpdName.isEmpty() && eol > p) {
+        if (kind == UnofficialPartLine) {
           unofficialPart = true;
         }
-        contents << line;
+        appendLine(contents,p,eol);
       }
+      p = next;
     }
 
     if ( ! mpdName.isEmpty() && ! contents.isEmpty()) {
       insert(mpdName,contents,datetime,unofficialPart);
     }
-    _mpd = true;
+
+    if (mapped) {
+      file.unmap(mapped);
+    }
+
+    if (mpd) {
+      _mpd = true;
+    }
+    return mpd;
 }
 
-void LDrawFile::loadLDRFile(const QString &path, const QString &fileName)
+/*
+ * One file of a multi-file LDR project, read on one of the loader's
+ * threads.
+ */
+
+class LDRLoad {
+  public:
+    QString                        name;       // as the parent refers to it
+    QString                        fullName;
+    QString                        path;       // the project directory
+    const QHash<QString, QString> *index;      // the files in it
+    LineArena                      contents;
+    QStringList                    subModels;  // in order of appearance
+    QDateTime                      datetime;
+    QString                        error;
+};
+
+/*
+ * Read a file and find the submodels it refers to.  The directory index
+ * only lists the project directory itself, so parts such as 3001.dat
+ * cost a hash lookup rather than a trip to the file system.  Names with
+ * a directory in them, like sub/wheel.ldr, are looked for on disk.
+ */
+
+static QString ldrPath(const QString &path, const QString &subModel)
 {
-    if (_subFiles[fileName]._contents.isEmpty()) {
+  return path + "/" + QString(subModel).replace('\\','/');
+}
 
-      QString fullName(path + "/" + fileName);
+static void readLDR(LDRLoad &load)
+{
+  QFile file(load.fullName);
+  if ( ! file.open(QFile::ReadOnly)) {
+    load.error = file.errorString();
+    return;
+  }
 
-      QFile file(fullName);
-      if ( ! file.open(QFile::ReadOnly | QFile::Text)) {
-        QMessageBox::warning(NULL, 
-                             QMessageBox::tr(LPUB),
-                             QMessageBox::tr("Cannot read file %1:\n%2.")
-                             .arg(fullName)
-                             .arg(file.errorString()));
-        return;
-      }
+  QByteArray  buffer = file.readAll();
+  const char *end = buffer.constData() + buffer.size();
+
+  file.close();
+
+  for (const char *p = buffer.constData(); p < end; ) {
+    const char *next;
+    const char *eol = lineEnd(p,end,next);
+    appendLine(load.contents,p,eol);
+    p = next;
+  }
+
+  load.datetime = QFileInfo(load.fullName).lastModified();
+
+  for (int i = 0; i < load.contents.size(); i++) {
+    QStringList tokens;
 
-      /* Read it in the first time to put into fileList in order of 
-         appearance */
+    if ( ! load.contents.view(i).startsWith('1')) {
+      continue;
+    }
 
-      QTextStream in(&file);
-      QStringList contents;
+    split(load.contents.at(i),tokens);
 
-      while ( ! in.atEnd()) {
-        QString line = in.readLine(0);
-        contents << line;
+    if (tokens.size() == 15) {
+      const QString &subModel = tokens[tokens.size()-1];
+      if (load.index->contains(subModel.toLower())) {
+        load.subModels << subModel;
+      } else if ((subModel.contains('/') || subModel.contains('\\')) &&
+                 QFileInfo(ldrPath(load.path,subModel)).exists()) {
+        load.subModels << subModel;
       }
+    }
+  }
+}
 
-      QDateTime datetime = QFileInfo(fullName).lastModified();
-    
-      insert(fileName,contents,datetime,false);
-      //writeToTmp(fileName,contents);
+/*
+ * The order files were inserted in when they were loaded one at a time:
+ * depth first, in order of reference.
+ */
+
+static void ldrOrder(
+  const QString                 &name,
+  const QHash<QString, LDRLoad> &loaded,
+  QSet<QString>                 &visited,
+  QStringList                   &order)
+{
+  QString lower = name.toLower();
+
+  if (visited.contains(lower) || ! loaded.contains(lower)) {
+    return;
+  }
+  visited.insert(lower);
+
+  const LDRLoad &load = loaded[lower];
+
+  if (load.error != "") {
+    return;
+  }
+  order << lower;
+
+  for (int i = 0; i < load.subModels.size(); i++) {
+    ldrOrder(load.subModels[i],loaded,visited,order);
+  }
+}
+
+/*
+ * Load a top level LDR file and the submodel files it refers to.  The
+ * project directory is listed once, and each generation of submodels
+ * is read in parallel.  The files are then inserted in the same order
+ * as when they were loaded one at a time, so the result does not depend
+ * on which thread finished first.
+ */
+
+void LDrawFile::loadLDRFile(const QString &path, const QString &fileName)
+{
+    QHash<QString, QString> index;
+    QStringList entries = QDir(path).entryList(QDir::Files);
+
+    for (int i = 0; i < entries.size(); i++) {
+      index.insert(entries[i].toLower(),entries[i]);
+    }
+    index.insert(fileName.toLower(),fileName);
+
+    QHash<QString, LDRLoad> loaded;
+    QStringList             wanted;
+
+    wanted << fileName;
 
-      /* read it a second time to find submodels */
+    while (wanted.size()) {
+      QList<LDRLoad> generation;
 
-      for (int i = 0; i < contents.size(); i++) {
-        QString line = contents.at(i);
-        QStringList tokens;
+      for (int i = 0; i < wanted.size(); i++) {
+        LDRLoad load;
+        QString lower = wanted[i].toLower();
+        load.name     = wanted[i];
+        load.fullName = index.contains(lower) ? path + "/" + index.value(lower)
+                                              : ldrPath(path,wanted[i]);
+        load.path     = path;
+        load.index    = &index;
+        generation << load;
+      }
 
-        split(line,tokens);
+      if (generation.size() > 1) {
+        QtConcurrent::blockingMap(generation,readLDR);
+      } else {
+        readLDR(generation[0]);
+      }
 
-        if (line[0] == '1' && tokens.size() == 15) {
-          const QString subModel = tokens[tokens.size()-1];
-          fullName = path + "/" + subModel;
-          if (QFile::exists(fullName)) {
-            loadLDRFile(path,subModel);
+      QSet<QString> queued;
+      wanted.clear();
+
+      for (int i = 0; i < generation.size(); i++) {
+        const LDRLoad &load = generation[i];
+        loaded.insert(load.name.toLower(),load);
+
+        for (int j = 0; j < load.subModels.size(); j++) {
+          QString lower = load.subModels[j].toLower();
+          if ( ! loaded.contains(lower) && ! queued.contains(lower)) {
+            queued.insert(lower);
+            wanted << load.subModels[j];
           }
         }
       }
-      _mpd = false;
     }
+
+    QSet<QString> visited;
+    QStringList   order;
+
+    ldrOrder(fileName,loaded,visited,order);
+
+    for (int i = 0; i < order.size(); i++) {
+      LDRLoad &load = loaded[order[i]];
+      insert(load.name,load.contents,load.datetime,false);
+    }
+
+    QHash<QString, LDRLoad>::const_iterator it;
+    for (it = loaded.constBegin(); it != loaded.constEnd(); ++it) {
+      if (it.value().error != "") {
+        LMessageBox::warning(NULL, 
+                             QMessageBox::tr(LPUB),
+                             QMessageBox::tr("Cannot read file %1:\n%2.")
+                             .arg(it.value().fullName)
+                             .arg(it.value().error));
+      }
+    }
+    _mpd = false;
 }
 
 bool LDrawFile::saveFile(const QString &fileName)
@@ -576,7 +980,7 @@ void LDrawFile::countInstances(const QString &mcFileName, bool isMirrored, bool
     f->_numSteps = 0;
     for (int i = 0; i < j; i++) {
       QStringList tokens;
-      QString line = f->_contents[i];
+      QString line = f->_contents.at(i);
       split(line,tokens);
       
       /* Sorry, but models that are callouts are not counted as instances */
@@ -589,7 +993,7 @@ void LDrawFile::countInstances(const QString &mcFileName, bool isMirrored, bool
         partsAdded = true;
 
         for (++i; i < j; i++) {
-          split(f->_contents[i],tokens);
+          split(f->_contents.at(i),tokens);
           if (tokens.size() == 15 && tokens[0] == "1") {
             if (contains(tokens[14]) /*&& ! buffExchg */ && ! stepIgnore) {
               countInstances(tokens[14],mirrored(tokens),true);
@@ -671,7 +1075,7 @@ bool LDrawFile::saveMPDFile(const QString &fileName)
 {
     QFile file(fileName);
     if (!file.open(QFile::WriteOnly | QFile::Text)) {
-        QMessageBox::warning(NULL, 
+        LMessageBox::warning(NULL, 
                              QMessageBox::tr(LPUB),
                              QMessageBox::tr("Cannot write file %1:\n%2.")
                              .arg(fileName)
@@ -685,11 +1089,13 @@ bool LDrawFile::saveMPDFile(const QString &fileName)
       QString subFileName = _subFileOrder[i];
       QMap<QString, LDrawSubFile>::iterator f = _subFiles.find(subFileName);
       if (f != _subFiles.end() && ! f.value()._generated) {
+        LineArena &contents = f.value()._contents;
         out << "0 FILE " << subFileName << endl;
-        for (int j = 0; j < f.value()._contents.size(); j++) {
-          out << f.value()._contents[j] << endl;
+        for (int j = 0; j < contents.size(); j++) {
+          out << contents.at(j) << endl;
         }
         out << "0 NOFILE " << endl;
+        contents.compact();
       }
     }
     return true;
@@ -713,18 +1119,20 @@ bool LDrawFile::saveLDRFile(const QString &fileName)
       if (f != _subFiles.end() && ! f.value()._generated) {
         if (f.value()._modified) {
           if (!file.open(QFile::WriteOnly | QFile::Text)) {
-            QMessageBox::warning(NULL, 
+            LMessageBox::warning(NULL, 
               QMessageBox::tr(LPUB),
               QMessageBox::tr("Cannot write file %1:\n%2.")
               .arg(writeFileName)
               .arg(file.errorString()));
             return false;
           }
+          LineArena &contents = f.value()._contents;
           QTextStream out(&file);
-          for (int j = 0; j < f.value()._contents.size(); j++) {
-            out << f.value()._contents[j] << endl;
+          for (int j = 0; j < contents.size(); j++) {
+            out << contents.at(j) << endl;
           }
           file.close();
+          contents.compact();
         }
       }
     }
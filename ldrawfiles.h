@@ -36,12 +36,15 @@
 #include <QDateTime>
 #include <QList>
 #include <QRegExp>
+#include "linearena.h"
+
+class QFile;
 
 extern QList<QRegExp> LDrawHeaderRegExp;
 
 class LDrawSubFile {
   public:
-    QStringList _contents;
+    LineArena   _contents;
     bool        _modified;
     QDateTime   _datetime;
     int         _numSteps;
@@ -59,7 +62,7 @@ class LDrawSubFile {
       _unofficialPart = false;
     }
     LDrawSubFile(
-      const QStringList &contents,
+      const LineArena   &contents,
             QDateTime   &datetime,
             bool         unofficialPart,
             bool         generated = false);
@@ -69,12 +72,80 @@ class LDrawSubFile {
     }
 };
 
+/*
+ * A batch of line edits to one file, made all at once by LDrawFile::edit
+ * in one pass over the file.  Line numbers are those of the file before
+ * any of the edits, so a caller walking the file can stage edits as it
+ * goes without allowing for the ones before.  Lines inserted at a line
+ * number go before that line, in the order they were inserted.
+ */
+
+class LDrawEdit {
+  public:
+    QStringList inserted;
+    bool        deleted;
+    bool        replaced;
+    QString     replacement;
+
+    LDrawEdit()
+    {
+      deleted = false;
+      replaced = false;
+    }
+};
+
+class LDrawEdits {
+  private:
+    QString               _fileName;
+    QMap<int, LDrawEdit>  _edits;
+
+    friend class LDrawFile;
+  public:
+    LDrawEdits()
+    {
+    }
+    LDrawEdits(const QString &fileName)
+    {
+      _fileName = fileName;
+    }
+
+    void insertLine(int lineNumber, const QString &line)
+    {
+      _edits[lineNumber].inserted << line;
+    }
+    void replaceLine(int lineNumber, const QString &line)
+    {
+      LDrawEdit &edit  = _edits[lineNumber];
+      edit.replaced    = true;
+      edit.replacement = line;
+    }
+    void deleteLine(int lineNumber)
+    {
+      _edits[lineNumber].deleted = true;
+    }
+
+    const QString &fileName() const
+    {
+      return _fileName;
+    }
+    bool isEmpty() const
+    {
+      return _edits.isEmpty();
+    }
+    int firstLine() const
+    {
+      return _edits.isEmpty() ? 0 : _edits.constBegin().key();
+    }
+};
+
 class LDrawFile {
   private:
     QMap<QString, LDrawSubFile> _subFiles;
     QStringList                 _emptyList;
     QString                     _emptyString;
     bool                        _mpd;
+
+    bool loadMPDFile(QFile &file, QDateTime &datetime, bool sniff);
   public:
     LDrawFile();
     ~LDrawFile()
@@ -92,6 +163,11 @@ class LDrawFile {
                       QDateTime   &datetime,
                       bool         unofficialPart,
                       bool         generated = false);
+    void insert(const QString     &fileName, 
+                const LineArena   &contents, 
+                      QDateTime   &datetime,
+                      bool         unofficialPart,
+                      bool         generated = false);
 
     int  size(const QString &fileName);
     void empty();
@@ -112,12 +188,22 @@ class LDrawFile {
                               int      position, 
                               int      charsRemoved, 
                         const QString &charsAdded);
+    QString readChars(const QString &fileName, int position, int count);
+
+    /*
+     * Make a batch of edits, rebuilding the file once.  Returns the edits
+     * that put it back.
+     */
+
+    LDrawEdits edit(const LDrawEdits &edits);
+    int linePosition(const QString &fileName, int lineNumber);
 
     bool isMpd();
     QString topLevelFile();
     bool isUnofficialPart(const QString &name);
     int numSteps(const QString &fileName);
     QDateTime lastModified(const QString &fileName);
+    void setLastModified(const QString &fileName, const QDateTime &datetime);
     bool contains(const QString &file);
     bool isSubmodel(const QString &file);
     bool modified();
@@ -0,0 +1,453 @@
+
+/****************************************************************************
+**
+** Copyright (C) 2007-2009 Kevin Clague. All rights reserved.
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.trolltech.com/products/qt/opensource.html
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+/****************************************************************************
+ *
+ * This file implements reading the LDraw library out of a zip file.
+ * Only what complete.zip uses is supported: stored and deflated files,
+ * and no zip64.
+ *
+ * Please see lpub.h for an overall description of how the files in LPub
+ * make up the LPub program.
+ *
+ ***************************************************************************/
+
+#include <string.h>
+#include <zlib.h>
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDesktopServices>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QTextStream>
+
+#include "ldrawzip.h"
+#include "ldrawfiles.h"
+#include "libraryindex.h"
+#include "lpub_preferences.h"
+#include "paths.h"
+
+#define END_SIGNATURE     0x06054b50
+#define CENTRAL_SIGNATURE 0x02014b50
+#define LOCAL_SIGNATURE   0x04034b50
+
+class ZipEntry {
+  public:
+    QString name;         // as it is in the zip, less any ldraw/
+    quint32 offset;       // of its local header
+    quint32 compressed;
+    quint32 size;
+    quint16 method;
+    quint32 time;
+};
+
+static QMutex                       zipMutex;
+static QString                      zipPath;
+static QFile                        zipFile;
+static const uchar                 *zipData = NULL;
+static qint64                       zipSize = 0;
+static QHash<QString, ZipEntry>     zipEntries;   // by lower case name
+static QHash<QString, QStringList>  zipDirs;      // lower case directory to files
+static QString                      zipScratch;
+
+static quint32 get32(const uchar *data)
+{
+  return data[0] | (data[1] << 8) | (data[2] << 16) | (quint32(data[3]) << 24);
+}
+
+static quint16 get16(const uchar *data)
+{
+  return data[0] | (data[1] << 8);
+}
+
+static quint32 dosTime(quint16 date, quint16 time)
+{
+  QDateTime datetime(QDate(1980 + (date >> 9),(date >> 5) & 15,date & 31),
+                     QTime(time >> 11,(time >> 5) & 63,(time & 31)*2));
+  return datetime.toTime_t();
+}
+
+bool LDrawZip::isZip(const QString &path)
+{
+  return path.endsWith(".zip",Qt::CaseInsensitive);
+}
+
+/*
+ * Read the central directory of the zip ldrawPath names, if it is not
+ * open already.
+ */
+
+bool LDrawZip::open()
+{
+  QMutexLocker locker(&zipMutex);
+
+  const QString &path = Preferences::ldrawPath;
+
+  if (zipData && zipPath == path) {
+    return true;
+  }
+  if ( ! isZip(path)) {
+    return false;
+  }
+
+  if (zipData) {
+    zipFile.close();
+    zipData = NULL;
+    zipEntries.clear();
+    zipDirs.clear();
+  }
+
+  zipFile.setFileName(path);
+  if ( ! zipFile.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  zipSize = zipFile.size();
+
+  const uchar *data = zipFile.map(0,zipSize);
+  if (data == NULL) {
+    zipFile.close();
+    return false;
+  }
+
+  // the end of central directory record is at the end, before a comment
+  // of up to 64K
+
+  const uchar *end = NULL;
+  for (qint64 p = zipSize - 22; p >= 0 && p >= zipSize - 22 - 0xffff; p--) {
+    if (get32(data + p) == END_SIGNATURE) {
+      end = data + p;
+      break;
+    }
+  }
+
+  quint32 centralSize   = end ? get32(end + 12) : 0;
+  quint32 centralOffset = end ? get32(end + 16) : 0;
+
+  if (end == NULL || qint64(centralOffset) + centralSize > zipSize) {
+    zipFile.close();
+    return false;
+  }
+
+  const uchar *p       = data + centralOffset;
+  const uchar *central = data + centralOffset + centralSize;
+
+  while (central - p >= 46 && get32(p) == CENTRAL_SIGNATURE) {
+    int nameLength    = get16(p + 28);
+    int extraLength   = get16(p + 30);
+    int commentLength = get16(p + 32);
+
+    if (central - p < 46 + nameLength) {
+      break;
+    }
+
+    QByteArray raw((const char *) p + 46,nameLength);
+    QString    name = get16(p + 8) & 0x800 ? QString::fromUtf8(raw)
+                                           : QString::fromLatin1(raw);
+    name.replace('\\','/');
+    if (name.startsWith("ldraw/",Qt::CaseInsensitive)) {
+      name.remove(0,6);
+    }
+
+    if (name != "" && ! name.endsWith('/')) {
+      ZipEntry entry;
+      entry.name       = name;
+      entry.method     = get16(p + 10);
+      entry.time       = dosTime(get16(p + 14),get16(p + 12));
+      entry.compressed = get32(p + 20);
+      entry.size       = get32(p + 24);
+      entry.offset     = get32(p + 42);
+
+      QString key   = name.toLower();
+      int     slash = key.lastIndexOf('/');
+      zipEntries.insert(key,entry);
+      zipDirs[key.left(slash + 1)] << name.mid(slash + 1);
+    }
+    p += 46 + nameLength + extraLength + commentLength;
+  }
+
+  // the central directory holds the CRC of every file, so it names
+  // what is in the zip
+
+  QByteArray digest = QCryptographicHash::hash(
+                        QByteArray::fromRawData((const char *) data + centralOffset,
+                                                centralSize),
+                        QCryptographicHash::Sha1);
+
+  zipScratch = QDesktopServices::storageLocation(QDesktopServices::DataLocation) +
+               "/LDrawZip/" + QString(digest.toHex());
+  zipPath = path;
+  zipData = data;
+  return true;
+}
+
+/*
+ * The name in the zip of a path under the LDraw directory.
+ */
+
+bool LDrawZip::member(const QString &fileName, QString &name)
+{
+  if ( ! open() ||
+       ! fileName.startsWith(zipPath,Qt::CaseInsensitive) ||
+       fileName.size() <= zipPath.size() ||
+       (fileName[zipPath.size()] != '/' && fileName[zipPath.size()] != '\\')) {
+    return false;
+  }
+  name = fileName.mid(zipPath.size() + 1).toLower();
+  name.replace('\\','/');
+  name.replace("//","/");
+  return true;
+}
+
+static bool unpack(const ZipEntry &entry, QByteArray &contents, int limit)
+{
+  const uchar *local = zipData + entry.offset;
+
+  if (qint64(entry.offset) + 30 > zipSize || get32(local) != LOCAL_SIGNATURE) {
+    return false;
+  }
+
+  const uchar *data = local + 30 + get16(local + 26) + get16(local + 28);
+
+  if (data + entry.compressed > zipData + zipSize) {
+    return false;
+  }
+
+  int want = limit < 0 ? int(entry.size) : qMin(int(entry.size),limit);
+
+  if (entry.method == 0) {
+    contents = QByteArray((const char *) data,want);
+    return true;
+  }
+  if (entry.method != 8) {
+    return false;
+  }
+
+  contents.resize(want);
+
+  z_stream stream;
+  memset(&stream,0,sizeof(stream));
+  if (inflateInit2(&stream,-MAX_WBITS) != Z_OK) {
+    return false;
+  }
+  stream.next_in   = (Bytef *) data;
+  stream.avail_in  = entry.compressed;
+  stream.next_out  = (Bytef *) contents.data();
+  stream.avail_out = want;
+
+  int rc = inflate(&stream,Z_FINISH);
+  inflateEnd(&stream);
+
+  // with a limit we stop when we have enough
+
+  if (rc != Z_STREAM_END && ! (limit >= 0 && stream.avail_out == 0)) {
+    return false;
+  }
+  contents.resize(want - stream.avail_out);
+  return true;
+}
+
+bool LDrawZip::exists(const QString &fileName)
+{
+  QString name;
+
+  if (member(fileName,name)) {
+    return zipEntries.contains(name);
+  }
+  return QFile::exists(fileName);
+}
+
+bool LDrawZip::read(const QString &fileName, QByteArray &contents, int limit)
+{
+  QString name;
+
+  if (member(fileName,name)) {
+    QHash<QString, ZipEntry>::const_iterator i = zipEntries.constFind(name);
+    return i != zipEntries.constEnd() && unpack(i.value(),contents,limit);
+  }
+
+  QFile file(fileName);
+  if ( ! file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  contents = limit < 0 ? file.readAll() : file.read(limit);
+  return true;
+}
+
+QStringList LDrawZip::entryList(const QString &dirName)
+{
+  QString name;
+
+  if (member(dirName,name)) {
+    if (name != "" && ! name.endsWith('/')) {
+      name += '/';
+    }
+    return zipDirs.value(name);
+  }
+  return QDir(dirName).entryList(QDir::Files);
+}
+
+/*
+ * Directories in a zip change when the zip does.
+ */
+
+quint32 LDrawZip::lastModified(const QString &fileName)
+{
+  QString name;
+
+  if (member(fileName,name)) {
+    QHash<QString, ZipEntry>::const_iterator i = zipEntries.constFind(name);
+    if (i != zipEntries.constEnd()) {
+      return i.value().time;
+    }
+    return QFileInfo(zipPath).lastModified().toTime_t();
+  }
+
+  QFileInfo info(fileName);
+  return info.exists() ? info.lastModified().toTime_t() : 0;
+}
+
+QString LDrawZip::rendererPath()
+{
+  return open() ? zipScratch : Preferences::ldrawPath;
+}
+
+/*
+ * The files a file uses.
+ */
+
+static void references(const QByteArray &contents, QStringList &names)
+{
+  QTextStream in(contents);
+
+  while ( ! in.atEnd()) {
+    QString     line = in.readLine(0);
+    QStringList tokens;
+
+    split(line,tokens);
+    if (tokens.size() == 15 && tokens[0] == "1") {
+      names << tokens[14].toLower().replace('\\','/');
+    }
+  }
+}
+
+/*
+ * Copy a file out of the zip into the scratch library, under another
+ * name first so a renderer never sees half of it.
+ */
+
+static bool extract(const ZipEntry &entry, QByteArray &contents)
+{
+  if ( ! unpack(entry,contents,-1)) {
+    return false;
+  }
+
+  QString fileName = zipScratch + "/" + entry.name;
+
+  if (QFile::exists(fileName)) {
+    return true;
+  }
+
+  QDir().mkpath(QFileInfo(fileName).absolutePath());
+
+  QString partial = QString("%1.%2.tmp")
+                      .arg(fileName)
+                      .arg(QCoreApplication::applicationPid());
+  QFile file(partial);
+  if ( ! file.open(QIODevice::WriteOnly) ||
+         file.write(contents) != contents.size()) {
+    file.remove();
+    return false;
+  }
+  file.close();
+
+  if ( ! QFile::rename(partial,fileName)) {
+    QFile::remove(partial);
+  }
+  return true;
+}
+
+void LDrawZip::extractFor(const QString &ldrName, const QString &modelDir)
+{
+  if ( ! open()) {
+    return;
+  }
+
+  // renders can run on more than one thread
+
+  static QMutex        extractMutex;
+  static QSet<QString> extracted;    // library files that are out, with what they use
+
+  QMutexLocker locker(&extractMutex);
+
+  QByteArray  contents;
+  QStringList pending;
+
+  if ( ! extracted.contains("ldconfig.ldr")) {
+    QHash<QString, ZipEntry>::const_iterator i = zipEntries.constFind("ldconfig.ldr");
+    if (i != zipEntries.constEnd() && extract(i.value(),contents)) {
+      extracted.insert("ldconfig.ldr");
+    }
+  }
+
+  QFile file(ldrName);
+  if ( ! file.open(QIODevice::ReadOnly)) {
+    return;
+  }
+  references(file.readAll(),pending);
+  file.close();
+
+  const QStringList &roots = LibraryIndex::roots();
+  QString            tmpDir = modelDir == "" ? QDir::currentPath() + "/" + Paths::tmpDir + "/"
+                                             : modelDir + "/";
+  QSet<QString>      seen;
+
+  while (pending.size()) {
+    QString name = pending.takeFirst();
+
+    if (seen.contains(name) || extracted.contains(name)) {
+      continue;
+    }
+    seen.insert(name);
+
+    // submodels are written to the tmp directory for the renderers
+
+    QFile submodel(tmpDir + name);
+    if (submodel.open(QIODevice::ReadOnly)) {
+      references(submodel.readAll(),pending);
+      continue;
+    }
+
+    for (int r = 0; r < roots.size(); r++) {
+      QHash<QString, ZipEntry>::const_iterator i =
+        zipEntries.constFind(roots[r].mid(1).toLower() + name);
+
+      if (i != zipEntries.constEnd()) {
+        if (extract(i.value(),contents)) {
+          extracted.insert(name);
+          references(contents,pending);
+        }
+        break;
+      }
+    }
+  }
+}
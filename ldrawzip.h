@@ -0,0 +1,82 @@
+
+/****************************************************************************
+**
+** Copyright (C) 2007-2009 Kevin Clague. All rights reserved.
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.trolltech.com/products/qt/opensource.html
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+/****************************************************************************
+ *
+ * This class lets the LDraw library be the complete.zip it is
+ * distributed as, rather than a directory.  When Preferences::ldrawPath
+ * names a zip file, its central directory is read once, and from then
+ * on the files in it are found and read straight from the (memory
+ * mapped) zip.  A path under ldrawPath, like ldrawPath + "/parts/3001.dat",
+ * means the same thing either way.
+ *
+ * The renderers are separate programs that want a real directory, so
+ * before each render the parts it needs (and everything they use) are
+ * copied out of the zip into a scratch library.  The scratch library is
+ * named after the zip's contents, so every project, and every run of
+ * LPub, using the same zip shares it, and files are never copied out
+ * twice.
+ *
+ * Please see lpub.h for an overall description of how the files in LPub
+ * make up the LPub program.
+ *
+ ***************************************************************************/
+
+#ifndef LDRAWZIP_H
+#define LDRAWZIP_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+class LDrawZip {
+  public:
+    LDrawZip() {}
+
+    static bool isZip(const QString &path);
+
+    /*
+     * These take the path of something in the LDraw library, and work
+     * whether it is a directory or a zip.  read reads at most limit
+     * bytes, if limit is not negative.
+     */
+
+    static bool        exists(const QString &fileName);
+    static bool        read(const QString &fileName, QByteArray &contents, int limit = -1);
+    static QStringList entryList(const QString &dirName);
+    static quint32     lastModified(const QString &fileName);
+
+    /*
+     * The LDraw directory to give the renderers.
+     */
+
+    static QString rendererPath();
+
+    /*
+     * Copy what ldrName uses from the zip into the renderers' library.
+     * The submodels ldrName uses are looked for in modelDir, which is
+     * LPub's temporary directory unless given.
+     */
+
+    static void extractFor(const QString &ldrName, const QString &modelDir = QString());
+
+  private:
+    static bool open();
+    static bool member(const QString &fileName, QString &name);
+};
+
+#endif
@@ -0,0 +1,490 @@
+
+/****************************************************************************
+**
+** Copyright (C) 2007-2009 Kevin Clague. All rights reserved.
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.trolltech.com/products/qt/opensource.html
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+/****************************************************************************
+ *
+ * This file implements the index of the LDraw library.
+ *
+ * The index file is
+ *
+ *   header    magic number, version, number of buckets, number of roots
+ *   ldraw     the LDraw directory it was made for
+ *   roots     when each of the roots was last changed
+ *   buckets   where each name's entry is in the file, or 0 for none
+ *   entries   for each name: its file's time, then the name, the path,
+ *             the title and the category
+ *
+ * Numbers are 32 bits, and strings are a 16 bit length followed by
+ * UTF-8, all in the byte order of the machine, since the index never
+ * leaves it.
+ *
+ * Please see lpub.h for an overall description of how the files in LPub
+ * make up the LPub program.
+ *
+ ***************************************************************************/
+
+#include <string.h>
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDesktopServices>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFuture>
+#include <QHash>
+#include <QTextStream>
+#include <QVector>
+#include <QtConcurrentRun>
+
+#include "libraryindex.h"
+#include "ldrawzip.h"
+#include "lpub_preferences.h"
+
+#define INDEX_MAGIC   0x5844494c
+#define INDEX_VERSION 1
+#define HEADER_SIZE   16
+
+class IndexEntry {
+  public:
+    quint32 time;
+    QString path;
+    QString title;
+    QString category;
+};
+
+static QFile         indexFile;
+static const uchar  *indexData    = NULL;
+static qint64        indexSize    = 0;
+static const uchar  *bucketData   = NULL;
+static quint32       indexBuckets = 0;
+static QFuture<bool> building;
+static bool          buildStarted = false;
+
+const QStringList &LibraryIndex::roots()
+{
+  static QStringList paths;
+
+  if (paths.size() == 0) {
+    paths << "/parts/" << "/parts/s/" << "/p/" << "/p/48/" <<
+             "/Unofficial/parts/" << "/Unofficial/p/" <<
+             "/Unofficial/LSynth/" <<
+             "/Helpers/" << "/Custom/" << "/Development/";
+  }
+  return paths;
+}
+
+QString LibraryIndex::indexName()
+{
+  return QDesktopServices::storageLocation(
+           QDesktopServices::DataLocation) + "/LibraryIndex";
+}
+
+/*
+ * Reading and writing the pieces of the index
+ */
+
+static quint32 get32(const uchar *data)
+{
+  quint32 value;
+  memcpy(&value,data,sizeof(value));
+  return value;
+}
+
+static quint16 get16(const uchar *data)
+{
+  quint16 value;
+  memcpy(&value,data,sizeof(value));
+  return value;
+}
+
+static const uchar *getString(const uchar *data, QString &string)
+{
+  quint16 length = get16(data);
+  string = QString::fromUtf8((const char *) data + 2,length);
+  return data + 2 + length;
+}
+
+static void put32(QByteArray &out, quint32 value)
+{
+  out.append((const char *) &value,sizeof(value));
+}
+
+static void putString(QByteArray &out, const QString &string)
+{
+  QByteArray utf8 = string.toUtf8().left(0xffff);
+  quint16    length = utf8.size();
+  out.append((const char *) &length,sizeof(length));
+  out.append(utf8);
+}
+
+static const uchar *getEntry(const uchar *data, IndexEntry &entry, QString &name)
+{
+  entry.time = get32(data);
+  data = getString(data + 4,name);
+  data = getString(data,entry.path);
+  data = getString(data,entry.title);
+  return getString(data,entry.category);
+}
+
+/* FNV-1a, so the index means the same thing to every build of LPub */
+
+static quint32 hashName(const QByteArray &name)
+{
+  quint32 hash = 2166136261u;
+  for (int i = 0; i < name.size(); i++) {
+    hash ^= (uchar) name[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static quint32 lastChanged(const QString &path)
+{
+  return LDrawZip::lastModified(path);
+}
+
+/*
+ * Check the header of an index.  If ldrawPath is given, the index must
+ * also be up to date with it.  Returns where the buckets start.
+ */
+
+static const uchar *checkHeader(
+  const uchar   *data,
+  qint64         size,
+  const QString &ldrawPath,
+  bool           current,
+  quint32       &buckets)
+{
+  if (size < HEADER_SIZE ||
+      get32(data) != INDEX_MAGIC ||
+      get32(data + 4) != INDEX_VERSION) {
+    return NULL;
+  }
+  buckets = get32(data + 8);
+
+  const QStringList &roots = LibraryIndex::roots();
+  int numRoots = get32(data + 12);
+
+  const uchar *end = data + size;
+  const uchar *p   = data + HEADER_SIZE;
+  QString      path;
+
+  if (end - p < 2 || end - p < 2 + get16(p)) {
+    return NULL;
+  }
+  p = getString(p,path);
+  if (path != ldrawPath || numRoots != roots.size() ||
+      end - p < 4*(qint64(numRoots) + buckets)) {
+    return NULL;
+  }
+  for (int r = 0; r < numRoots; r++, p += 4) {
+    if (current && get32(p) != lastChanged(ldrawPath + roots[r])) {
+      return NULL;
+    }
+  }
+  return p;
+}
+
+bool LibraryIndex::load()
+{
+  indexFile.setFileName(indexName());
+  if ( ! indexFile.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+
+  qint64       size = indexFile.size();
+  const uchar *data = indexFile.map(0,size);
+  quint32      buckets;
+
+  const uchar *p = data ? checkHeader(data,size,Preferences::ldrawPath,true,buckets)
+                        : NULL;
+
+  if (p == NULL || buckets == 0 || (buckets & (buckets - 1))) {
+    indexFile.close();
+    return false;
+  }
+
+  indexData    = data;
+  indexSize    = size;
+  bucketData   = p;
+  indexBuckets = buckets;
+  return true;
+}
+
+void LibraryIndex::open()
+{
+  if (indexData || buildStarted) {
+    return;
+  }
+  if (load()) {
+    return;
+  }
+  buildStarted = true;
+  building = QtConcurrent::run(&LibraryIndex::build,
+                               Preferences::ldrawPath,
+                               indexName());
+}
+
+bool LibraryIndex::ready()
+{
+  if (indexData == NULL && buildStarted && building.isFinished()) {
+    buildStarted = false;
+    if (building.result()) {
+      load();
+    }
+  }
+  return indexData != NULL;
+}
+
+bool LibraryIndex::find(
+  const QString &name,
+  QString       *path,
+  QString       *title,
+  QString       *category)
+{
+  if ( ! ready()) {
+    return false;
+  }
+
+  QString lower = name.toLower();
+  lower.replace('\\','/');
+  QByteArray key = lower.toUtf8();
+
+  quint32 mask = indexBuckets - 1;
+
+  for (quint32 h = hashName(key) & mask; ; h = (h + 1) & mask) {
+    quint32 at = get32(bucketData + 4*h);
+
+    if (at == 0 || at + 6 > indexSize) {
+      return false;
+    }
+
+    const uchar *p = indexData + at + 4;
+
+    if (get16(p) == key.size() && memcmp(p + 2,key.constData(),key.size()) == 0) {
+      IndexEntry entry;
+      QString    entryName;
+
+      getEntry(indexData + at,entry,entryName);
+      if (path) {
+        *path = entry.path;
+      }
+      if (title) {
+        *title = entry.title;
+      }
+      if (category) {
+        *category = entry.category;
+      }
+      return true;
+    }
+  }
+}
+
+/*
+ * The title is the first line of a part's file, and the category is
+ * given by a !CATEGORY line, or else is the first word of the title.
+ */
+
+static void readHeader(const QString &fileName, IndexEntry &entry)
+{
+  QByteArray contents;
+  if ( ! LDrawZip::read(fileName,contents,4096)) {
+    return;
+  }
+
+  QTextStream in(contents);
+
+  for (int n = 0; n < 20 && ! in.atEnd(); n++) {
+    QString line = in.readLine(0).trimmed();
+    if (line.isEmpty()) {
+      continue;
+    }
+    if (line[0] != '0') {
+      break;
+    }
+    if (n == 0) {
+      while (line.size() && (line[0] == '0' || line[0] == ' ' ||
+                             line[0] == '~' || line[0] == '_')) {
+        line.remove(0,1);
+      }
+      entry.title = line;
+    } else if (line.startsWith("0 !CATEGORY ")) {
+      entry.category = line.mid(12).trimmed();
+    }
+  }
+
+  if (entry.category.isEmpty()) {
+    entry.category = entry.title.section(' ',0,0);
+    while (entry.category.size() && (entry.category[0] == '=' ||
+                                     entry.category[0] == '|')) {
+      entry.category.remove(0,1);
+    }
+  }
+}
+
+/*
+ * What an old index says about each file, by path, so files that have
+ * not changed don't need to be read again.
+ */
+
+static void readEntries(
+  const QString              &indexName,
+  const QString              &ldrawPath,
+  QHash<QString, IndexEntry> &entries)
+{
+  QFile file(indexName);
+  if ( ! file.open(QIODevice::ReadOnly)) {
+    return;
+  }
+
+  QByteArray   contents = file.readAll();
+  const uchar *data = (const uchar *) contents.constData();
+  quint32      buckets;
+
+  const uchar *p = checkHeader(data,contents.size(),ldrawPath,false,buckets);
+  if (p == NULL) {
+    return;
+  }
+
+  for (quint32 b = 0; b < buckets; b++) {
+    quint32 at = get32(p + 4*b);
+    if (at != 0 && at < quint32(contents.size())) {
+      IndexEntry entry;
+      QString    name;
+      getEntry(data + at,entry,name);
+      entries[entry.path] = entry;
+    }
+  }
+}
+
+bool LibraryIndex::build(const QString &ldrawPath, const QString &indexName)
+{
+  QHash<QString, IndexEntry> known;
+  readEntries(indexName,ldrawPath,known);
+
+  const QStringList  &dirs = roots();
+  QList<IndexEntry>   entries;
+  QHash<QString, int> names;
+  QList<quint32>      times;
+
+  for (int r = 0; r < dirs.size(); r++) {
+    QString dir = ldrawPath + dirs[r];
+
+    times << lastChanged(dir);
+
+    QStringList files = LDrawZip::entryList(dir);
+
+    foreach (QString fileName, files) {
+      IndexEntry entry;
+
+      entry.path = dirs[r].mid(1) + fileName;
+      entry.time = lastChanged(dir + fileName);
+
+      QHash<QString, IndexEntry>::const_iterator old = known.constFind(entry.path);
+      if (old != known.constEnd() && old.value().time == entry.time) {
+        entry = old.value();
+      } else {
+        readHeader(dir + fileName,entry);
+      }
+
+      int e = entries.size();
+      entries << entry;
+
+      // the first directory searched wins, and a file in a directory
+      // under another one (parts/s) is also found by its name from
+      // there (s\3001s01.dat)
+
+      QString name = fileName.toLower();
+      if ( ! names.contains(name)) {
+        names.insert(name,e);
+      }
+      for (int p = 0; p < r; p++) {
+        if (dirs[r].startsWith(dirs[p],Qt::CaseInsensitive)) {
+          QString longer = (dirs[r].mid(dirs[p].size()) + fileName).toLower();
+          if ( ! names.contains(longer)) {
+            names.insert(longer,e);
+          }
+        }
+      }
+    }
+  }
+
+  // at most half full, so probes stay short
+
+  quint32 buckets = 16;
+  while (buckets < quint32(2*names.size())) {
+    buckets *= 2;
+  }
+
+  QByteArray out;
+  put32(out,INDEX_MAGIC);
+  put32(out,INDEX_VERSION);
+  put32(out,buckets);
+  put32(out,dirs.size());
+  putString(out,ldrawPath);
+  foreach (quint32 time, times) {
+    put32(out,time);
+  }
+
+  int bucketsAt = out.size();
+  out.append(QByteArray(4*buckets,'\0'));
+
+  QVector<quint32> bucket(buckets,0);
+  quint32          mask = buckets - 1;
+
+  QHash<QString, int>::const_iterator i;
+  for (i = names.constBegin(); i != names.constEnd(); ++i) {
+    const IndexEntry &entry = entries[i.value()];
+
+    quint32 h = hashName(i.key().toUtf8()) & mask;
+    while (bucket[h]) {
+      h = (h + 1) & mask;
+    }
+    bucket[h] = out.size();
+
+    put32(out,entry.time);
+    putString(out,i.key());
+    putString(out,entry.path);
+    putString(out,entry.title);
+    putString(out,entry.category);
+  }
+  memcpy(out.data() + bucketsAt,bucket.constData(),4*buckets);
+
+  // write it under another name and rename it, so nobody maps half an
+  // index
+
+  QDir().mkpath(QFileInfo(indexName).absolutePath());
+
+  QString partial = QString("%1.%2.tmp")
+                      .arg(indexName)
+                      .arg(QCoreApplication::applicationPid());
+  QFile file(partial);
+  if ( ! file.open(QIODevice::WriteOnly) ||
+         file.write(out) != out.size()) {
+    file.remove();
+    return false;
+  }
+  file.close();
+
+  QFile::remove(indexName);
+  if ( ! QFile::rename(partial,indexName)) {
+    QFile::remove(partial);
+    return false;
+  }
+  return true;
+}
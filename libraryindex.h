@@ -0,0 +1,83 @@
+
+/****************************************************************************
+**
+** Copyright (C) 2007-2009 Kevin Clague. All rights reserved.
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.trolltech.com/products/qt/opensource.html
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+/****************************************************************************
+ *
+ * This class keeps an index of the whole LDraw library, so finding out
+ * whether a part exists, where it is, and what its title and category
+ * are, is a lookup rather than a search of the library directories.
+ *
+ * The index is a file laid out as a hash table, which is memory mapped
+ * and looked things up in where it is, so opening it costs nothing.  It
+ * remembers when each library directory was last changed, and if any of
+ * them has changed since (or there is no index yet) a new one is built
+ * in the background.  Parts whose files have not changed keep what the
+ * old index said about them, so only new and changed files are read.
+ * Until the new index is ready, callers go on as they did without one.
+ *
+ * Please see lpub.h for an overall description of how the files in LPub
+ * make up the LPub program.
+ *
+ ***************************************************************************/
+
+#ifndef LIBRARYINDEX_H
+#define LIBRARYINDEX_H
+
+#include <QString>
+#include <QStringList>
+
+class LibraryIndex {
+  public:
+    LibraryIndex() {}
+
+    /*
+     * The library directories searched for parts, in the order they are
+     * searched.
+     */
+
+    static const QStringList &roots();
+
+    /*
+     * Map the index if it is up to date, or start building it if not.
+     */
+
+    static void open();
+
+    /*
+     * Is there an index to look in?
+     */
+
+    static bool ready();
+
+    /*
+     * Look up a part by the name it is referenced by.  path is relative
+     * to the LDraw directory.
+     */
+
+    static bool find(
+      const QString &name,
+      QString       *path     = 0,
+      QString       *title    = 0,
+      QString       *category = 0);
+
+  private:
+    static bool    load();
+    static bool    build(const QString &ldrawPath, const QString &indexName);
+    static QString indexName();
+};
+
+#endif
@@ -0,0 +1,256 @@
+
+/****************************************************************************
+**
+** Copyright (C) 2007-2009 Kevin Clague. All rights reserved.
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.trolltech.com/products/qt/opensource.html
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+/****************************************************************************
+ *
+ * This file implements the compact storage for the lines of LDraw files.
+ *
+ * Please see lpub.h for an overall description of how the files in LPub
+ * make up the LPub program.
+ *
+ ***************************************************************************/
+
+#include "linearena.h"
+
+/*
+ * Don't bother compacting small files just because they were edited.
+ */
+
+#define MIN_GARBAGE (64*1024)
+
+LineSpan LineArena::add(const QString &line)
+{
+  QByteArray utf8 = line.toUtf8();
+  LineSpan   span;
+
+  span.offset = _text.size();
+  span.length = utf8.size();
+  span.chars  = line.size();
+  _text.append(utf8);
+
+  return span;
+}
+
+/*
+ * Every UTF-8 sequence but a continuation byte starts a character, and
+ * four byte sequences take two QChars.
+ */
+
+static int utf16Length(const char *data, int length)
+{
+  int chars = 0;
+
+  for (int i = 0; i < length; i++) {
+    unsigned char c = data[i];
+    if ((c & 0xc0) != 0x80) {
+      chars += c >= 0xf0 ? 2 : 1;
+    }
+  }
+  return chars;
+}
+
+void LineArena::appendUtf8(const char *data, int length)
+{
+  LineSpan span;
+
+  span.offset = _text.size();
+  span.length = length;
+  span.chars  = utf16Length(data,length);
+  _text.append(data,length);
+  _spans.append(span);
+}
+
+void LineArena::append(const QString &line)
+{
+  _spans.append(add(line));
+}
+
+void LineArena::insert(int i, const QString &line)
+{
+  _spans.insert(i,add(line));
+  changed(i);
+}
+
+void LineArena::replace(int i, const QString &line)
+{
+  int old = _spans[i].length;
+
+  _spans[i] = add(line);
+  changed(i);
+  collect(old);
+}
+
+void LineArena::removeAt(int i)
+{
+  int old = _spans[i].length;
+
+  _spans.remove(i);
+  changed(i);
+  collect(old);
+}
+
+void LineArena::replace(int first, int count, const QStringList &lines)
+{
+  int old = 0;
+
+  for (int i = first; i < first + count; i++) {
+    old += _spans[i].length;
+  }
+
+  int common = qMin(count,lines.size());
+
+  for (int i = 0; i < common; i++) {
+    _spans[first + i] = add(lines[i]);
+  }
+  if (count > common) {
+    _spans.remove(first + common,count - common);
+  } else if (lines.size() > common) {
+    LineSpan empty = { 0, 0, 0 };
+    _spans.insert(first + common,lines.size() - common,empty);
+    for (int i = common; i < lines.size(); i++) {
+      _spans[first + i] = add(lines[i]);
+    }
+  }
+  changed(first);
+  collect(old);
+}
+
+void LineArena::clear()
+{
+  _text.clear();
+  _spans.clear();
+  _garbage = 0;
+  _known = 0;
+}
+
+int LineArena::position(int line) const
+{
+  if (_starts.size() != _spans.size()) {
+    _starts.resize(_spans.size());
+    _known = qMin(_known,_spans.size());
+  }
+  if (line >= _spans.size()) {
+    return _spans.size() ? position(_spans.size() - 1) + _spans.last().chars
+                         : 0;
+  }
+  if (_known == 0) {
+    _starts[0] = 0;
+    _known = 1;
+  }
+  for ( ; _known <= line; _known++) {
+    _starts[_known] = _starts[_known - 1] + _spans[_known - 1].chars + 1;
+  }
+  return _starts[line];
+}
+
+void LineArena::locate(int pos, int &line, int &column) const
+{
+  if (_spans.isEmpty()) {
+    line = 0;
+    column = pos;
+    return;
+  }
+
+  int last = _spans.size() - 1;
+
+  position(last);
+
+  // the last line whose start is at or before pos
+
+  int lo = 0, hi = last;
+  while (lo < hi) {
+    int mid = (lo + hi + 1)/2;
+    if (_starts[mid] <= pos) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  line = lo;
+  column = pos - _starts[lo];
+}
+
+QString LineArena::mid(int pos, int count) const
+{
+  QString text;
+  int     line, column;
+
+  locate(pos,line,column);
+
+  while (count > 0 && line < _spans.size()) {
+    QString chars = at(line);
+    QString piece = chars.mid(column,count);
+    text  += piece;
+    count -= piece.size();
+    if (count > 0 && ++line < _spans.size()) {
+      text += '\n';
+      count--;
+    }
+    column = 0;
+  }
+  return text;
+}
+
+void LineArena::collect(int bytes)
+{
+  _garbage += bytes;
+
+  if (_garbage > MIN_GARBAGE && _garbage > _text.size()/2) {
+    compact();
+  }
+}
+
+void LineArena::setLines(const QStringList &lines)
+{
+  clear();
+  _spans.reserve(lines.size());
+
+  for (int i = 0; i < lines.size(); i++) {
+    append(lines[i]);
+  }
+}
+
+QStringList LineArena::toStringList() const
+{
+  QStringList lines;
+
+  lines.reserve(_spans.size());
+
+  for (int i = 0; i < _spans.size(); i++) {
+    lines << at(i);
+  }
+  return lines;
+}
+
+void LineArena::compact()
+{
+  if (_garbage == 0) {
+    return;
+  }
+
+  QByteArray text;
+  text.reserve(_text.size() - _garbage);
+
+  for (int i = 0; i < _spans.size(); i++) {
+    LineSpan &span = _spans[i];
+    int offset = text.size();
+    text.append(_text.constData() + span.offset,span.length);
+    span.offset = offset;
+  }
+  _text = text;
+  _garbage = 0;
+}
@@ -0,0 +1,161 @@
+
+/****************************************************************************
+**
+** Copyright (C) 2007-2009 Kevin Clague. All rights reserved.
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.trolltech.com/products/qt/opensource.html
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+/****************************************************************************
+ *
+ * This class holds the lines of an LDraw file in memory.  Rather than a
+ * QString per line (two bytes a character, plus a heap block and its
+ * overhead for every line), the text of all the lines is kept as UTF-8
+ * in one buffer, with a table of where each line starts and how long it
+ * is.  LDraw is nearly all ASCII, so this takes a fraction of the memory
+ * and loading a file makes a handful of allocations instead of one per
+ * line.
+ *
+ * Changed and inserted lines are added to the end of the buffer and the
+ * table is pointed at them.  The text they replace stays in the buffer
+ * until compact() is called (LDrawFile does that when it saves), or
+ * until it is more than half of the buffer.
+ *
+ * Please see lpub.h for an overall description of how the files in LPub
+ * make up the LPub program.
+ *
+ ***************************************************************************/
+
+#ifndef LINEARENA_H
+#define LINEARENA_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class LineSpan {
+  public:
+    int offset;
+    int length;    // in bytes
+    int chars;     // in QChars, as the editor counts them
+};
+
+Q_DECLARE_TYPEINFO(LineSpan, Q_PRIMITIVE_TYPE);
+
+class LineArena {
+  public:
+    LineArena()
+    {
+      _garbage = 0;
+      _known = 0;
+    }
+    LineArena(const QStringList &lines)
+    {
+      _garbage = 0;
+      _known = 0;
+      setLines(lines);
+    }
+
+    int size() const
+    {
+      return _spans.size();
+    }
+    bool isEmpty() const
+    {
+      return _spans.isEmpty();
+    }
+    int bytes() const
+    {
+      return _text.size();
+    }
+
+    QString at(int i) const
+    {
+      const LineSpan &span = _spans.at(i);
+      return QString::fromUtf8(_text.constData() + span.offset,span.length);
+    }
+
+    /*
+     * The UTF-8 bytes of a line, without copying them.  The view is only
+     * good until the arena is next changed.
+     */
+
+    QByteArray view(int i) const
+    {
+      const LineSpan &span = _spans.at(i);
+      return QByteArray::fromRawData(_text.constData() + span.offset,span.length);
+    }
+
+    void append(const QString &line);
+    void appendUtf8(const char *data, int length);
+    void insert(int i, const QString &line);
+    void replace(int i, const QString &line);
+    void removeAt(int i);
+    void clear();
+
+    /*
+     * Replace count lines starting at first with lines.
+     */
+
+    void replace(int first, int count, const QStringList &lines);
+
+    /*
+     * The editor sees the file as one string, with the lines joined by
+     * newlines.  These map between positions in that string and lines.
+     * Where the lines start is worked out as it is needed, and only from
+     * the first line changed since it was last worked out.
+     */
+
+    int  position(int line) const;
+    void locate(int position, int &line, int &column) const;
+
+    /*
+     * The text from position, count characters long, as the editor sees
+     * it.
+     */
+
+    QString mid(int position, int count) const;
+
+    void        setLines(const QStringList &lines);
+    QStringList toStringList() const;
+
+    /*
+     * Drop the text of replaced and removed lines, and put the lines back
+     * in order in the buffer.
+     */
+
+    void compact();
+
+    void reserve(int bytes, int lines)
+    {
+      _text.reserve(bytes);
+      _spans.reserve(lines);
+    }
+
+  private:
+    QByteArray        _text;
+    QVector<LineSpan> _spans;
+    int               _garbage;      // bytes of _text no line uses
+
+    mutable QVector<int> _starts;    // position of each line
+    mutable int          _known;     // how many of _starts are right
+
+    LineSpan add(const QString &line);
+    void     collect(int bytes);
+    void     changed(int line)
+    {
+      _known = qMin(_known,line);
+    }
+};
+
+#endif
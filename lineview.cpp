@@ -0,0 +1,278 @@
+
+/****************************************************************************
+**
+** Copyright (C) 2007-2009 Kevin Clague. All rights reserved.
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.trolltech.com/products/qt/opensource.html
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+/****************************************************************************
+ *
+ * This implements the view the editwindow uses for very large submodels.
+ *
+ * Please see lpub.h for an overall description of how the files in LPub
+ * make up the LPub program.
+ *
+ ***************************************************************************/
+
+#include <QtGui>
+
+#include "lineview.h"
+#include "highlighter.h"
+#include "ldrawfiles.h"
+
+LineView::LineView(QWidget *parent)
+  : QAbstractScrollArea(parent)
+{
+  ldrawFile   = NULL;
+  highlighter = new Highlighter();
+  highlighter->setParent(this);
+  editing     = -1;
+  current     = -1;
+  widest      = 0;
+
+  editor = new QLineEdit(viewport());
+  editor->hide();
+  connect(editor, SIGNAL(returnPressed()),   this, SLOT(finishEdit()));
+  connect(editor, SIGNAL(editingFinished()), this, SLOT(cancelEdit()));
+
+  verticalScrollBar()->setSingleStep(1);
+  setFocusPolicy(Qt::StrongFocus);
+}
+
+void LineView::setFile(
+  LDrawFile     *_ldrawFile,
+  const QString &_fileName)
+{
+  ldrawFile = _ldrawFile;
+  fileName  = _fileName;
+  editing   = -1;
+  current   = -1;
+  widest    = 0;
+  editor->hide();
+
+  verticalScrollBar()->setValue(0);
+  horizontalScrollBar()->setValue(0);
+  updateScrollBars();
+  viewport()->update();
+}
+
+int LineView::lines()
+{
+  return ldrawFile ? ldrawFile->size(fileName) : 0;
+}
+
+int LineView::lineHeight()
+{
+  return qMax(1,fontMetrics().lineSpacing());
+}
+
+int LineView::visibleLines()
+{
+  return qMax(1,viewport()->height()/lineHeight());
+}
+
+int LineView::lineAt(int y)
+{
+  return verticalScrollBar()->value() + y/lineHeight();
+}
+
+QString LineView::currentText()
+{
+  if (current < 0 || current >= lines()) {
+    return QString();
+  }
+  return ldrawFile->readLine(fileName,current);
+}
+
+void LineView::updateScrollBars()
+{
+  verticalScrollBar()->setPageStep(visibleLines());
+  verticalScrollBar()->setRange(0,qMax(0,lines() - visibleLines()));
+
+  horizontalScrollBar()->setPageStep(viewport()->width());
+  horizontalScrollBar()->setRange(0,qMax(0,widest - viewport()->width()));
+}
+
+/*
+ * Only the lines on the screen are read, laid out and highlighted.
+ */
+
+void LineView::paintEvent(QPaintEvent *)
+{
+  QPainter painter(viewport());
+
+  int height = lineHeight();
+  int first  = verticalScrollBar()->value();
+  int last   = qMin(lines(),first + visibleLines() + 1);
+  int left   = horizontalScrollBar()->value();
+  int state  = 0;
+  int wider  = widest;
+
+  for (int line = first; line < last; line++) {
+    int     y    = (line - first)*height;
+    QString text = ldrawFile->readLine(fileName,line);
+
+    if (line == current) {
+      painter.fillRect(0,y,viewport()->width(),height,
+                       palette().brush(QPalette::AlternateBase));
+    }
+
+    QList<QTextLayout::FormatRange> ranges;
+    highlighter->formats(text,state,ranges);
+
+    QTextLayout layout(text,font());
+    layout.setAdditionalFormats(ranges);
+    layout.beginLayout();
+    QTextLine textLine = layout.createLine();
+    layout.endLayout();
+
+    layout.draw(&painter,QPointF(-left,y));
+
+    wider = qMax(wider,int(textLine.naturalTextWidth()) + 1);
+  }
+
+  if (wider != widest) {
+    widest = wider;
+    updateScrollBars();
+  }
+}
+
+void LineView::resizeEvent(QResizeEvent *event)
+{
+  QAbstractScrollArea::resizeEvent(event);
+  updateScrollBars();
+}
+
+void LineView::scrollContentsBy(int, int)
+{
+  cancelEdit();
+  viewport()->update();
+}
+
+void LineView::setCurrent(int lineNumber)
+{
+  if (lineNumber < 0 || lineNumber >= lines()) {
+    return;
+  }
+  current = lineNumber;
+
+  QScrollBar *bar = verticalScrollBar();
+  if (current < bar->value()) {
+    bar->setValue(current);
+  } else if (current >= bar->value() + visibleLines()) {
+    bar->setValue(current - visibleLines() + 1);
+  }
+  viewport()->update();
+}
+
+/*
+ * Jumping to a line just sets the scroll bar, so it costs the same for
+ * line 40000 as for line 4.
+ */
+
+void LineView::showLine(int lineNumber)
+{
+  updateScrollBars();
+  verticalScrollBar()->setValue(lineNumber - visibleLines()/4);
+  setCurrent(lineNumber);
+}
+
+void LineView::mousePressEvent(QMouseEvent *event)
+{
+  setCurrent(lineAt(event->y()));
+}
+
+void LineView::mouseDoubleClickEvent(QMouseEvent *event)
+{
+  startEdit(lineAt(event->y()));
+}
+
+void LineView::keyPressEvent(QKeyEvent *event)
+{
+  switch (event->key()) {
+    case Qt::Key_Up:
+      setCurrent(current - 1);
+    break;
+    case Qt::Key_Down:
+      setCurrent(current + 1);
+    break;
+    case Qt::Key_PageUp:
+      setCurrent(qMax(0,current - visibleLines()));
+    break;
+    case Qt::Key_PageDown:
+      setCurrent(qMin(lines() - 1,current + visibleLines()));
+    break;
+    case Qt::Key_Home:
+      setCurrent(0);
+    break;
+    case Qt::Key_End:
+      setCurrent(lines() - 1);
+    break;
+    case Qt::Key_Return:
+    case Qt::Key_Enter:
+    case Qt::Key_F2:
+      startEdit(current);
+    break;
+    case Qt::Key_Escape:
+      cancelEdit();
+      setFocus();
+    break;
+    default:
+      QAbstractScrollArea::keyPressEvent(event);
+    break;
+  }
+}
+
+void LineView::startEdit(int lineNumber)
+{
+  if (lineNumber < 0 || lineNumber >= lines()) {
+    return;
+  }
+  setCurrent(lineNumber);
+  editing = lineNumber;
+
+  int y = (lineNumber - verticalScrollBar()->value())*lineHeight();
+
+  editor->setText(ldrawFile->readLine(fileName,lineNumber));
+  editor->setGeometry(0,y,viewport()->width(),editor->sizeHint().height());
+  editor->show();
+  editor->setFocus();
+}
+
+void LineView::finishEdit()
+{
+  if (editing < 0) {
+    return;
+  }
+
+  int     lineNumber = editing;
+  QString oldLine    = ldrawFile->readLine(fileName,lineNumber);
+  QString newLine    = editor->text();
+
+  editing = -1;
+  editor->hide();
+  setFocus();
+
+  if (newLine != oldLine) {
+    emit lineChanged(lineNumber,oldLine,newLine);
+  }
+  viewport()->update();
+}
+
+void LineView::cancelEdit()
+{
+  if (editing >= 0) {
+    editing = -1;
+    editor->hide();
+  }
+}
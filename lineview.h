@@ -0,0 +1,98 @@
+
+/****************************************************************************
+**
+** Copyright (C) 2007-2009 Kevin Clague. All rights reserved.
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.trolltech.com/products/qt/opensource.html
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+/****************************************************************************
+ *
+ * The editwindow uses this view for submodels too big to load into a
+ * QTextEdit.  It draws only the lines that are on the screen, reading
+ * them from the LDraw file as it goes, and highlights just those lines,
+ * so showing a file or jumping to a line costs the same no matter how
+ * long the file is.
+ *
+ * A line is edited by double clicking it (or pressing Enter or F2),
+ * which opens a line editor over it.  The change goes to the editwindow
+ * when Enter is pressed, and from there through the same undoable path
+ * as typing in the QTextEdit.
+ *
+ * A multi-line comment that starts above the top of the view is not
+ * shown as one.
+ *
+ * Please see lpub.h for an overall description of how the files in LPub
+ * make up the LPub program.
+ *
+ ***************************************************************************/
+
+#ifndef LINEVIEW_H
+#define LINEVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QString>
+
+class LDrawFile;
+class Highlighter;
+class QLineEdit;
+
+class LineView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    LineView(QWidget *parent = 0);
+
+    void setFile(LDrawFile *ldrawFile, const QString &fileName);
+    void showLine(int lineNumber);
+
+    int currentLine()
+    {
+      return current;
+    }
+    QString currentText();
+
+signals:
+    void lineChanged(int lineNumber, const QString &oldLine, const QString &newLine);
+
+protected:
+    void paintEvent(QPaintEvent *event);
+    void resizeEvent(QResizeEvent *event);
+    void mousePressEvent(QMouseEvent *event);
+    void mouseDoubleClickEvent(QMouseEvent *event);
+    void keyPressEvent(QKeyEvent *event);
+    void scrollContentsBy(int dx, int dy);
+
+private slots:
+    void finishEdit();
+    void cancelEdit();
+
+private:
+    LDrawFile   *ldrawFile;
+    QString      fileName;
+    Highlighter *highlighter;
+    QLineEdit   *editor;
+    int          editing;   // the line being edited, or -1
+    int          current;
+    int          widest;    // in pixels, of the lines drawn so far
+
+    int  lines();
+    int  lineHeight();
+    int  visibleLines();
+    int  lineAt(int y);
+    void updateScrollBars();
+    void startEdit(int lineNumber);
+    void setCurrent(int lineNumber);
+};
+
+#endif
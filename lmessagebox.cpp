@@ -0,0 +1,100 @@
+
+/****************************************************************************
+**
+** Copyright (C) 2007-2009 Kevin Clague. All rights reserved.
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.trolltech.com/products/qt/opensource.html
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include <stdio.h>
+#include "lmessagebox.h"
+
+bool LMessageBox::_headless = false;
+int  LMessageBox::_errors   = 0;
+
+void LMessageBox::report(
+  const char    *kind,
+  const QString &title,
+  const QString &text)
+{
+  QString message = text.trimmed();
+  message.replace("\n"," ");
+
+  fprintf(stderr,"%s: %s: %s\n",
+          qPrintable(title),
+          kind,
+          qPrintable(message));
+  fflush(stderr);
+}
+
+/*
+ * When headless, whatever the caller would do by default is what
+ * happens, as if the user had just pressed Enter.
+ */
+
+QMessageBox::StandardButton LMessageBox::warning(
+  QWidget                      *parent,
+  const QString                &title,
+  const QString                &text,
+  QMessageBox::StandardButtons  buttons,
+  QMessageBox::StandardButton   defaultButton)
+{
+  if (_headless) {
+    report("warning",title,text);
+    _errors++;
+    return defaultButton;
+  }
+  return QMessageBox::warning(parent,title,text,buttons,defaultButton);
+}
+
+QMessageBox::StandardButton LMessageBox::critical(
+  QWidget                      *parent,
+  const QString                &title,
+  const QString                &text,
+  QMessageBox::StandardButtons  buttons,
+  QMessageBox::StandardButton   defaultButton)
+{
+  if (_headless) {
+    report("error",title,text);
+    _errors++;
+    return defaultButton;
+  }
+  return QMessageBox::critical(parent,title,text,buttons,defaultButton);
+}
+
+QMessageBox::StandardButton LMessageBox::information(
+  QWidget                      *parent,
+  const QString                &title,
+  const QString                &text,
+  QMessageBox::StandardButtons  buttons,
+  QMessageBox::StandardButton   defaultButton)
+{
+  if (_headless) {
+    report("info",title,text);
+    return defaultButton;
+  }
+  return QMessageBox::information(parent,title,text,buttons,defaultButton);
+}
+
+QMessageBox::StandardButton LMessageBox::question(
+  QWidget                      *parent,
+  const QString                &title,
+  const QString                &text,
+  QMessageBox::StandardButtons  buttons,
+  QMessageBox::StandardButton   defaultButton)
+{
+  if (_headless) {
+    report("question",title,text);
+    return defaultButton;
+  }
+  return QMessageBox::question(parent,title,text,buttons,defaultButton);
+}
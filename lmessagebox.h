@@ -0,0 +1,94 @@
+
+/****************************************************************************
+**
+** Copyright (C) 2007-2009 Kevin Clague. All rights reserved.
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.trolltech.com/products/qt/opensource.html
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+/****************************************************************************
+ *
+ * LPub tells the user about problems through these rather than through
+ * QMessageBox directly.  Normally they are just QMessageBox, but when
+ * LPub runs headless (from the command line, see batch.h) nobody is
+ * there to click OK, so the messages go to stderr instead, and warnings
+ * and errors are counted so the command can fail.
+ *
+ * Please see lpub.h for an overall description of how the files in LPub
+ * make up the LPub program.
+ *
+ ***************************************************************************/
+
+#ifndef LMESSAGEBOX_H
+#define LMESSAGEBOX_H
+
+#include <QMessageBox>
+
+class LMessageBox {
+  public:
+    static QMessageBox::StandardButton warning(
+      QWidget                        *parent,
+      const QString                  &title,
+      const QString                  &text,
+      QMessageBox::StandardButtons    buttons = QMessageBox::Ok,
+      QMessageBox::StandardButton     defaultButton = QMessageBox::NoButton);
+
+    static QMessageBox::StandardButton critical(
+      QWidget                        *parent,
+      const QString                  &title,
+      const QString                  &text,
+      QMessageBox::StandardButtons    buttons = QMessageBox::Ok,
+      QMessageBox::StandardButton     defaultButton = QMessageBox::NoButton);
+
+    static QMessageBox::StandardButton information(
+      QWidget                        *parent,
+      const QString                  &title,
+      const QString                  &text,
+      QMessageBox::StandardButtons    buttons = QMessageBox::Ok,
+      QMessageBox::StandardButton     defaultButton = QMessageBox::NoButton);
+
+    static QMessageBox::StandardButton question(
+      QWidget                        *parent,
+      const QString                  &title,
+      const QString                  &text,
+      QMessageBox::StandardButtons    buttons = QMessageBox::Yes | QMessageBox::No,
+      QMessageBox::StandardButton     defaultButton = QMessageBox::NoButton);
+
+    static void setHeadless(bool headless)
+    {
+      _headless = headless;
+    }
+    static bool headless()
+    {
+      return _headless;
+    }
+
+    /*
+     * The number of warnings and errors reported while headless.
+     */
+
+    static int errors()
+    {
+      return _errors;
+    }
+
+  private:
+    static bool _headless;
+    static int  _errors;
+
+    static void report(
+      const char    *kind,
+      const QString &title,
+      const QString &text);
+};
+
+#endif
@@ -21,7 +21,11 @@
 #include <QTextEdit>
 #include <QCloseEvent>
 #include <QUndoStack>
+#include <QTimer>
 #include <QTextStream>
+#include <QInputDialog>
+#include <QProgressDialog>
+#include <QMessageBox>
 
 #include "lpub.h"
 #include "editwindow.h"
@@ -32,6 +36,9 @@
 #include "lpub_preferences.h"
 #include "render.h"
 #include "metaitem.h"
+#include "pli.h"
+#include "plilibrary.h"
+#include "lmessagebox.h"
 
 Gui *gui;
 
@@ -64,7 +71,7 @@ void Gui::appendCoverPage()
   mi.appendCoverPage();
   countPages();
   ++displayPageNum;
-  displayPage();  // display the page we just added
+  redrawLater();  // display the page we just added
 }
 
 void Gui::insertNumberedPage()
@@ -111,7 +118,7 @@ void Gui::removeLPubFormatting()
   MetaItem mi;
   mi.removeLPubFormatting();
   displayPageNum = 1;
-  displayPage();
+  redrawLater();
 }
 
 void Gui::displayPage()
@@ -338,6 +345,139 @@ void Gui::clearCSICache()
   }
 }
 
+/*
+ * Render parts list images into the shared library ahead of time, so
+ * new projects find them there.  The parts come from an LDraw file, and
+ * are rendered either in the colors they have in the file, or in each
+ * of a list of colors.  The current project's parts list settings are
+ * used, since those are what the library images are filed under.
+ */
+
+void Gui::prewarmPliLibrary()
+{
+  if ( ! PliLibrary::enabled()) {
+    LMessageBox::warning(NULL,QMessageBox::tr(LPUB),
+                              QMessageBox::tr("There is no parts list image library.\n"
+                                              "Please set one up in Preferences."));
+    return;
+  }
+
+  QString fileName = QFileDialog::getOpenFileName(
+    this,
+    tr("Parts to Render"),
+    QDir::currentPath(),
+    tr("LDraw Files (*.dat *.ldr *.mpd)"));
+
+  if (fileName.isEmpty()) {
+    return;
+  }
+
+  bool ok;
+  QString colorList = QInputDialog::getText(
+    this,
+    tr("Colors to Render"),
+    tr("Color codes, or nothing for the colors in the file"),
+    QLineEdit::Normal,"",&ok);
+
+  if ( ! ok) {
+    return;
+  }
+
+  QStringList colors = colorList.split(QRegExp("[\\s,]+"),QString::SkipEmptyParts);
+
+  QProgressDialog progress(tr("Rendering parts list images"),tr("Cancel"),
+                           0,0,this);
+  progress.setWindowModality(Qt::WindowModal);
+
+  int rendered = prewarmParts(fileName,colors,&progress);
+
+  if (rendered >= 0) {
+    statusBarMsg(tr("%1 parts list images are in the library") .arg(rendered));
+  }
+}
+
+/*
+ * This does the work for prewarmPliLibrary, and for lpub --prewarm
+ * (see batch.h), which has no progress dialog.  The return value is how
+ * many images were rendered or found, or -1 if fileName can't be read.
+ */
+
+int Gui::prewarmParts(
+  const QString     &fileName,
+  const QStringList &colors,
+  QProgressDialog   *progress)
+{
+  QFile file(fileName);
+  if ( ! file.open(QFile::ReadOnly | QFile::Text)) {
+    LMessageBox::warning(NULL,QMessageBox::tr(LPUB),
+                              QMessageBox::tr("Cannot read file %1:\n%2.")
+                              .arg(fileName)
+                              .arg(file.errorString()));
+    return -1;
+  }
+
+  QStringList types;
+  QList<QPair<QString, QString> > partColors;
+
+  QTextStream in(&file);
+  while ( ! in.atEnd()) {
+    QStringList tokens;
+    split(in.readLine(0),tokens);
+    if (tokens.size() != 15 || tokens[0] != "1") {
+      continue;
+    }
+    if (colors.size() == 0) {
+      QPair<QString, QString> partColor(tokens[14],tokens[1]);
+      if ( ! partColors.contains(partColor)) {
+        partColors << partColor;
+      }
+    } else if ( ! types.contains(tokens[14])) {
+      types << tokens[14];
+    }
+  }
+  file.close();
+
+  for (int t = 0; t < types.size(); t++) {
+    for (int c = 0; c < colors.size(); c++) {
+      partColors << QPair<QString, QString>(types[t],colors[c]);
+    }
+  }
+
+  Meta meta = page.meta;
+  MetaItem mi;
+  mi.sortedGlobalWhere(meta,ldrawFile.topLevelFile(),"ZZZZZZZ");
+
+  Pli pli;
+  pli.meta    = &meta;
+  pli.pliMeta = meta.LPub.pli;
+
+  if (progress) {
+    progress->setMaximum(partColors.size());
+  }
+
+  int i;
+  for (i = 0; i < partColors.size(); i++) {
+    if (progress) {
+      if (progress->wasCanceled()) {
+        break;
+      }
+      progress->setValue(i);
+    }
+
+    QString type  = partColors[i].first;
+    QString color = partColors[i].second;
+    QString key   = QFileInfo(type).baseName() + "_" + color;
+    QPixmap pixmap;
+
+    pli.createPartImage(key,type,color,&pixmap);
+  }
+  if (progress) {
+    progress->setValue(partColors.size());
+  }
+
+  return i;
+}
+
 /***************************************************************************
  * These are infrequently used functions for basic environment 
  * configuration stuff
@@ -407,6 +547,7 @@ Gui::Gui()
     Preferences::renderPreferences();
 	Preferences::lgeoPreferences();
     Preferences::pliPreferences();
+    Preferences::pliLibraryPreferences();
 
     displayPageNum = 1;
 
@@ -441,6 +582,12 @@ Gui::Gui()
     undoStack = new QUndoStack();
     macroNesting = 0;
 
+    redrawTimer = new QTimer(this);
+    redrawTimer->setSingleShot(true);
+    redrawShowLine = false;
+    connect(redrawTimer, SIGNAL(timeout()),
+            this,        SLOT(  redrawNow()));
+
     connect(this,       SIGNAL(displayFileSig(LDrawFile *, const QString &)),
             editWindow, SLOT(  displayFile   (LDrawFile *, const QString &)));
     connect(this,       SIGNAL(showLineSig(int)),
@@ -544,7 +691,7 @@ void Gui::meta()
 
   QFile file(fileName);
   if (!file.open(QFile::WriteOnly | QFile::Text)) {
-    QMessageBox::warning(NULL,
+    LMessageBox::warning(NULL,
     QMessageBox::tr(LPUB),
     QMessageBox::tr("Cannot write file %1:\n%2.")
     .arg(fileName)
@@ -741,6 +888,11 @@ void Gui::createActions()
     clearCSICacheAct->setStatusTip(tr("Erase the assembly image cache"));
     connect(clearCSICacheAct, SIGNAL(triggered()), this, SLOT(clearCSICache()));
 
+    prewarmPliLibraryAct = new QAction(tr("Render Parts For Library..."), this);
+    prewarmPliLibraryAct->setEnabled(false);
+    prewarmPliLibraryAct->setStatusTip(tr("Render parts list images into the library shared between projects"));
+    connect(prewarmPliLibraryAct, SIGNAL(triggered()), this, SLOT(prewarmPliLibrary()));
+
     // Config menu
 
     pageSetupAct = new QAction(tr("Page Setup"), this);
@@ -816,6 +968,7 @@ void Gui::enableActions()
     calloutSetupAct->setEnabled(true);
     multiStepSetupAct->setEnabled(true);
     projectSetupAct->setEnabled(true);
+    prewarmPliLibraryAct->setEnabled(true);
     addPictureAct->setEnabled(true);
     removeLPubFormattingAct->setEnabled(true);
 }
@@ -889,6 +1042,7 @@ void Gui::createMenus()
     toolsMenu->addSeparator();
     toolsMenu->addAction(clearPLICacheAct);
     toolsMenu->addAction(clearCSICacheAct);
+    toolsMenu->addAction(prewarmPliLibraryAct);
 
     configMenu = menuBar()->addMenu(tr("&Configuration"));
     configMenu->addAction(pageSetupAct);
@@ -359,6 +359,8 @@ class QFileDialog;
 class QResizeEvent;
 class QLineEdit;
 class QUndoStack;
+class QTimer;
+class QProgressDialog;
 class QUndoCommand;
 
 class EditWindow;
@@ -461,13 +463,32 @@ public:
   void appendLine (const Where &here, const QString &line, QUndoCommand *parent = 0);
   void replaceLine(const Where &here, const QString &line, QUndoCommand *parent = 0);
   void deleteLine (const Where &here, QUndoCommand *parent = 0);
+  void editLines  (const LDrawEdits &edits, QUndoCommand *parent = 0);
   QString topLevelFile();
   void beginMacro (QString name);
   void endMacro   ();
 
+  /*
+   * The undo commands call these rather than displayPage, so a run of
+   * them (undoing a macro, say) draws the page once, when the event
+   * loop next gets control.  here is the line changed, which the editor
+   * is brought to at the same time.
+   */
+
+  void redrawLater();
+  void redrawLater(const Where &here);
+
   void displayFile(LDrawFile *ldrawFile, const QString &modelName);
 
   int             maxPages;
+
+  /* Export without asking the user anything (see batch.h) */
+
+  bool printToFile(const QString &fileName, const QList<int> &pages);
+  bool exportAs(const QString &directoryName, const QString &suffix, const QList<int> &pages);
+  int  batchExport(const QStringList &arguments);
+  int  batchPrewarm(const QStringList &arguments);
+  int  prewarmParts(const QString &fileName, const QStringList &colors, QProgressDialog *progress);
   
   LGraphicsView *pageview()
   {
@@ -522,6 +543,7 @@ public slots:
 
   void clearPLICache();
   void clearCSICache();
+  void prewarmPliLibrary();
 
   void statusBarMsg(QString msg);
 
@@ -555,6 +577,9 @@ private:
 
   QUndoStack     *undoStack;       // the undo/redo stack
   int             macroNesting;
+  QTimer         *redrawTimer;     // fires redrawNow for redrawLater
+  Where           redrawLine;      // the last line changed
+  bool            redrawShowLine;
 
   void countPages();
 
@@ -586,7 +611,7 @@ private:
     QStringList   &bfxParts,
     bool           calledOut = false);
   
-  void attitudeAdjustment(); // reformat the LDraw file to fix LPub backward compatibility issues 
+  void attitudeAdjustment(LDrawFile &file); // reformat the LDraw file to fix LPub backward compatibility issues 
     
   void include(Meta &meta);
 
@@ -626,6 +651,7 @@ private slots:
 
     void redo();
     void undo();
+    void redrawNow();
 
     void insertCoverPage();
     void appendCoverPage();
@@ -676,6 +702,7 @@ private slots:
 
     void setCurrentFile(const QString &fileName);
     void openFile(QString &fileName);
+    bool reloadChanges();
     bool maybeSave();
     bool saveFile(const QString &fileName);
     void closeFile();
@@ -768,6 +795,7 @@ private:
   QLineEdit*setPageLineEdit;
   QAction  *clearPLICacheAct;
   QAction  *clearCSICacheAct;
+  QAction  *prewarmPliLibraryAct;
 
   // config menu
 
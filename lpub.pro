@@ -18,9 +18,17 @@ macx {
     #    ppc
 }
 
+# ldrawzip.cpp inflates parts out of complete.zip
+LIBS += -lz
+
+# pli.cpp checks its PLI height searches against linear scans, and warns
+# where a scan finds a better layout
+# DEFINES += PLI_SEARCH_CHECK
+
 # Input
 HEADERS += backgrounddialog.h \
     backgrounditem.h \
+    batch.h \
     borderdialog.h \
     callout.h \
     calloutbackgrounditem.h \
@@ -31,9 +39,15 @@ HEADERS += backgrounddialog.h \
     dependencies.h \
     dividerdialog.h \
     editwindow.h \
+    geometry.h \
     globals.h \
     highlighter.h \
     ldrawfiles.h \
+    ldrawzip.h \
+    libraryindex.h \
+    linearena.h \
+    lineview.h \
+    lmessagebox.h \
     lpub.h \
     lpub_preferences.h \
     meta.h \
@@ -42,6 +56,7 @@ HEADERS += backgrounddialog.h \
     metatypes.h \
     name.h \
     numberitem.h \
+    pagearena.h \
     pagebackgrounditem.h \
     pairdialog.h \
     partslist.h \
@@ -50,6 +65,7 @@ HEADERS += backgrounddialog.h \
     placementdialog.h \
     pli.h \
     pliconstraindialog.h \
+    plilibrary.h \
     pointer.h \
     pointeritem.h \
     preferencesdialog.h \
@@ -59,6 +75,8 @@ HEADERS += backgrounddialog.h \
     ranges_element.h \
     ranges_item.h \
     render.h \
+    renderspool.h \
+    resample.h \
     reserve.h \
     resize.h \
     resolution.h \
@@ -70,6 +88,7 @@ FORMS += preferences.ui
 SOURCES += assemglobals.cpp \
     backgrounddialog.cpp \
     backgrounditem.cpp \
+    batch.cpp \
     borderdialog.cpp \
     callout.cpp \
     calloutbackgrounditem.cpp \
@@ -82,8 +101,14 @@ SOURCES += assemglobals.cpp \
     dividerdialog.cpp \
     editwindow.cpp \
     formatpage.cpp \
+    geometry.cpp \
     highlighter.cpp \
     ldrawfiles.cpp \
+    ldrawzip.cpp \
+    libraryindex.cpp \
+    linearena.cpp \
+    lineview.cpp \
+    lmessagebox.cpp \
     lpub.cpp \
     lpub_preferences.cpp \
     main.cpp \
@@ -93,6 +118,7 @@ SOURCES += assemglobals.cpp \
     multistepglobals.cpp \
     numberitem.cpp \
     openclose.cpp \
+    pagearena.cpp \
     pagebackgrounditem.cpp \
     pageglobals.cpp \
     pairdialog.cpp \
@@ -103,6 +129,7 @@ SOURCES += assemglobals.cpp \
     pli.cpp \
     pliconstraindialog.cpp \
     pliglobals.cpp \
+    plilibrary.cpp \
     pointeritem.cpp \
     preferencesdialog.cpp \
     printpdf.cpp \
@@ -113,6 +140,8 @@ SOURCES += assemglobals.cpp \
     ranges_element.cpp \
     ranges_item.cpp \
     render.cpp \
+    renderspool.cpp \
+    resample.cpp \
     resize.cpp \
     resolution.cpp \
     rotate.cpp \
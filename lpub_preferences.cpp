@@ -14,6 +14,7 @@
 **
 ****************************************************************************/
 #include <QSettings>
+#include <QFile>
 #include <QFileInfo>
 #include <QProcess>
 #include <QString>
@@ -21,6 +22,7 @@
 #include <QDir>
 #include <QFileDialog>
 #include <QMessageBox>
+#include <QDesktopServices>
 
 #include "lpub_preferences.h"
 #include "render.h"
@@ -28,6 +30,8 @@
 #include "preferencesdialog.h"
 #include "name.h"
 #include "resolution.h"
+#include "lmessagebox.h"
+#include "ldrawzip.h"
 
 Preferences preferences;
 
@@ -39,6 +43,7 @@ QString Preferences::ldviewExe;
 QString Preferences::l3pExe;
 QString Preferences::povrayExe;
 QString Preferences::pliFile;
+QString Preferences::pliLibraryPath;
 QString Preferences::preferredRenderer;
 bool    Preferences::preferCentimeters = false;
 
@@ -67,10 +72,15 @@ void Preferences::ldrawPreferences(bool force)
     ldrawPath = settings.value(ldrawKey).toString();
   }
 
+  /*
+   * The LDraw library can be a directory, or the complete.zip it comes
+   * in.
+   */
+
   if (ldrawPath != "" && ! force) {
     QDir cwd(ldrawPath);
 
-    if (cwd.exists()) {
+    if (cwd.exists() || (LDrawZip::isZip(ldrawPath) && QFile::exists(ldrawPath))) {
       return;
     }
   }
@@ -80,7 +90,8 @@ void Preferences::ldrawPreferences(bool force)
 
   ldrawPath = qgetenv("LDRAWDIR");
   guesses.setPath(ldrawPath);
-  if ( ! guesses.exists()) {
+  if ( ! guesses.exists() &&
+       ! (LDrawZip::isZip(ldrawPath) && QFile::exists(ldrawPath))) {
     ldrawPath = LDRAW_PATH_DEFAULT;
     guesses.setPath(ldrawPath);
     if ( ! guesses.exists()) {
@@ -88,6 +99,12 @@ void Preferences::ldrawPreferences(bool force)
       guesses.setPath(ldrawPath);
       if ( ! guesses.exists()) {
 
+        if (LMessageBox::headless()) {
+          LMessageBox::critical(NULL,LPUB,
+                                "Cannot find the LDraw directory, please set LDRAWDIR");
+          exit(1);
+        }
+
         ldrawPath = QFileDialog::getExistingDirectory(NULL,
                     QFileDialog::tr("Locate LDraw Directory"),
                     "/",
@@ -280,6 +297,25 @@ void Preferences::pliPreferences()
   }
 }
 
+/*
+ * Parts list images are shared between projects through a library in
+ * the user's data directory, unless the user points it somewhere else
+ * (such as a shared directory) or turns it off.
+ */
+
+void Preferences::pliLibraryPreferences()
+{
+  QSettings settings(LPUB,SETTINGS);
+
+  if (settings.contains("PliLibrary")) {
+    pliLibraryPath = settings.value("PliLibrary").toString();
+  } else {
+    pliLibraryPath = QDesktopServices::storageLocation(
+                       QDesktopServices::DataLocation) + "/PliLibrary";
+    settings.setValue("PliLibrary",pliLibraryPath);
+  }
+}
+
 void Preferences::unitsPreferences()
 {
   QSettings settings(LPUB,SETTINGS);
@@ -315,6 +351,10 @@ bool Preferences::getPreferences()
       } else {
         settings.setValue("PliControl",pliFile);
       }
+    }
+    if (pliLibraryPath != dialog->pliLibraryPath()) {
+      pliLibraryPath = dialog->pliLibraryPath();
+      settings.setValue("PliLibrary",pliLibraryPath);
     }
 	  if (l3pExe != dialog->l3pExe()) {
 		  l3pExe = dialog->l3pExe();
@@ -381,6 +421,11 @@ bool Preferences::getPreferences()
 
 void Preferences::getRequireds()
 {
+  if (preferredRenderer == "" && LMessageBox::headless()) {
+    LMessageBox::critical(NULL,LPUB,
+                          "No renderer is installed, please set one up in Preferences");
+    exit(1);
+  }
   if (preferredRenderer == "" && ! getPreferences()) {
     exit (-1);
   }
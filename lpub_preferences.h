@@ -95,6 +95,7 @@ class Preferences
 	static void lgeoPreferences();
 	  static void renderPreferences();
 	  static void pliPreferences();
+    static void pliLibraryPreferences();
     static void unitsPreferences();
 	  static void getRequireds();
 	  static bool getPreferences();
@@ -107,6 +108,7 @@ class Preferences
 	static QString povrayExe;
 	  static QString preferredRenderer;
     static QString pliFile;
+    static QString pliLibraryPath;
     static QString lpubPath;
     static bool    preferCentimeters;
 
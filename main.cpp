@@ -19,6 +19,8 @@
 #include "lpub_preferences.h"
 #include "lpub.h"
 #include "resolution.h"
+#include "lmessagebox.h"
+#include "batch.h"
 #include <QMessageBox>
 
 int main(int argc, char *argv[])
@@ -26,15 +28,29 @@ int main(int argc, char *argv[])
     Q_INIT_RESOURCE(lpub);
 
     QApplication app(argc, argv);
+
+    LMessageBox::setHeadless(batchRequested(app.arguments()));
 	
     //QMessageBox::information(NULL,QMessageBox::tr("LPub"),QMessageBox::tr("Startup"));
     
     Preferences::ldrawPreferences(false);
+
+    if (app.arguments().contains("--render-worker")) {
+      return renderWorker(app.arguments());
+    }
     Preferences::unitsPreferences();
     defaultResolutionType(Preferences::preferCentimeters);
     setResolution(150);  // DPI
 
     Gui     LPubWin;
+
+    if (app.arguments().contains("--prewarm")) {
+      return LPubWin.batchPrewarm(app.arguments());
+    }
+    if (LMessageBox::headless()) {
+      return LPubWin.batchExport(app.arguments());
+    }
+
     LPubWin.show();
     LPubWin.sizeit();
 
@@ -37,6 +37,7 @@
 #include <QStringList>
 #include "meta.h"
 #include "lpub.h"
+#include "lmessagebox.h"
 
 /* The token map translates known keywords to values 
  * used by LPub to identify things like placement and such
@@ -236,7 +237,7 @@ Rc IntMeta::parse(QStringList &argv, int index,Where &here)
   }
 
   if (reportErrors) {
-    QMessageBox::warning(NULL,
+    LMessageBox::warning(NULL,
       QMessageBox::tr("LPub"),
       QMessageBox::tr("Expected a whole number but got \"%1\" %2") .arg(argv[index]) .arg(argv.join(" ")));
   }
@@ -282,7 +283,7 @@ Rc FloatMeta::parse(QStringList &argv, int index,Where &here)
     }
   }
   if (reportErrors) {
-    QMessageBox::warning(NULL,
+    LMessageBox::warning(NULL,
       QMessageBox::tr("LPub"),
       QMessageBox::tr("Expected a floating point number but got \"%1\" %2") .arg(argv[index]) .arg(argv.join(" ")));
   }
@@ -362,7 +363,7 @@ Rc FloatPairMeta::parse(QStringList &argv, int index,Where &here)
   }
 
   if (reportErrors) {
-    QMessageBox::warning(NULL,
+    LMessageBox::warning(NULL,
       QMessageBox::tr("LPub"),
       QMessageBox::tr("Expected two floating point numbers but got \"%1\" \"%2\" %3") .arg(argv[index]) .arg(argv[index+1]) .arg(argv.join(" ")));
   }
@@ -401,7 +402,7 @@ Rc StringMeta::parse(QStringList &argv, int index,Where &here)
   }
 
   if (reportErrors) {
-    QMessageBox::warning(NULL,
+    LMessageBox::warning(NULL,
       QMessageBox::tr("LPub"),
       QMessageBox::tr("Expected a string after \"%1\"") .arg(argv.join(" ")));
   }
@@ -468,7 +469,7 @@ Rc BoolMeta::parse(QStringList &argv, int index,Where &here)
   }
   
   if (reportErrors) {
-    QMessageBox::warning(NULL,
+    LMessageBox::warning(NULL,
       QMessageBox::tr("LPub"),
       QMessageBox::tr("Expected TRUE or FALSE \"%1\" %2") .arg(argv[index]) .arg(argv.join(" ")));
   }
@@ -816,7 +817,7 @@ Rc BackgroundMeta::parse(QStringList &argv, int index,Where &here)
   } else {
       
     if (reportErrors) {
-      QMessageBox::warning(NULL,
+      LMessageBox::warning(NULL,
         QMessageBox::tr("LPub"),
         QMessageBox::tr("Malformed background \"%1\"") .arg(argv.join(" ")));
     }
@@ -1056,7 +1057,7 @@ Rc PointerMeta::parse(QStringList &argv, int index,Where &here)
   } else {
 
     if (reportErrors) {
-      QMessageBox::warning(NULL,
+      LMessageBox::warning(NULL,
         QMessageBox::tr("LPub"),
         QMessageBox::tr("Malformed callout arrow \"%1\"") .arg(argv.join(" ")));
     }
@@ -1220,7 +1221,7 @@ Rc AllocMeta::parse(QStringList &argv, int index, Where &here)
     return OkRc;
   }
   if (reportErrors) {
-    QMessageBox::warning(NULL,
+    LMessageBox::warning(NULL,
       QMessageBox::tr("LPub"),
       QMessageBox::tr("Expected HORIZONTAL or VERTICAL got \"%1\" in \"%2\"") .arg(argv[index]) .arg(argv.join(" ")));
   }
@@ -1267,7 +1268,7 @@ Rc SepMeta::parse(QStringList &argv, int index,Where &here)
     }
   }
   if (reportErrors) {
-    QMessageBox::warning(NULL,
+    LMessageBox::warning(NULL,
       QMessageBox::tr("LPub"),
       QMessageBox::tr("Malformed separator \"%1\"") .arg(argv.join(" ")));
   }
@@ -1379,7 +1380,7 @@ Rc InsertMeta::parse(QStringList &argv, int index, Where &here)
     return InsertRc;
   } else {
     if (reportErrors) {
-      QMessageBox::warning(NULL,
+      LMessageBox::warning(NULL,
         QMessageBox::tr("LPub"),
         QMessageBox::tr("Malformed Insert metacommand \"%1\"") .arg(argv.join(" ")));
     }
@@ -1748,7 +1749,7 @@ Rc RotStepMeta::parse(QStringList &argv, int index,Where &here)
     return RotStepRc;
   }
   if (reportErrors) {
-    QMessageBox::warning(NULL,
+    LMessageBox::warning(NULL,
       QMessageBox::tr("LPub"),
       QMessageBox::tr("Malformed rotation step \"%1\"") .arg(argv.join(" ")));
   }
@@ -1785,7 +1786,7 @@ Rc BuffExchgMeta::parse(QStringList &argv, int index,Where &here)
     } 
   }
   if (reportErrors) {
-    QMessageBox::warning(NULL,
+    LMessageBox::warning(NULL,
       QMessageBox::tr("LPub"),
       QMessageBox::tr("Malformed buffer exchange \"%1\"") .arg(argv.join(" ")));
   }
@@ -1918,6 +1919,7 @@ PliMeta::PliMeta() : BranchMeta()
   margin.setValuesInches(DEFAULT_MARGIN,DEFAULT_MARGIN);
   pack.setValue(true);
   sort.setValue(false);
+  recolor.setValue(false);
 }
 
 void PliMeta::init(BranchMeta *parent, QString name)
@@ -1943,6 +1945,7 @@ void PliMeta::init(BranchMeta *parent, QString name)
   begin        .init(this,"BEGIN");
   end          .init(this,"END",           PliEndRc);
   sort         .init(this,"SORT");
+  recolor      .init(this,"RECOLOR");
 }
 
 /* ------------------ */ 
@@ -2011,6 +2014,7 @@ void BomMeta::init(BranchMeta *parent, QString name)
   begin.ignore.rc = BomBeginIgnRc;
   end          .init(this,"END",BomEndRc);
   sort         .init(this,"SORT");
+  recolor      .init(this,"RECOLOR");
 }
 
 /* ------------------ */ 
@@ -2192,6 +2196,27 @@ void ResolutionMeta::doc(QStringList &out, QString preamble)
   out << preamble + "<integer> (DPI|DPCM)";
 }
 
+RenderCacheMeta::RenderCacheMeta() : BranchMeta()
+{
+  resample.setValue(false);
+  resolution.setRange(1.0,10000.0);
+  resolution.setFormats(7,1,"99999.9");
+  resolution.setValue(600.0);
+  tolerance.setRange(0.0,10.0);
+  tolerance.setFormats(6,4,"9.9999");
+  tolerance.setValue(0.05);
+}
+
+void RenderCacheMeta::init(BranchMeta *parent, QString name)
+{
+  AbstractMeta::init(parent, name);
+  resample  .init(this,"RESAMPLE");
+  resolution.init(this,"REFERENCE_RESOLUTION");
+  tolerance .init(this,"TOLERANCE");
+}
+
+/* ------------------ */
+
 LPubMeta::LPubMeta() : BranchMeta()
 {
   stepNumber.placement.setValue(TopLeftInsideCorner,PageType);
@@ -2216,7 +2241,7 @@ Rc NoStepMeta::parse(QStringList &argv, int index,Where & /* here */ )
   } else {
 
     if (reportErrors) {
-      QMessageBox::warning(NULL,
+      LMessageBox::warning(NULL,
         QMessageBox::tr("LPub"),
         QMessageBox::tr("Unexpected token \"%1\" %2") .arg(argv[index]) .arg(argv.join(" ")));
     }
@@ -2253,6 +2278,7 @@ void LPubMeta::init(BranchMeta *parent, QString name)
   insert                 .init(this,"INSERT");
   include                .init(this,"INCLUDE", IncludeRc);
   nostep                 .init(this,"NOSTEP",NoStepRc);\
+  renderCache            .init(this,"RENDER_CACHE");
   reserve.setRange(0.0,1000000.0);
 }
 
@@ -2393,7 +2419,7 @@ Rc Meta::parse(
 
     if (rc == FailureRc) {
       if (reportErrors) {
-        QMessageBox::warning(NULL,QMessageBox::tr("LPub"),
+        LMessageBox::warning(NULL,QMessageBox::tr("LPub"),
                                 QMessageBox::tr("Parse failed %1:%2\n%3")
                                 .arg(here.modelName) .arg(here.lineNumber) .arg(line));
       }
@@ -1706,6 +1706,7 @@ public:
 	StringMeta povrayParms;
   BoolMeta       pack;
   BoolMeta       sort;
+  BoolMeta       recolor;
 
   PliMeta();
   PliMeta(const PliMeta &rhs) : BranchMeta(rhs)
@@ -1855,6 +1856,31 @@ public:
   virtual void    doc(QStringList &out, QString preamble);
 };
 
+/*------------------------*/
+
+/*
+ * 0 !LPUB RENDER_CACHE RESAMPLE (TRUE|FALSE)
+ * 0 !LPUB RENDER_CACHE REFERENCE_RESOLUTION <float>
+ * 0 !LPUB RENDER_CACHE TOLERANCE <float>
+ *
+ * see resample.h
+ */
+
+class RenderCacheMeta : public BranchMeta
+{
+public:
+  BoolMeta  resample;
+  FloatMeta resolution;  // DPI at model scale 1
+  FloatMeta tolerance;   // how much bigger than the reference we resample
+  RenderCacheMeta();
+  RenderCacheMeta(const RenderCacheMeta &rhs) : BranchMeta(rhs)
+  {
+  }
+
+  virtual ~RenderCacheMeta() {}
+  virtual void init(BranchMeta *parent, QString name);
+};
+
 class LPubMeta : public BranchMeta
 {
 public:
@@ -1872,6 +1898,7 @@ public:
   InsertMeta     insert;
   StringMeta     include;
   NoStepMeta     nostep;
+  RenderCacheMeta renderCache;
   LPubMeta();
   virtual ~LPubMeta() {};
   virtual void init(BranchMeta *parent, QString name);
@@ -53,6 +53,7 @@
 #include "dividerdialog.h"
 #include "paths.h"
 #include "render.h"
+#include "lmessagebox.h"
 
 void MetaItem::setGlobalMeta(
   QString  &topLevelFile,
@@ -1954,7 +1955,7 @@ void MetaItem::addCalloutMetas(
     if (assembled) {
       if (instanceCount > 1) {
         QMessageBox::StandardButton pushed;
-        pushed = QMessageBox::question(gui,gui->tr("Multiple Copies"),
+        pushed = LMessageBox::question(gui,gui->tr("Multiple Copies"),
                                            gui->tr("There are multiple copies, do you want them as one callout?"),
                                            QMessageBox::Yes|QMessageBox::No,
                                            QMessageBox::Yes);
@@ -2060,15 +2061,17 @@ void MetaItem::removeCallout(
   } while (rc != EndOfFileRc);
 
   QRegExp callout("^\\s*0\\s+\\!*LPUB\\s+CALLOUT");
+  LDrawEdits edits(bottomOfCallout.modelName);
   for (walk = bottomOfCallout;
        walk >= topOfCallout.lineNumber;
        walk--)
   {
     QString line = gui->readLine(walk);
     if (line.contains(callout)) {
-      deleteMeta(walk);
+      edits.deleteLine(walk.lineNumber);
     }
   }
+  gui->editLines(edits);
   endMacro();
 }
 
@@ -2082,6 +2085,8 @@ void MetaItem::unnestCallouts(
   bool partIgnore = false;
   bool callout = false;
 
+  LDrawEdits edits(modelName);
+
   for ( ; walk.lineNumber < numLines; ++walk) {
 
     QString line = gui->readLine(walk);
@@ -2095,15 +2100,11 @@ void MetaItem::unnestCallouts(
         if (argv.size() == 4 && argv[2] == "CALLOUT"
                              && argv[3] == "BEGIN") {
           callout = true;
-          deleteMeta(walk);
-          --numLines;
-          --walk;
+          edits.deleteLine(walk.lineNumber);
         } else if (argv.size() == 4 && argv[2] == "CALLOUT"
                                     && argv[3] == "END") {
           callout = false;
-          deleteMeta(walk);
-          --numLines;
-          --walk;
+          edits.deleteLine(walk.lineNumber);
         }
       }
     } else if ( ! callout && ! partIgnore) {
@@ -2114,6 +2115,7 @@ void MetaItem::unnestCallouts(
       }
     }
   }
+  gui->editLines(edits);
 }
 
 void MetaItem::updatePointer(
@@ -2168,7 +2170,7 @@ int MetaItem::monoColorSubmodel(
 {    
   QFile outFile(outFileName);
   if ( ! outFile.open(QFile::WriteOnly | QFile::Text)) {
-    QMessageBox::warning(NULL, 
+    LMessageBox::warning(NULL, 
       QMessageBox::tr(LPUB),
       QMessageBox::tr("MonoColorSubmodel cannot write file %1:\n%2.")
       .arg(outFileName)
@@ -2240,7 +2242,7 @@ QPointF MetaItem::defaultPointerTip(
 
   QFile inFile(monoName);
   if ( ! inFile.open(QFile::ReadOnly | QFile::Text)) {
-    QMessageBox::warning(NULL,
+    LMessageBox::warning(NULL,
       QMessageBox::tr(LPUB),
       QMessageBox::tr("defaultPointerTip cannot read file %1:\n%2.")
       .arg(monoName)
@@ -2420,17 +2422,16 @@ void MetaItem::removeLPubFormatting()
   for (int i = 0; i < fileList.size(); ++i) {
     Where walk(fileList[i],0);
     int numLines = gui->subFileSize(fileList[i]);
-    for (; walk.lineNumber < numLines; ) {
+    LDrawEdits edits(fileList[i]);
+    for (; walk.lineNumber < numLines; ++walk) {
       QString line = gui->readLine(walk);
       QStringList argv;
       split(line,argv);
       if (argv.size() > 2 && argv[0] == "0" && (argv[1] == "LPUB" || argv[1] == "!LPUB")) {
-        gui->deleteLine(walk);
-        --numLines;
-      } else {
-        ++walk;
+        edits.deleteLine(walk.lineNumber);
       }
     }
+    gui->editLines(edits);
   }
   endMacro();
 }
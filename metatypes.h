@@ -105,6 +105,7 @@ enum PlacementType {
   ReserveType,
   BomType,
   CoverPageType,
+  InsertType,
   NumRelatives
 };
 
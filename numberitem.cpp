@@ -40,6 +40,7 @@
 
 #include "ranges.h"
 #include "step.h"
+#include "lpub.h"
 
 void NumberItem::setAttributes(
   PlacementType  _relativeType,
@@ -174,6 +175,7 @@ void NumberPlacementItem::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
   QGraphicsItem::mouseMoveEvent(event);
   if (isSelected() && (flags() & QGraphicsItem::ItemIsMovable)) {
     positionChanged = true;
+    gui->page.graph.dragged(this);
   }   
 }     
       
@@ -19,11 +19,13 @@
 #include <QTextEdit>
 #include <QUndoStack>
 #include <QSettings>
+#include <QSet>
 
 #include "lpub.h"
 #include "lpub_preferences.h"
 #include "editwindow.h"
 #include "paths.h"
+#include "lmessagebox.h"
 
 void Gui::open()
 {  
@@ -124,7 +126,7 @@ void Gui::saveAs()
     openFile(fileName);
     displayPage();
   } else {
-    QMessageBox::warning(NULL,QMessageBox::tr("LPub"),
+    LMessageBox::warning(NULL,QMessageBox::tr("LPub"),
                               QMessageBox::tr("Invalid LDraw suffix %1.  File not saved.")
                                 .arg(suffix));
 
@@ -149,7 +151,7 @@ bool Gui::maybeSave()
 {
   if ( ! undoStack->isClean() ) {
     QMessageBox::StandardButton ret;
-    ret = QMessageBox::warning(this, tr(LPUB),
+    ret = LMessageBox::warning(this, tr(LPUB),
             tr("The document has been modified.\n"
                 "Do you want to save your changes?"),
             QMessageBox::Save | QMessageBox::Discard | QMessageBox::Cancel);
@@ -227,7 +229,7 @@ void Gui::openFile(QString &fileName)
   QDir::setCurrent(info.absolutePath());
   Paths::mkdirs();
   ldrawFile.loadFile(fileName);
-  attitudeAdjustment();
+  attitudeAdjustment(ldrawFile);
   mpdCombo->setMaxCount(0);
   mpdCombo->setMaxCount(1000);
   mpdCombo->addItems(ldrawFile.subFileOrder());
@@ -319,12 +321,150 @@ void Gui::fileChanged(const QString &path)
 {
   QString msg = QString(tr("The file \"%1\" contents have changed.  Reload?"))
                         .arg(path);
-  int ret = QMessageBox::warning(this,tr(LPUB),msg,
+  int ret = LMessageBox::warning(this,tr(LPUB),msg,
               QMessageBox::Apply | QMessageBox::No,
               QMessageBox::Apply);
   if (ret == QMessageBox::Apply) {
-    QString fileName = path;
-    openFile(fileName);
-    drawPage(KpageView,KpageScene,false);
+    if ( ! reloadChanges()) {
+      QString fileName = curFile;
+      openFile(fileName);
+      drawPage(KpageView,KpageScene,false);
+    }
+  }
+
+#ifdef WATCHER
+  // programs that save by renaming a new file over the old one leave us
+  // watching nothing
+
+  if ( ! watcher.files().contains(path) && QFileInfo(path).exists()) {
+    watcher.addPath(path);
+  }
+#endif
+}
+
+/*
+ * Another program (MLCad, LDCad) saved the model.  Rather than reopening
+ * it, which empties the undo stack, reloads the editor and starts over at
+ * the first page, we compare what was saved with what we have and change
+ * just the lines that differ.  The change goes on the undo stack like any
+ * other, so it can be undone, and the commands already there still line
+ * up with the file.  Only the submodels that changed, and the ones that
+ * use them, get a new date, so only the images that show them are
+ * rendered again.
+ *
+ * If submodels were added, removed or renamed we give up, and the caller
+ * reopens the file.
+ */
+
+bool Gui::reloadChanges()
+{
+  LDrawFile saved;
+
+  saved.loadFile(curFile);
+  attitudeAdjustment(saved);
+
+  if (saved.isMpd() != isMpd() ||
+      saved.subFileOrder() != ldrawFile.subFileOrder()) {
+    return false;
   }
+
+  bool          wasClean = undoStack->isClean();
+  bool          changed  = false;
+  QSet<QString> dated;
+  QDateTime     newest;
+
+  foreach (QString fileName, saved.subFileOrder()) {
+    QStringList was = ldrawFile.contents(fileName);
+    QStringList is  = saved.contents(fileName);
+
+    if (was == is) {
+      continue;
+    }
+
+    // skip the lines the two have in common at the start and the end
+
+    int first = 0;
+    while (first < was.size() && first < is.size() && was[first] == is[first]) {
+      first++;
+    }
+    int wasEnd = was.size();
+    int isEnd  = is.size();
+    while (wasEnd > first && isEnd > first && was[wasEnd-1] == is[isEnd-1]) {
+      wasEnd--;
+      isEnd--;
+    }
+
+    LDrawEdits edits(fileName);
+    int line;
+    for (line = first; line < wasEnd && line < isEnd; line++) {
+      edits.replaceLine(line,is[line]);
+    }
+    for (int w = line; w < wasEnd; w++) {
+      edits.deleteLine(w);
+    }
+    for (int i = line; i < isEnd; i++) {
+      edits.insertLine(wasEnd,is[i]);
+    }
+
+    if ( ! changed) {
+      beginMacro("reload");
+      changed = true;
+    }
+    editLines(edits);
+    ldrawFile.setLastModified(fileName,saved.lastModified(fileName));
+    dated.insert(fileName.toLower());
+    if ( ! newest.isValid() || saved.lastModified(fileName) > newest) {
+      newest = saved.lastModified(fileName);
+    }
+  }
+
+  /*
+   * A step's image is only checked against the submodels above it, so
+   * the submodels that use a changed one, however deeply, get the new
+   * date too.
+   */
+
+  bool more = changed;
+  while (more) {
+    more = false;
+    foreach (QString fileName, ldrawFile.subFileOrder()) {
+      if (dated.contains(fileName.toLower())) {
+        continue;
+      }
+      foreach (QString line, ldrawFile.contents(fileName)) {
+        QStringList tokens;
+        split(line,tokens);
+        if (tokens.size() == 15 && tokens[0] == "1" &&
+            dated.contains(tokens[14].toLower())) {
+          ldrawFile.setLastModified(fileName,newest);
+          dated.insert(fileName.toLower());
+          more = true;
+          break;
+        }
+      }
+    }
+  }
+
+  // parts list images are not checked against dates, so the ones
+  // showing these submodels are thrown away
+
+  QDir partsDir(QDir::currentPath() + "/" + Paths::partsDir);
+  foreach (QString fileName, dated) {
+    QStringList filter(QFileInfo(fileName).baseName() + "_*.png");
+    foreach (QString image, partsDir.entryList(filter,QDir::Files)) {
+      partsDir.remove(image);
+    }
+  }
+
+  if (changed) {
+    maxPages = -1;
+    endMacro();
+
+    // what we have now is what is on disk
+
+    if (wasClean) {
+      undoStack->setClean();
+    }
+  }
+  return true;
 }
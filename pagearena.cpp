@@ -0,0 +1,108 @@
+
+/****************************************************************************
+**
+** Copyright (C) 2007-2009 Kevin Clague. All rights reserved.
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.trolltech.com/products/qt/opensource.html
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+
+/****************************************************************************
+ *
+ * This file implements the arena the page model is allocated from.
+ *
+ * Please see lpub.h for an overall description of how the files in LPub
+ * make up the LPub program.
+ *
+ ***************************************************************************/
+
+#include <stdlib.h>
+#include <new>
+#include <QList>
+#include <QVector>
+#include "pagearena.h"
+
+/*
+ * A page's model usually fits in the first block.  Sizes are rounded up
+ * to GRAIN so everything handed out is suitably aligned.
+ */
+
+#define BLOCK_SIZE (256*1024)
+#define GRAIN      16
+
+static QList<char *>   blocks;
+static char           *next = 0;
+static char           *end  = 0;
+
+/*
+ * Deleted objects, by size in GRAINs.  Each free object holds the
+ * address of the next one.
+ */
+
+static QVector<void *> freeLists;
+
+static size_t rounded(size_t size)
+{
+  return (qMax(size,size_t(1)) + GRAIN - 1) & ~size_t(GRAIN - 1);
+}
+
+void *PageArena::allocate(size_t size)
+{
+  size = rounded(size);
+
+  int grains = int(size/GRAIN);
+  if (grains < freeLists.size() && freeLists[grains]) {
+    void *object = freeLists[grains];
+    freeLists[grains] = *(void **) object;
+    return object;
+  }
+
+  if (size_t(end - next) < size) {
+    size_t blockSize = qMax(size,size_t(BLOCK_SIZE));
+    char  *block     = (char *) malloc(blockSize);
+    if ( ! block) {
+      throw std::bad_alloc();
+    }
+    blocks << block;
+    next = block;
+    end  = block + blockSize;
+  }
+
+  void *object = next;
+  next += size;
+  return object;
+}
+
+void PageArena::deallocate(void *object, size_t size)
+{
+  if ( ! object) {
+    return;
+  }
+
+  int grains = int(rounded(size)/GRAIN);
+  if (grains >= freeLists.size()) {
+    freeLists.resize(grains + 1);
+  }
+  *(void **) object = freeLists[grains];
+  freeLists[grains] = object;
+}
+
+void PageArena::release()
+{
+  for (int i = 0; i < blocks.size(); i++) {
+    free(blocks[i]);
+  }
+  blocks.clear();
+  freeLists.clear();
+  next = 0;
+  end  = 0;
+}
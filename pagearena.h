@@ -0,0 +1,67 @@
+
+/****************************************************************************
+**
+** Copyright (C) 2007-2009 Kevin Clague. All rights reserved.
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.trolltech.com/products/qt/opensource.html
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+
+/****************************************************************************
+ *
+ * This class is where the objects that model a page come from.  Drawing
+ * a page makes a tree of Ranges, Steps, Callouts and PliParts, and
+ * clearing it deletes them all again, one at a time.  Rather than a heap
+ * block apiece, they are carved out of a few large blocks, and when the
+ * page is cleared the blocks are given back in one go.
+ *
+ * Classes get their memory from here by putting PAGE_ARENA_ALLOCATED in
+ * their declaration.  Their destructors still run when they are deleted
+ * (their Qt members own memory of their own), and what a deleted object
+ * used is handed out again to the next object of the same size.  Nothing
+ * from the arena may outlive the page; Gui::clearPage releases it.
+ *
+ * Please see lpub.h for an overall description of how the files in LPub
+ * make up the LPub program.
+ *
+ ***************************************************************************/
+
+#ifndef PAGEARENA_H
+#define PAGEARENA_H
+
+#include <stddef.h>
+
+class PageArena {
+  public:
+    PageArena() {}
+
+    static void *allocate(size_t size);
+    static void  deallocate(void *object, size_t size);
+
+    /*
+     * Give back everything allocated since the last release.
+     */
+
+    static void  release();
+};
+
+#define PAGE_ARENA_ALLOCATED \
+    static void *operator new(size_t size) \
+    { \
+      return PageArena::allocate(size); \
+    } \
+    static void operator delete(void *object, size_t size) \
+    { \
+      PageArena::deallocate(object,size); \
+    }
+
+#endif
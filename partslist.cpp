@@ -32,24 +32,34 @@
 #include <QFileInfo>
 #include <QTextStream>
 #include "lpub_preferences.h"
+#include "lmessagebox.h"
+#include "libraryindex.h"
+#include "ldrawzip.h"
 
 QHash<QString, QString> PartsList::list;
 QString                 PartsList::empty;
 QStringList             PartsList::partialPaths;
 
+/*
+ * With a library index, titles are looked up as they are needed rather
+ * than read from PARTS.LST up front.  Until there is one (the first time
+ * LPub runs, or after the library changes) we do what we always did.
+ */
+
 PartsList::PartsList()
 {
-  if (list.size() == 0) {
+  LibraryIndex::open();
+
+  if (list.size() == 0 && ! LibraryIndex::ready()) {
     QString partsname = Preferences::ldrawPath+"/parts.lst";
-    QFile file(partsname);
-    if ( ! file.open(QFile::ReadOnly | QFile::Text)) {
-      QMessageBox::warning(NULL,QMessageBox::tr("LPub"),
-                                QMessageBox::tr("failed to open %1:\n%2")
-                                .arg(partsname)
-                                .arg(file.errorString()));
+    QByteArray contents;
+    if ( ! LDrawZip::read(partsname,contents)) {
+      LMessageBox::warning(NULL,QMessageBox::tr("LPub"),
+                                QMessageBox::tr("failed to open %1")
+                                .arg(partsname));
       return;
     }
-    QTextStream in(&file);
+    QTextStream in(contents);
     QString line;
     QRegExp rx("^([\\d\\w\\.]+)\\s+~*\\b(.*)\\b\\s+$");
     while ( ! in.atEnd()) {
@@ -65,29 +75,31 @@ PartsList::PartsList()
     }
   }
   if (partialPaths.size() == 0) {
-    partialPaths << "/parts/" << "/parts/s/" << "/p/" << "/p/48/" <<
-                    "/Unofficial/parts/" << "/Unofficial/p/" <<
-                    "/Unofficial/LSynth/" <<
-                    "/Helpers/" << "/Custom/" << "/Development/";
+    partialPaths = LibraryIndex::roots();
   }
 }
 bool PartsList::isKnownPart(QString &part)
 {
   if (list.contains(part.toLower())) {
     return true;
+  } else if (LibraryIndex::ready()) {
+    QString title;
+    if (LibraryIndex::find(part,NULL,&title)) {
+      list[part.toLower()] = title;
+      return true;
+    }
+    return false;
   } else {
     QString testName;
-    QFileInfo info;
     for (int i = 0; i < partialPaths.size(); i++) {
       testName = Preferences::ldrawPath + partialPaths[i] + part;
-      info.setFile(testName);
 	  
-      if (info.exists()) {
-        QFile file(testName);
-        if ( ! file.open(QFile::ReadOnly | QFile::Text)) {
+      if (LDrawZip::exists(testName)) {
+        QByteArray contents;
+        if ( ! LDrawZip::read(testName,contents,1024)) {
           return false;
         }
-        QTextStream in(&file);
+        QTextStream in(contents);
         QString line = in.readLine(0).trimmed();
         if (line[0] == '0') {
           while (line[0] == '0' || line[0] == ' ' || line[0] == '~' || line[0] == '_') {
@@ -95,7 +107,6 @@ bool PartsList::isKnownPart(QString &part)
           }
           list[part.toLower()] = line;  
         }
-        file.close();
         return true;
       }
     }
@@ -105,8 +116,13 @@ bool PartsList::isKnownPart(QString &part)
 
 const QString &PartsList::title(QString part)
 {
+  QString title;
+
   if (list.contains(part.toLower())) {
     return list[part.toLower()];
+  } else if (LibraryIndex::find(part,NULL,&title)) {
+    list[part.toLower()] = title;
+    return list[part.toLower()];
   } else {
     return empty;
   }
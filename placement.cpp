@@ -27,11 +27,16 @@
  *
  ***************************************************************************/
 
+#include <QSet>
+#include <QStringList>
+
 #include "placement.h"
 #include "ranges.h"
 #include "callout.h"
 #include "range.h"
 #include "step.h"
+#include "placementdialog.h"
+#include "lmessagebox.h"
 
 void PlacementNum::sizeit()
 {
@@ -70,65 +75,257 @@ void Placement::appendRelativeTo(Placement *element)
 }
 
 /*
- * we start with a page, and ranges, and
- * we walk through the ranges,range,steps,
- * looking for things that are relative to page.
- * We put these in the p_head list.
+ * Things placed relative to other things make a graph, with an edge from
+ * each thing to what is placed relative to it (its relativeToList).
+ *
+ * relativeTo adds the step's CSI, PLI, step number and callouts to the
+ * graph under us.  Each goes under the one thing of the type it is
+ * placed relative to: us if we are that type, else another of the
+ * step's things, else something already placed relative to us (like
+ * the page number).  Then everything under us is placed in one pass,
+ * parents before children.
  *
- * foreach thing relative to page, we make a list
- * of things that are relative to them.
+ * Things placed relative to each other in a circle can't be reached from
+ * us, so they are left where they are, rather than chasing each other
+ * forever, and the user is told once about each such circle.
  */
-int Placement::relativeTo(
-  Step *step)
+
+static void placeNode(Placement *parent, Placement *node)
 {
-  int rc = 0;
+  if (node->relativeType == InsertType) {
+    int margin[2] = { 0, 0 };    // inserts go right up against the page
+    parent->placeRelative(node,margin);
+  } else {
+    parent->placeRelative(node);
+  }
+}
 
-  if (step) {
-    PlacementType stepRelativeTo;
-    stepRelativeTo = step->csiItem->placement.value().relativeTo;
-    if (stepRelativeTo == relativeType) {
-      placeRelative(step->csiItem);
-      appendRelativeTo(step->csiItem);
+static void reportCycles(QList<Placement *> &stepNodes)
+{
+  static QSet<QString> reported;
+
+  QSet<Placement *> seen;
+
+  for (int i = 0; i < stepNodes.size(); i++) {
+    Placement *node = stepNodes[i];
+
+    if (seen.contains(node)) {
+      continue;
+    }
+
+    // follow the parents, and see if we come back around to node
+
+    QList<Placement *> cycle;
+    Placement *parent;
+    for (parent = node;
+         parent && cycle.size() < 100 && ! (cycle.size() && parent == node);
+         parent = parent->relativeToParent) {
+      cycle << parent;
+    }
+    if (parent != node) {
+      continue;
     }
 
-    stepRelativeTo = step->pli.placement.value().relativeTo;
-    if (stepRelativeTo == relativeType) {
-      placeRelative(&step->pli);
-      appendRelativeTo(&step->pli);
+    QStringList names;
+    for (int j = 0; j < cycle.size(); j++) {
+      seen.insert(cycle[j]);
+      names << PlacementDialog::relativeToName(cycle[j]->relativeType);
     }
+    names << names[0];
+
+    QString message = names.takeFirst() + " is placed relative to the " +
+                      names.join(", which is placed relative to the ");
+
+    if ( ! reported.contains(message)) {
+      reported.insert(message);
+      LMessageBox::warning(NULL,QMessageBox::tr("LPub"),
+        QMessageBox::tr("The %1, so they are left where they are.  "
+                        "Change the placement of one of them.")
+        .arg(message));
+    }
+  }
+}
 
-    stepRelativeTo = step->stepNumber.placement.value().relativeTo;
-    if (stepRelativeTo == relativeType) {
-      placeRelative(&step->stepNumber);
-      appendRelativeTo(&step->stepNumber);
+static void graphNodes(Placement *node, QList<Placement *> &nodes)
+{
+  QSet<Placement *> seen;
+  QList<Placement *> pending;
+  pending << node;
+  seen.insert(node);
+
+  while (pending.size()) {
+    Placement *parent = pending.takeFirst();
+    nodes << parent;
+    for (int i = 0; i < parent->relativeToList.size(); i++) {
+      Placement *child = parent->relativeToList[i];
+      if ( ! seen.contains(child)) {
+        seen.insert(child);
+        pending << child;
+      }
     }
+  }
+}
 
-    /* callouts */
+int Placement::relativeTo(
+  Step *step)
+{
+  if (step) {
+    QList<Placement *> stepNodes;
+
+    if (step->csiItem) {
+      stepNodes << step->csiItem;
+    }
+    stepNodes << &step->pli << &step->stepNumber;
 
     for (int i = 0; i < step->list.size(); i++) {
       if (step->list[i]->relativeType == CalloutType) {
-        Callout *callout = step->list[i];
-        stepRelativeTo = callout->placement.value().relativeTo;
-        if (stepRelativeTo == relativeType) {
-          placeRelative(callout);
-          appendRelativeTo(callout);
+        stepNodes << step->list[i];
+      }
+    }
+
+    QList<Placement *> nodes;
+    graphNodes(this,nodes);
+
+    for (int i = 0; i < stepNodes.size(); i++) {
+      Placement    *node = stepNodes[i];
+      PlacementType type = node->placement.value().relativeTo;
+      Placement    *parent = NULL;
+
+      if (node == this) {
+        continue;
+      }
+
+      if (type == relativeType) {
+        parent = this;
+      }
+      for (int j = 0; parent == NULL && j < stepNodes.size(); j++) {
+        if (stepNodes[j] != node && stepNodes[j]->relativeType == type) {
+          parent = stepNodes[j];
+        }
+      }
+      for (int j = 0; parent == NULL && j < nodes.size(); j++) {
+        if (nodes[j] != node && nodes[j]->relativeType == type) {
+          parent = nodes[j];
+        }
+      }
+
+      if (parent) {
+        Placement *previous = node->relativeToParent;
+        if (previous && previous != parent) {
+          previous->relativeToList.removeAll(node);
         }
+        parent->appendRelativeTo(node);
       }
-    } // callouts
-    // Everything placed
-  } // if step
+    }
+
+    reportCycles(stepNodes);
+  }
 
-  /* try to find relation for things relative to us */
+  placeDependents();
 
-  int limit = relativeToList.size();
-  for (int i = 0; i < limit; i++) {
-    rc = relativeToList[i]->relativeTo(step);
-    if (rc) {
-      break;
+  return 0;
+}
+
+/*
+ * Place everything under us in the graph, parents before children.
+ */
+
+void Placement::placeDependents()
+{
+  QSet<Placement *>  placed;
+  QList<Placement *> pending;
+
+  placed.insert(this);
+  pending << this;
+
+  while (pending.size()) {
+    Placement *parent = pending.takeFirst();
+
+    for (int i = 0; i < parent->relativeToList.size(); i++) {
+      Placement *child = parent->relativeToList[i];
+
+      if (placed.contains(child)) {
+        continue;
+      }
+      placeNode(parent,child);
+      placed.insert(child);
+      pending << child;
     }
   }
+}
+
+void PlacementGraph::clear()
+{
+  root.relativeToList.clear();
+  root.relativeToParent = NULL;
+  root.boundingLoc[XX] = 0;
+  root.boundingLoc[YY] = 0;
+  items.clear();
+  nodes.clear();
+}
+
+void PlacementGraph::add(
+  Placement     *parent,
+  Placement     *node,
+  QGraphicsItem *item)
+{
+  parent->appendRelativeTo(node);
+  show(node,item);
+}
+
+void PlacementGraph::show(
+  Placement     *node,
+  QGraphicsItem *item)
+{
+  if (node && item) {
+    items.insert(node,item);
+    nodes.insert(item,node);
+  }
+}
+
+/*
+ * A thing shown by item was dragged, so the things placed relative to
+ * it, and to them, are placed again, parents before children, and their
+ * items moved to suit.
+ */
+
+void PlacementGraph::dragged(
+  QGraphicsItem *item)
+{
+  Placement *node = nodes.value(item);
+
+  if (node == NULL) {
+    return;
+  }
+
+  node->loc[XX] = int(item->pos().x());
+  node->loc[YY] = int(item->pos().y());
+
+  QSet<Placement *>  placed;
+  QList<Placement *> pending;
+
+  placed.insert(node);
+  pending << node;
+
+  while (pending.size()) {
+    Placement *parent = pending.takeFirst();
+
+    for (int i = 0; i < parent->relativeToList.size(); i++) {
+      Placement *child = parent->relativeToList[i];
 
-  return rc;
+      if (placed.contains(child)) {
+        continue;
+      }
+      placeNode(parent,child);
+
+      QList<QGraphicsItem *> shown = items.values(child);
+      for (int j = 0; j < shown.size(); j++) {
+        shown[j]->setPos(child->loc[XX],child->loc[YY]);
+      }
+      placed.insert(child);
+      pending << child;
+    }
+  }
 }
 
 int Placement::relativeToSg(
@@ -35,6 +35,7 @@
 #include <QGraphicsRectItem>
 #include <QSize>
 #include <QRect>
+#include <QHash>
 
 #include "meta.h"
 #include "metaitem.h"
@@ -208,6 +209,31 @@ class Placement {
       qreal topLeft[2],
       qreal size[2]);
 
+  private:
+    void placeDependents();
+};
+
+/*
+ * The things on a page, placed relative to one another, make a graph
+ * with the page at its root.  formatpage.cpp builds it once per page,
+ * from the page number, inserts and the step's things, and keeps it
+ * with the page along with the graphics items that show each thing.
+ * When one of those is dragged, only the things placed relative to it,
+ * directly or not, are placed again and moved.
+ */
+
+class PlacementGraph {
+  public:
+    Placement root;                     // the page
+
+    void clear();
+    void add(Placement *parent, Placement *node, QGraphicsItem *item);
+    void show(Placement *node, QGraphicsItem *item);
+    void dragged(QGraphicsItem *item);
+
+  private:
+    QMultiHash<Placement *, QGraphicsItem *> items;
+    QHash<QGraphicsItem *, Placement *>      nodes;
 };
 
 class PlacementPixmap : public Placement {
@@ -98,7 +98,7 @@ const QString relativeNames[NumRelatives] =
   "Page",        "Assem",   "Step Group",  "Step Number",
   "Parts List",  "Callout", "Page Number",
   "Single Step", "Submodel Instance Count", "Range",   "Step",        "Reserve",
-  "BOM", "Cover Page"
+  "BOM", "Cover Page", "Insert"
 };
 
 QString PlacementDialog::relativeToName(
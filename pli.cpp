@@ -32,6 +32,11 @@
 #include <QFileInfo>
 #include <QFile>
 #include <QTextStream>
+#include <QSet>
+#include <QCache>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QTime>
 #include "pli.h"
 #include "step.h"
 #include "ranges.h"
@@ -50,8 +55,16 @@
 #include "lpub_preferences.h"
 #include "ranges_element.h"
 #include "range_element.h"
-
-QCache<QString,QString> Pli::orientation;
+#include "geometry.h"
+#include "resample.h"
+#include "plilibrary.h"
+#include "libraryindex.h"
+#include "ldrawzip.h"
+#include "renderspool.h"
+#include "lmessagebox.h"
+
+QHash<QString, QVector<float> > Pli::orientations;
+QString                         Pli::orientationFiles;
     
 const Where &Pli::topOfStep()
 {
@@ -163,196 +176,413 @@ void Pli::setParts(
 
 void Pli::clear()
 {
+  foreach (PliPart *part, parts) {
+    delete part;
+  }
   parts.clear();
+  underCache.clear();
+  dropCache.clear();
 }
 
-QHash<int, QString>     annotationString;
-QList<QString>          titles;
+/*
+ * Parts whose titles match one of these patterns are annotated with what
+ * the pattern captures, like the length of an axle or a cable.  A
+ * pattern that captures nothing annotates its parts with the short name
+ * of their color from the color table, like "B" for blue.  The patterns
+ * can be replaced by putting them, one to a line, in titleAnnotations.lst
+ * next to the PLI orientation file.
+ *
+ * The annotation and sort class of a part depend only on its type, so
+ * each is worked out once per type, and the patterns are compiled once.
+ */
+
+static QList<QRegExp>          titleMatchers;
+static QHash<QString, QString> annotations;    // by lower case part type
+static QSet<QString>           byColor;        // types annotated by color
+static QHash<QString, QString> partClasses;    // by part type
 
 bool Pli::initAnnotationString()
 {
-  if (annotationString.empty()) {
-    annotationString[1] = "B";  // blue
-    annotationString[2] = "G";  // green
-    annotationString[3] = "DC"; // dark cyan
-    annotationString[4] = "R";  // red
-    annotationString[5] = "M";  // magenta
-    annotationString[6] = "Br"; // brown
-    annotationString[9] = "LB"; // light blue
-    annotationString[10]= "LG"; // light green
-    annotationString[11]= "C";  // cyan
-    annotationString[12]= "LR"; // cyan
-    annotationString[13]= "P";  // pink
-    annotationString[14]= "Y";  // yellow
-    annotationString[22]= "Ppl";// purple
-    annotationString[25]= "O";  // orange
-  
-    annotationString[32+1] = "TB";  // blue
-    annotationString[32+2] = "TG";  // green
-    annotationString[32+3] = "TDC"; // dark cyan
-    annotationString[32+4] = "TR";  // red
-    annotationString[32+5] = "TM";  // magenta
-    annotationString[32+6] = "TBr"; // brown
-    annotationString[32+9] = "TLB"; // light blue
-    annotationString[32+10]= "TLG"; // light green
-    annotationString[32+11]= "TC";  // cyan
-    annotationString[32+12]= "TLR"; // cyan
-    annotationString[32+13]= "TP";  // pink
-    annotationString[32+14]= "TY";  // yellow
-    annotationString[32+22]= "TPpl";// purple
-    annotationString[32+25]= "TO";  // orange
-    titles << "^Technic Axle\\s+(\\d+)\\s*.*$";
-    titles << "^Technic Axle Flexible\\s+(\\d+)\\s*$";
-    titles << "^Technic Beam\\s+(\\d+)\\s*$";
-    titles << "^Electric Cable RCX\\s+([0-9].*)$";
-
-    // additions by Danny
-    titles << "^Electric Mindstorms NXT Cable\\s+([0-9].*)$";
-    titles << "^Electric Mindstorms EV3 Cable\\s+([0-9].*)$";
-
-     // VEX parts annotations added by Danny on 14 April 2014
-    titles <<"^VEX Beam  1 x\\s+(\\d+)\\s*$";
-    titles <<"^VEX Beam  2 x\\s+(\\d+)\\s*$";
-    titles <<"^VEX Pin Standoff\\s+([0-9]*\\.?[0-9]*)\\sM$";
-
-    //titles <<"^VEX Beam .*(?=Bent).*(?=(\\d\\d))(\\d+)";
-    //titles <<"^VEX Beam .*(?=Bent).*(?=(\\d\\d))(?!90)(\\d+)";
-    //titles <<"^VEX Beam.*(?:Double Bent).*(?!90)(\\d\\d)$";
-    //titles <<"^VEX Beam .*(?=Bent).*(?!90)(\\d\\d)";
-    titles <<"^VEX Beam(?:\\s)(?:(?!Double Bent).)*(?!90)(\\d\\d)$";
-
-    titles <<"^VEX Plate  4 x\\s+(\\d+)\\s*$";
-    titles << "^VEX Axle\\s+(\\d+)\\s*.*$";
-    titles << "^VEX-2 Smart Cable\\s+([0-9].*)$";
-    titles <<"^VEX-2 Rubber Belt\\s+([0-9].*)Diameter";
+  if (titleMatchers.empty()) {
+    QStringList titles;
+
+    QFile file(QFileInfo(Preferences::pliFile).absolutePath() + "/titleAnnotations.lst");
+
+    if (file.open(QFile::ReadOnly | QFile::Text)) {
+      QTextStream in(&file);
 
+      while ( ! in.atEnd()) {
+        QString line = in.readLine(0).trimmed();
+        if (line.size() && line[0] != '#') {
+          titles << line;
+        }
+      }
+      file.close();
+    }
+
+    if (titles.empty()) {
+      titles << "^Technic Axle\\s+(\\d+)\\s*.*$";
+      titles << "^Technic Axle Flexible\\s+(\\d+)\\s*$";
+      titles << "^Technic Beam\\s+(\\d+)\\s*$";
+      titles << "^Electric Cable RCX\\s+([0-9].*)$";
+
+      // additions by Danny
+      titles << "^Electric Mindstorms NXT Cable\\s+([0-9].*)$";
+      titles << "^Electric Mindstorms EV3 Cable\\s+([0-9].*)$";
+
+       // VEX parts annotations added by Danny on 14 April 2014
+      titles <<"^VEX Beam  1 x\\s+(\\d+)\\s*$";
+      titles <<"^VEX Beam  2 x\\s+(\\d+)\\s*$";
+      titles <<"^VEX Pin Standoff\\s+([0-9]*\\.?[0-9]*)\\sM$";
+
+      //titles <<"^VEX Beam .*(?=Bent).*(?=(\\d\\d))(\\d+)";
+      //titles <<"^VEX Beam .*(?=Bent).*(?=(\\d\\d))(?!90)(\\d+)";
+      //titles <<"^VEX Beam.*(?:Double Bent).*(?!90)(\\d\\d)$";
+      //titles <<"^VEX Beam .*(?=Bent).*(?!90)(\\d\\d)";
+      titles <<"^VEX Beam(?:\\s)(?:(?!Double Bent).)*(?!90)(\\d\\d)$";
+
+      titles <<"^VEX Plate  4 x\\s+(\\d+)\\s*$";
+      titles << "^VEX Axle\\s+(\\d+)\\s*.*$";
+      titles << "^VEX-2 Smart Cable\\s+([0-9].*)$";
+      titles <<"^VEX-2 Rubber Belt\\s+([0-9].*)Diameter";
+    }
+
+    for (int i = 0; i < titles.size(); i++) {
+      titleMatchers << QRegExp(titles[i]);
+    }
+    annotations.clear();
+    byColor.clear();
   }
   return true;
 }
 
 void Pli::getAnnotate(
   QString &type,
+  QString &color,
   QString &annotateStr)
 {
-  annotateStr.clear();
-  if (titles.size() == 0) {
-    return;
-  }
+  QString lower = type.toLower();
 
-  annotateStr = PartsList::title(type.toLower());
+  QHash<QString, QString>::const_iterator memo = annotations.constFind(lower);
+  if (memo == annotations.constEnd()) {
+    QString title = PartsList::title(lower);
+    QString found;
+    bool    colored = false;
 
-  // pick up LSynth lengths
+    // pick up LSynth lengths
 
-  QString title;
-  for (int i = 0; i < titles.size(); i++) {
-    title = titles[i];
-    QRegExp rx(title);
-    if (annotateStr.contains(rx)) {
-      annotateStr = rx.cap(1);
+    for (int i = 0; i < titleMatchers.size(); i++) {
+      QRegExp &rx = titleMatchers[i];
+      if (rx.indexIn(title) != -1) {
+        colored = rx.numCaptures() == 0;
+        found   = rx.cap(1);
+        break;
+      }
+    }
+
+    // titles show up once the library index is ready
+
+    if (title.size() == 0) {
+      annotateStr = found;
       return;
     }
+    memo = annotations.insert(lower,found);
+    if (colored) {
+      byColor.insert(lower);
+    }
   }
 
-  annotateStr.clear();
-  return;
+  if (byColor.contains(lower)) {
+    int code;
+    annotateStr = LDrawColor::code(color,code) ? LDrawColor::abbreviation(code) : QString();
+  } else {
+    annotateStr = memo.value();
+  }
 }
 
-QString Pli::orient(QString &color, QString type)
+/*
+ * The orientation of each part in the PLI comes from the type 1 lines
+ * in Preferences::pliFile, and a project can change or add to them with
+ * its own LPub/pli.mpd.  Both are parsed into a table the first time it
+ * is needed, and again when either of them changes.  Parts not in either
+ * are shown the way they are in the library.
+ */
+
+void Pli::loadOrientations(const QString &fileName)
 {
-  type = type.toLower();
+  QFile file(fileName);
 
-  float a = 1, b = 0, c = 0;
-  float d = 0, e = 1, f = 0;
-  float g = 0, h = 0, i = 1;
+  if ( ! file.open(QFile::ReadOnly | QFile::Text)) {
+    return;
+  }
 
-  QString *cached = orientation[type];
+  QTextStream   in(&file);
+  QSet<QString> seen;
 
-  if ( ! cached) {
-    QString name(Preferences::pliFile);
-    QFile file(name);
-  
-    if (file.open(QFile::ReadOnly | QFile::Text)) {      
-      QTextStream in(&file);
-  
-      while ( ! in.atEnd()) {
-        QString line = in.readLine(0);
-        QStringList tokens;
- 
-        split(line,tokens);
+  while ( ! in.atEnd()) {
+    QString line = in.readLine(0);
+    QStringList tokens;
 
-        if (tokens.size() != 15) {
-          continue;
-        }
+    split(line,tokens);
 
-        QString token14 = tokens[14].toLower();
+    if (tokens.size() != 15 || tokens[0] != "1") {
+      continue;
+    }
 
-        if (tokens.size() == 15 && tokens[0] == "1" && token14 == type) {
-          cached = new QString(line);
-          orientation.insert(type,cached);
-          break;
-        }
-      }
-      file.close();
+    // the first line for a part in a file is the one that counts
+
+    QString type = tokens[14].toLower();
+
+    if (seen.contains(type)) {
+      continue;
     }
+    seen.insert(type);
+
+    QVector<float> matrix(9);
+    for (int e = 0; e < 9; e++) {
+      matrix[e] = tokens[5+e].toFloat();
+    }
+    orientations.insert(type,matrix);
   }
+  file.close();
+}
 
-  if (cached) {
-    QStringList tokens;
+/*
+ * The orientation files are looked at again at most once a second, or
+ * when a project in another directory is opened, rather than for every
+ * part.
+ */
 
-    split(*cached, tokens);
+void Pli::orientation(const QString &type, float matrix[3][3])
+{
+  static QTime   checked;
+  static QString checkedPath;
+
+  QString current = QDir::currentPath();
+
+  if ( ! checked.isValid() || checked.elapsed() > 1000 || current != checkedPath) {
+    QString   local = current + "/" + Paths::lpubDir + "/pli.mpd";
+    QFileInfo pliInfo(Preferences::pliFile);
+    QFileInfo localInfo(local);
+
+    QString files = QString("%1 %2 %3 %4")
+                      .arg(Preferences::pliFile)
+                      .arg(pliInfo.exists() ? pliInfo.lastModified().toTime_t() : 0)
+                      .arg(local)
+                      .arg(localInfo.exists() ? localInfo.lastModified().toTime_t() : 0);
+
+    if (files != orientationFiles) {
+      orientationFiles = files;
+      orientations.clear();
+      loadOrientations(Preferences::pliFile);
+      loadOrientations(local);
+    }
+    checked.start();
+    checkedPath = current;
+  }
 
-    if (tokens.size() == 15 && tokens[0] == "1") {
-      a = tokens[5].toFloat();
-      b = tokens[6].toFloat();
-      c = tokens[7].toFloat();
-      d = tokens[8].toFloat();
-      e = tokens[9].toFloat();
-      f = tokens[10].toFloat();
-      g = tokens[11].toFloat();
-      h = tokens[12].toFloat();
-      i = tokens[13].toFloat();
+  QHash<QString, QVector<float> >::const_iterator i =
+    orientations.constFind(type.toLower());
+
+  for (int e = 0; e < 9; e++) {
+    if (i != orientations.constEnd()) {
+      matrix[e/3][e%3] = i.value()[e];
+    } else {
+      matrix[e/3][e%3] = e % 4 == 0;
     }
   }
+}
+
+QString Pli::orient(QString &color, QString type, float matrix[3][3])
+{
+  type = type.toLower();
+
+  float a = matrix[0][0], b = matrix[0][1], c = matrix[0][2];
+  float d = matrix[1][0], e = matrix[1][1], f = matrix[1][2];
+  float g = matrix[2][0], h = matrix[2][1], i = matrix[2][2];
+
+  // put the middle of the part at the origin, so the renderer can
+  // use an image that just fits around it
+
+  float x = 0, y = 0, z = 0;
+  BoundingBox box;
+
+  if (PartGeometry::boundingBox(type,box)) {
+    x = -(a*box.center(0) + b*box.center(1) + c*box.center(2));
+    y = -(d*box.center(0) + e*box.center(1) + f*box.center(2));
+    z = -(g*box.center(0) + h*box.center(1) + i*box.center(2));
+  }
 
-  return QString ("1 %1 0 0 0 %2 %3 %4 %5 %6 %7 %8 %9 %10 %11")
+  return QString ("1 %1 %2 %3 %4 %5 %6 %7 %8 %9 %10 %11 %12 %13 %14")
     .arg(color)
+    .arg(x) .arg(y) .arg(z)
     .arg(a) .arg(b) .arg(c)
     .arg(d) .arg(e) .arg(f)
     .arg(g) .arg(h) .arg(i)
     .arg(type);
 }
 
-int Pli::createPartImage(
+/*
+ * The parts list library's name for an image: everything that goes into
+ * rendering it, including which file the part comes from and when that
+ * last changed, so editing a part or updating the library makes new
+ * images.  Parts that can't be found in the library get no name, and
+ * aren't shared.
+ */
+
+QString Pli::libraryKey(
+  const QString &ldr,
+  const QString &type,
+  bool           resample,
+  float          modelScale)
+{
+  QString path;
+
+  if ( ! LibraryIndex::find(type,&path)) {
+    const QStringList &roots = LibraryIndex::roots();
+    QString            name  = QString(type).replace('\\','/');
+
+    for (int r = 0; r < roots.size(); r++) {
+      if (LDrawZip::exists(Preferences::ldrawPath + roots[r] + name)) {
+        path = roots[r].mid(1) + name;
+        break;
+      }
+    }
+    if (path == "") {
+      return "";
+    }
+  }
+
+  QStringList description;
+  description << ldr
+              << path
+              << QString::number(LDrawZip::lastModified(Preferences::ldrawPath + "/" + path))
+              << Render::getRenderer()
+              << pliMeta.ldgliteParms.value()
+              << pliMeta.ldviewParms.value()
+              << pliMeta.l3pParms.value()
+              << pliMeta.povrayParms.value()
+              << QString("%1 %2") .arg(pliMeta.angle.value(0))
+                                  .arg(pliMeta.angle.value(1));
+  if (resample) {
+    description << QString("REF %1") .arg(meta->LPub.renderCache.resolution.value());
+  } else {
+    description << QString("%1 %2 %3 %4")
+                     .arg(modelScale)
+                     .arg(resolution())
+                     .arg(meta->LPub.page.size.valuePixels(0))
+                     .arg(meta->LPub.page.size.valuePixels(1));
+  }
+  return PliLibrary::key(description);
+}
+
+/*
+ * Images handed to the render spool that have not shown up yet, and the
+ * library keys to publish them under when they do.  Images are only put
+ * in the library right after they are made, so finding one that is
+ * already there doesn't cost a look at the (maybe remote) library.
+ */
+
+static QHash<QString, QString> spooled;
+
+/*
+ * Makes sure the part's image is rendered, and hands back its file name.
+ * A render handed to the spool returns 0 before the image exists.
+ */
+
+int Pli::renderPartImage(
   QString  &partialKey,
   QString  &type,
   QString  &color,
-  QPixmap  *pixmap)
+  QString  &imageName)
 {
   float modelScale = pliMeta.modelScale.value();
   QString        unitsName = resolutionType() ? "DPI" : "DPCM";
 
-  QString key = QString("%1_%2_%3_%4_%5_%6_%7")
-                    .arg(partialKey) 
+  QString settings = QString("%1_%2_%3_%4_%5_%6")
                     .arg(meta->LPub.page.size.valuePixels(0)) 
                     .arg(resolution())
                     .arg(resolutionType() == DPI ? "DPI" : "DPCM")
                     .arg(modelScale)
                     .arg(pliMeta.angle.value(0))
                     .arg(pliMeta.angle.value(1));
-  QString imageName = QDir::currentPath() + "/" +
-                      Paths::partsDir + "/" + key + ".png";
+  QString key = partialKey + "_" + settings;
+  imageName = QDir::currentPath() + "/" +
+              Paths::partsDir + "/" + key + ".png";
   QString ldrName = QDir::currentPath() + "/" + 
                     Paths::tmpDir + "/pli.ldr";
-  QFile part(imageName);
 
-  if ( ! part.exists()) {
+  /*
+   * When recoloring, the part is rendered once in the neutral color,
+   * and imageName is made from the neutral image of the same size.
+   */
+
+  bool    recolor = pliMeta.recolor.value() && recolorable(color);
+  QString renderKey = partialKey;
+  QString renderColor = color;
+  QString sizedName = imageName;
+
+  if (recolor) {
+    renderKey = QFileInfo(type).baseName() + "_NEUTRAL";
+    renderColor = neutralColor();
+    sizedName = QDir::currentPath() + "/" +
+                  Paths::partsDir + "/" + renderKey + "_" + settings + ".png";
+  }
+
+  /*
+   * When resampling, the part is rendered once at the reference
+   * resolution, and sizedName is made from that.
+   */
+
+  float   factor;
+  bool    resample = ReferenceRender::use(*meta,modelScale,factor);
+  QString renderName = sizedName;
+
+  if (resample) {
+    QString refKey = QString("%1_REF_%2_%3_%4")
+                       .arg(renderKey)
+                       .arg(meta->LPub.renderCache.resolution.value())
+                       .arg(pliMeta.angle.value(0))
+                       .arg(pliMeta.angle.value(1));
+    renderName = QDir::currentPath() + "/" +
+                   Paths::partsDir + "/" + refKey + ".png";
+  }
+
+  /*
+   * Rendered images are shared with other projects through the parts
+   * list image library, except for submodels, which are the project's
+   * own.
+   */
+
+  bool shared = ! gui->isSubmodel(type);
+
+  float matrix[3][3];
+  orientation(type,matrix);
+
+  QString ldr = orient(renderColor, type, matrix);
+
+  QString libraryName;    // only worked out when the image isn't here
+
+  QFile part(renderName);
+
+  if (part.exists()) {
+
+    // an image a render worker was asking for has shown up, so share it
+
+    if (spooled.contains(renderName)) {
+      PliLibrary::publish(spooled.take(renderName),renderName);
+    }
+
+  } else if ( ! shared ||
+              (libraryName = libraryKey(ldr,type,resample,modelScale)) == "" ||
+              ! PliLibrary::fetch(libraryName,renderName)) {
 
     // create a temporary DAT to feed to LDGLite
   
     part.setFileName(ldrName);
   
     if ( ! part.open(QIODevice::WriteOnly)) {
-      QMessageBox::critical(NULL,QMessageBox::tr(LPUB),
+      LMessageBox::critical(NULL,QMessageBox::tr(LPUB),
                          QMessageBox::tr("Cannot open file for writing %1:\n%2.")
                          .arg(ldrName)
                          .arg(part.errorString()));
@@ -360,34 +590,142 @@ int Pli::createPartImage(
     }
   
     QTextStream out(&part);
-    out << orient(color, type);
+    out << ldr;
     part.close();
       
     // feed DAT to LDGLite
   
-    int rc = renderer->renderPli(ldrName,imageName,*meta, bom);
+    int rc;
+
+    {
+      ReferenceRender reference(*meta,bom ? meta->LPub.bom.modelScale
+                                          : meta->LPub.pli.modelScale,
+                                resample);
+      rc = renderer->renderPli(ldrName,renderName,*meta, bom);
+    }
+  
+    // the image shows up once a render worker gets to it
+
+    if (rc == RenderSpool::Queued) {
+      if (libraryName != "") {
+        spooled.insert(renderName,libraryName);
+      }
+      return 0;
+    }
   
     if (rc != 0) {
-      QMessageBox::warning(NULL,QMessageBox::tr(LPUB),
+      LMessageBox::warning(NULL,QMessageBox::tr(LPUB),
                          QMessageBox::tr("Render failed for %1 %2\n")
-                         .arg(imageName)
+                         .arg(renderName)
                          .arg(Paths::tmpDir+"/part.dat"));
       return -1;
     }
+
+    if (libraryName != "") {
+      PliLibrary::publish(libraryName,renderName);
+    }
   } 
-  pixmap->load(imageName);
+
+  if (resample && isStale(sizedName,renderName)) {
+    if ( ! resampleImage(renderName,sizedName,factor)) {
+      LMessageBox::warning(NULL,QMessageBox::tr(LPUB),
+                           QMessageBox::tr("Failed to resample %1")
+                           .arg(renderName));
+      return -1;
+    }
+  }
+
+  if (recolor && isStale(imageName,sizedName)) {
+    if ( ! recolorImage(sizedName,imageName,color)) {
+      LMessageBox::warning(NULL,QMessageBox::tr(LPUB),
+                           QMessageBox::tr("Failed to recolor %1")
+                           .arg(sizedName));
+      return -1;
+    }
+  }
+
   return 0;
 }
 
+int Pli::createPartImage(
+  QString  &partialKey,
+  QString  &type,
+  QString  &color,
+  QPixmap  *pixmap)
+{
+  QString   imageName;
+  PartImage partImage;
+
+  int rc = renderPartImage(partialKey,type,color,imageName);
+
+  if (rc == 0 && loadPartImage(imageName,partImage)) {
+    *pixmap = partImage.pixmap;
+  }
+  return rc;
+}
+
+/*
+ * Reading a part image and scanning it for its edges is most of the
+ * work of sizing a PLI, and the same images come up on every redraw.
+ * So each image is read and scanned once, and remembered by its file
+ * name and time, which change whenever it is rendered again.  The cache
+ * cost is the image's size in kilobytes.
+ */
+
+static QCache<QString, PartImage> partImages(64*1024);
+
+bool Pli::loadPartImage(
+  const QString &imageName,
+  PartImage     &partImage)
+{
+  QFileInfo info(imageName);
+
+  if ( ! info.exists()) {
+    return false;
+  }
+
+  QString key = QString("%1_%2_%3")
+                  .arg(imageName)
+                  .arg(info.lastModified().toTime_t())
+                  .arg(info.size());
+
+  PartImage *cached = partImages.object(key);
+
+  if (cached) {
+    partImage = *cached;
+    return true;
+  }
+
+  if ( ! partImage.pixmap.load(imageName)) {
+    return false;
+  }
+
+  QImage image = partImage.pixmap.toImage();
+
+  getLeftEdge(image,partImage.leftEdge);
+  getRightEdge(image,partImage.rightEdge);
+
+  partImages.insert(key,new PartImage(partImage),
+                    qMax(1,image.width()*image.height()*4/1024));
+  return true;
+}
+
 void Pli::partClass(
   QString &type,
   QString &pclass)
 {
-  pclass = PartsList::title(type);
+  QHash<QString, QString>::const_iterator memo = partClasses.constFind(type);
+  if (memo != partClasses.constEnd()) {
+    pclass = memo.value();
+    return;
+  }
+
+  static QRegExp rx("^(\\w+)\\s+([0-9a-zA-Z]+).*$");
+
+  QString title = PartsList::title(type);
 
-  if (pclass.length()) {
-    QRegExp rx("^(\\w+)\\s+([0-9a-zA-Z]+).*$");
-    if (pclass.contains(rx)) {
+  if (title.length()) {
+    if (rx.indexIn(title) != -1) {
       pclass = rx.cap(1);
       if (rx.numCaptures() == 2 && rx.cap(1) == "Technic") {
         pclass += rx.cap(2);
@@ -395,11 +733,108 @@ void Pli::partClass(
     } else {
       pclass = "ZZZ";
     }
+    partClasses.insert(type,pclass);
   } else {
     pclass = "ZZZ";
   }
 }
 
+/*
+ * Whether part fits under the right side of prevPart, the first part of
+ * a column, and how far part can drop down into prevPart when stacked
+ * on it.  Both depend only on the two parts, and the same pairs come up
+ * over and over as resizePli tries different heights, so they are
+ * remembered until the parts change.
+ */
+
+bool Pli::fitsUnder(PliPart *prevPart, PliPart *part)
+{
+  QPair<PliPart *, PliPart *> pair(prevPart,part);
+  QHash<QPair<PliPart *, PliPart *>, int>::const_iterator i = underCache.constFind(pair);
+
+  if (i != underCache.constEnd()) {
+    return i.value();
+  }
+
+  int xMargin = qMax(prevPart->csiMargin.valuePixels(XX),
+                     part->csiMargin.valuePixels(XX));
+  int yMargin = qMax(prevPart->csiMargin.valuePixels(YY),
+                     part->csiMargin.valuePixels(YY));
+
+  // Do they overlap?
+
+  int top;
+  for (top = 0; top < part->height; top++) {
+    int ltop  = prevPart->height - part->height - yMargin + top;
+    if (ltop >= 0 && ltop < prevPart->height) {
+      if (prevPart->rightEdge[ltop] + xMargin >
+          prevPart->width - part->width + part->leftEdge[top]) {
+        break;
+      }
+    }
+  }
+
+  bool fits = top == part->height;
+  underCache.insert(pair,fits);
+  return fits;
+}
+
+int Pli::dropInto(PliPart *prevPart, PliPart *part)
+{
+  QPair<PliPart *, PliPart *> pair(prevPart,part);
+  QHash<QPair<PliPart *, PliPart *>, int>::const_iterator i = dropCache.constFind(pair);
+
+  if (i != dropCache.constEnd()) {
+    return i.value();
+  }
+
+  int  splitMargin = qMax(prevPart->topMargin,part->csiMargin.valuePixels(YY));
+  bool overlapped = false;
+  int  overlap;
+
+  // dropping part down into prev part (top part is right edge, bottom left)
+
+  for (overlap = 1; overlap < prevPart->height && ! overlapped; overlap++) {
+    if (overlap > part->height) { // in over our heads?
+
+      // slide the part from the left to right until it bumps into previous
+      // part
+      for (int right = 0, left = 0;
+               right < part->height;
+               right++,left++) {
+        if (part->rightEdge[right] + splitMargin > 
+            prevPart->leftEdge[left+overlap-part->height]) {
+          overlapped = true;
+          break;
+        }
+      }
+    } else {
+      // slide the part from the left to right until it bumps into previous
+      // part
+      for (int right = part->height - overlap - 1, left = 0;
+               right < part->height && left < overlap;
+               right++,left++) {
+        if (right >= 0 && part->rightEdge[right] + splitMargin > 
+            prevPart->leftEdge[left]) {
+          overlapped = true;
+          break;
+        }
+      }
+    }
+  }
+
+  dropCache.insert(pair,overlap);
+  return overlap;
+}
+
+/*
+ * Parts are placed in columns, in sorted order.  A column is started
+ * with the first unplaced part, and then each part is stacked on the one
+ * before it, using the first unplaced part that keeps the column within
+ * yConstraint.  Parts are placed mostly in order, so the searches for
+ * unplaced parts start at the first one.
+ */
+
 int Pli::placePli(
   QList<QString> &keys,
   int    xConstraint,
@@ -425,38 +860,46 @@ int Pli::placePli(
   width = 0;
   height = 0;
 
-  QString key;
+  int nParts = keys.size();
 
-  for (int i = 0; i < keys.size(); i++) {
-    parts[keys[i]]->placed = false;
-    if (parts[keys[i]]->height > yConstraint) {
-      yConstraint = parts[keys[i]]->height;
+  QVector<PliPart *> list(nParts);
+
+  for (int i = 0; i < nParts; i++) {
+    list[i] = parts[keys[i]];
+    list[i]->placed = false;
+    if (list[i]->height > yConstraint) {
+      yConstraint = list[i]->height;
       // return -2;
     }
   }
 
+  int first = 0;   // the first unplaced part
+
   QList< QPair<int, int> > margins;
 
-  while (nPlaced < keys.size()) {
+  while (nPlaced < nParts) {
 
     int i;
     PliPart *part = NULL;
 
-    for (i = 0; i < keys.size(); i++) {
-      QString key = keys[i];
-      part = parts[key];
+    while (first < nParts && list[first]->placed) {
+      first++;
+    }
+
+    for (i = first; i < nParts; i++) {
+      part = list[i];
       if ( ! part->placed && left + part->width < xConstraint) {
         break;
       }
     }
 
-    if (i == keys.size()) {
+    if (i == nParts) {
       return -1;
     }
 
     /* Start new col */
 
-    PliPart *prevPart = parts[keys[i]];
+    PliPart *prevPart = list[i];
 
     cols++;
 
@@ -490,32 +933,17 @@ int Pli::placePli(
     // lets see if any unplaced part fits under the right side
     // of the first part of the column
 
+    while (first < nParts && list[first]->placed) {
+      first++;
+    }
+
     bool fits = false;
-    for (i = 0; i < keys.size() && ! fits; i++) {
-      part = parts[keys[i]];
-
-      if ( ! part->placed) {
-        int xMargin = qMax(prevPart->csiMargin.valuePixels(XX),
-                           part->csiMargin.valuePixels(XX));
-        int yMargin = qMax(prevPart->csiMargin.valuePixels(YY),
-                           part->csiMargin.valuePixels(YY));
-
-        // Do they overlap?
-
-        int top;
-        for (top = 0; top < part->height; top++) {
-          int ltop  = prevPart->height - part->height - yMargin + top;
-          if (ltop >= 0 && ltop < prevPart->height) {
-            if (prevPart->rightEdge[ltop] + xMargin >
-                prevPart->width - part->width + part->leftEdge[top]) {
-              break;
-            }
-          }
-        }
-        if (top == part->height) {
-          fits = true;
-          break;
-        }
+    for (i = first; i < nParts && ! fits; i++) {
+      part = list[i];
+
+      if ( ! part->placed && fitsUnder(prevPart,part)) {
+        fits = true;
+        break;
       }
     }
     if (fits) {
@@ -528,73 +956,43 @@ int Pli::placePli(
 
     // allocate new row
 
-    while (nPlaced < parts.size()) {
+    while (nPlaced < nParts) {
 
       int overlap = 0;
 
-      bool overlapped = false;
-
       // new possible upstairs neighbors
 
-      for (i = 0; i < keys.size() && ! overlapped; i++) {
-        PliPart *part = parts[keys[i]];
-
-        if ( ! part->placed) {
+      while (first < nParts && list[first]->placed) {
+        first++;
+      }
 
-          int splitMargin = qMax(prevPart->topMargin,part->csiMargin.valuePixels(YY));
+      int splitMargin = 0;
 
-          // dropping part down into prev part (top part is right edge, bottom left)
+      for (i = first; i < nParts; i++) {
+        PliPart *part = list[i];
 
-          for (overlap = 1; overlap < prevPart->height && ! overlapped; overlap++) {
-            if (overlap > part->height) { // in over our heads?
+        if ( ! part->placed) {
 
-              // slide the part from the left to right until it bumps into previous
-              // part
-              for (int right = 0, left = 0;
-                       right < part->height;
-                       right++,left++) {
-                if (part->rightEdge[right] + splitMargin > 
-                    prevPart->leftEdge[left+overlap-part->height]) {
-                  overlapped = true;
-                  break;
-                }
-              }
-            } else {
-              // slide the part from the left to right until it bumps into previous
-              // part
-              for (int right = part->height - overlap - 1, left = 0;
-                       right < part->height && left < overlap;
-                       right++,left++) {
-                if (right >= 0 && part->rightEdge[right] + splitMargin > 
-                    prevPart->leftEdge[left]) {
-                  overlapped = true;
-                  break;
-                }
-              }
-            }
-          }
+          splitMargin = qMax(prevPart->topMargin,part->csiMargin.valuePixels(YY));
 
-          // overlap = 0;
+          overlap = dropInto(prevPart,part);
 
           if (bot + part->height + splitMargin - overlap <= yConstraint) {
             bot += splitMargin;
             break;
-          } else {
-            overlapped = false;
           }
         }
       }
 
-      if (i == keys.size()) {
+      if (i == nParts) {
         break; // we can't go more Vertical in this column
       }
 
-      PliPart *part = parts[keys[i]];
+      PliPart *part = list[i];
 
       margin.first    = part->csiMargin.valuePixels(XX);
-      int splitMargin = qMax(prevPart->topMargin,part->csiMargin.valuePixels(YY));
 
-      prevPart = parts[keys[i]];
+      prevPart = list[i];
 
       prevPart->left = left;
       prevPart->bot  = bot - overlap;
@@ -619,12 +1017,12 @@ int Pli::placePli(
 
         // allocate new sub_col
 
-        while (nPlaced < keys.size() && i < parts.size()) {
+        while (nPlaced < nParts && i < nParts) {
 
-          PliPart *part = parts[keys[i]];
+          PliPart *part = list[i];
           int subMargin = 0;
-          for (i = 0; i < keys.size(); i++) {
-            part = parts[keys[i]];
+          for (i = 0; i < nParts; i++) {
+            part = list[i];
             if ( ! part->placed) {
               subMargin = qMax(prevPart->csiMargin.valuePixels(XX),part->csiMargin.valuePixels(XX));
               if (subLeft + subMargin + part->width <= right &&
@@ -634,7 +1032,7 @@ int Pli::placePli(
             }
           }
 
-          if (i == parts.size()) {
+          if (i == nParts) {
             break;
           }
 
@@ -648,10 +1046,10 @@ int Pli::placePli(
 
           // try to place sub_row
 
-          while (nPlaced < parts.size()) {
+          while (nPlaced < nParts) {
 
-            for (i = 0; i < parts.size(); i++) {
-              part = parts[keys[i]];
+            for (i = 0; i < nParts; i++) {
+              part = list[i];
               subMargin = qMax(prevPart->csiMargin.valuePixels(XX),part->csiMargin.valuePixels(XX));
               if ( ! part->placed &&
                   subBot + part->height + splitMargin <= top &&
@@ -660,7 +1058,7 @@ int Pli::placePli(
               }
             }
 
-            if (i == parts.size()) {
+            if (i == nParts) {
               break;
             }
 
@@ -688,7 +1086,7 @@ int Pli::placePli(
 
     left += width;
 
-    part = parts[keys[widest]];
+    part = list[widest];
     if (part->annotWidth) {
       margin.second = qMax(part->annotateMeta.margin.valuePixels(XX),part->csiMargin.valuePixels(XX));
     } else {
@@ -699,9 +1097,13 @@ int Pli::placePli(
 
   width = left;
 
+  // each column is moved right by its margin and those of the columns
+  // left of it
+
   int margin;
   int totalCols = margins.size();
   int lastMargin = 0;
+  QVector<int> shift(totalCols + 1);
   for (int col = 0; col < totalCols; col++) {
     lastMargin = margins[col].second;
     if (col == 0) {
@@ -710,13 +1112,13 @@ int Pli::placePli(
     } else {
       margin = qMax(margins[col].first,margins[col].second);
     }
-    for (int i = 0; i < parts.size(); i++) {
-      if (parts[keys[i]]->col >= col+1) {
-        parts[keys[i]]->left += margin;
-      }
-    }
+    shift[col + 1] = shift[col] + margin;
     width += margin;
   }
+  for (int i = 0; i < nParts; i++) {
+    int col = qMin(qMax(list[i]->col,0),totalCols);
+    list[i]->left += shift[col];
+  }
   if (lastMargin < borderData.margin[0]+borderData.thickness) {
     lastMargin = int(borderData.margin[0]+borderData.thickness);
   }
@@ -724,8 +1126,8 @@ int Pli::placePli(
 
   height = tallest;
 
-  for (int i = 0; i < parts.size(); i++) {
-    parts[keys[i]]->bot += botMargin;
+  for (int i = 0; i < nParts; i++) {
+    list[i]->bot += botMargin;
   }
 
   height += botMargin + topMargin;
@@ -780,38 +1182,49 @@ void Pli::placeCols(
   size[1] = int(topMargin + height + botMargin);
 }
 
+/*
+ * The edges are found by walking the scan lines of the image directly,
+ * rather than asking for one pixel at a time.
+ */
+
 void Pli::getLeftEdge(
-  QImage     &image,
-  QList<int> &edge)
+  QImage       &image,
+  QVector<int> &edge)
 {
-  QImage alpha = image.alphaChannel();
+  const QImage argb = image.convertToFormat(QImage::Format_ARGB32);
+  int    width = argb.width();
+
+  edge.reserve(edge.size() + argb.height());
 
-  for (int y = 0; y < alpha.height(); y++) {
+  for (int y = 0; y < argb.height(); y++) {
+    const QRgb *line = (const QRgb *) argb.scanLine(y);
     int x;
-    for (x = 0; x < alpha.width(); x++) {
-      QColor c = alpha.pixel(x,y);
-      if (c.blue()) {
+    for (x = 0; x < width; x++) {
+      if (qAlpha(line[x])) {
         edge << x;
         break;
       }
     }
-    if (x == alpha.width()) {
+    if (x == width) {
       edge << x - 1;
     }
   }
 }
 
 void Pli::getRightEdge(
-  QImage     &image,
-  QList<int> &edge)
+  QImage       &image,
+  QVector<int> &edge)
 {
-  QImage alpha = image.alphaChannel();
+  const QImage argb = image.convertToFormat(QImage::Format_ARGB32);
+  int    width = argb.width();
 
-  for (int y = 0; y < alpha.height(); y++) {
+  edge.reserve(edge.size() + argb.height());
+
+  for (int y = 0; y < argb.height(); y++) {
+    const QRgb *line = (const QRgb *) argb.scanLine(y);
     int x;
-    for (x = alpha.width() - 1; x >= 0; x--) {
-      QColor c = alpha.pixel(x,y);
-      if (c.blue()) {
+    for (x = width - 1; x >= 0; x--) {
+      if (qAlpha(line[x])) {
         edge << x;
         break;
       }
@@ -846,31 +1259,24 @@ int Pli::sortPli()
 
       QFileInfo info(part->type);
 
-      QString imageName = Paths::partsDir + "/" + key + ".png";
-
-      QPixmap *pixmap = new QPixmap();
-      
-      if (pixmap == NULL) {
-        return -1;
-      }
+      QString   imageName = Paths::partsDir + "/" + key + ".png";
+      PartImage partImage;
 
-      if (createPartImage(key,part->type,part->color,pixmap)) {
-        QMessageBox::warning(NULL,QMessageBox::tr("LPub"),
+      if (renderPartImage(key,part->type,part->color,imageName)) {
+        LMessageBox::warning(NULL,QMessageBox::tr("LPub"),
         QMessageBox::tr("Failed to load %1")
         .arg(imageName));
         return -1;
       }
 
-      QImage image = pixmap->toImage();
+      loadPartImage(imageName,partImage);
 
-      part->pixmap = new PGraphicsPixmapItem(this,part,*pixmap,parentRelativeType,part->type, part->color);
+      part->pixmap = new PGraphicsPixmapItem(this,part,partImage.pixmap,parentRelativeType,part->type, part->color);
 
-      delete pixmap;
-
-      part->pixmapWidth  = image.width(); 
-      part->pixmapHeight = image.height();
+      part->pixmapWidth  = partImage.pixmap.width(); 
+      part->pixmapHeight = partImage.pixmap.height();
      
-      part->width  = image.width();
+      part->width  = partImage.pixmap.width();
 
       /* Add instance count area */
 
@@ -899,7 +1305,7 @@ int Pli::sortPli()
 
       /* Add annotation area */
 
-      getAnnotate(part->type,descr);
+      getAnnotate(part->type,part->color,descr);
 
       if (descr.size()) {
 
@@ -928,8 +1334,8 @@ int Pli::sortPli()
         part->partTopMargin = 0;
       }
       part->topMargin = part->csiMargin.valuePixels(YY);
-      getLeftEdge(image,part->leftEdge);
-      getRightEdge(image,part->rightEdge);
+      part->leftEdge  += partImage.leftEdge;
+      part->rightEdge += partImage.rightEdge;
 
       part->partBotMargin = part->instanceMeta.margin.valuePixels(YY);
 
@@ -980,18 +1386,22 @@ int Pli::sortPli()
     }
   }
 
-  sortedKeys = parts.keys();
+  underCache.clear();
+  dropCache.clear();
 
-  // We got all the sizes for parts for a given step so sort
+  // We got all the sizes for parts for a given step so sort, from the
+  // greatest sort key down
 
-  for (int i = 0; i < parts.size() - 1; i++) {
-    for (int j = i+1; j < parts.size(); j++) {
-      if (parts[sortedKeys[i]]->sort < parts[sortedKeys[j]]->sort) {
-        QString t = sortedKeys[i];
-        sortedKeys[i] = sortedKeys[j];
-        sortedKeys[j] = t;
-      }
-    }
+  QList< QPair<QString, QString> > sorts;
+  QHash<QString, PliPart*>::const_iterator i;
+  for (i = parts.constBegin(); i != parts.constEnd(); ++i) {
+    sorts << qMakePair(i.value()->sort,i.key());
+  }
+  qSort(sorts.begin(),sorts.end(),qGreater< QPair<QString, QString> >());
+
+  sortedKeys.clear();
+  for (int s = 0; s < sorts.size(); s++) {
+    sortedKeys << sorts[s].second;
   }
   
   return 0;
@@ -1036,6 +1446,184 @@ int Pli::sizePli(ConstrainData::PliConstrain constrain, unsigned height)
   return 1;
 }
 
+int Pli::placeAt(
+  int  yConstraint,
+  int &cols,
+  int &width,
+  int &height)
+{
+  return placePli(sortedKeys,10000000,
+                  yConstraint,
+                  pliMeta.pack.value(),
+                  pliMeta.sort.value(),
+                  cols,
+                  width,
+                  height);
+}
+
+/*
+ * Taller columns usually mean fewer of them, so this binary searches
+ * from low to high for a height that needs no more than maxCols.  The
+ * column packing is greedy and does not promise that, so the height
+ * found always fits in maxCols, but need not be the least one that
+ * does.  Build with PLI_SEARCH_CHECK to compare against a linear scan.
+ */
+
+int Pli::leastHeight(int low, int high, int maxCols)
+{
+  int cols, width, height;
+
+  low = qMax(low,1);
+
+  while (low < high) {
+    int mid = low + (high - low)/2;
+
+    placeAt(mid,cols,width,height);
+
+    if (cols <= maxCols) {
+      high = mid;
+    } else {
+      low = mid + 1;
+    }
+  }
+  return high;
+}
+
+#ifdef PLI_SEARCH_CHECK
+
+/*
+ * How good the layout at height is for the constraint, the lower the
+ * better, or -1 if it does not meet the constraint.
+ */
+
+int Pli::layoutMeasure(const ConstrainData &constrainData, int height)
+{
+  int cols, pliWidth, pliHeight;
+
+  placeAt(height,cols,pliWidth,pliHeight);
+
+  int h = 0;
+  int w = 0;
+
+  for (int i = 0; i < sortedKeys.size(); i++) {
+    PliPart *part = parts[sortedKeys[i]];
+    h = qMax(h,part->bot  + part->height);
+    w = qMax(w,part->left + part->width);
+  }
+
+  switch (constrainData.type) {
+    case ConstrainData::PliConstrainColumns:
+      return cols <= int(constrainData.constraint) ? pliHeight : -1;
+    case ConstrainData::PliConstrainWidth:
+      return w < constrainData.constraint ? pliHeight : -1;
+    case ConstrainData::PliConstrainArea:
+      return w*h;
+    case ConstrainData::PliConstrainSquare:
+      return qAbs(pliWidth - pliHeight);
+    default:
+    break;
+  }
+  return -1;
+}
+
+/*
+ * Lays the PLI out at the heights the linear scans used to try, and
+ * warns when one of them beats the height the search found.
+ */
+
+void Pli::checkSearch(const ConstrainData &constrainData, int searched)
+{
+  int total = 0;
+  for (int i = 0; i < sortedKeys.size(); i++) {
+    total += parts[sortedKeys[i]]->height;
+  }
+
+  int scanned = -1;
+  int best    = -1;
+
+  if (constrainData.type == ConstrainData::PliConstrainColumns) {
+    int bomCols   = int(constrainData.constraint);
+    int maxHeight = 0;
+    for (int i = 0; i < sortedKeys.size(); i++) {
+      PliPart *part = parts[sortedKeys[i]];
+      maxHeight += part->height + part->csiMargin.valuePixels(YY);
+    }
+    maxHeight += maxHeight;
+
+    for (int height = maxHeight/(4*bomCols); height <= maxHeight; height++) {
+      int cols, pliWidth, pliHeight;
+      placeAt(height,cols,pliWidth,pliHeight);
+      if (cols == bomCols) {
+        scanned = height;
+        best = layoutMeasure(constrainData,height);
+        break;
+      }
+    }
+  } else {
+    int step = constrainData.type == ConstrainData::PliConstrainWidth
+             ? 4 : qMax(int(toPixels(0.1,DPI)),1);
+
+    for (int height = total; height > 0; height -= step) {
+      int measure = layoutMeasure(constrainData,height);
+      if (measure >= 0 && (best < 0 || measure < best)) {
+        best = measure;
+        scanned = height;
+      }
+    }
+  }
+
+  int found = layoutMeasure(constrainData,searched);
+
+  if (best >= 0 && (found < 0 || best < found)) {
+    qWarning("PLI search: height %d measures %d, linear scan found height %d measuring %d",
+             searched,found,scanned,best);
+  }
+}
+
+#endif
+
+/*
+ * Laying out a PLI is the costly part of sizing a page, and every PLI on
+ * the page is sized again on every redraw.  A layout depends only on the
+ * parts in their sorted order, their sizes, edges and margins, and the
+ * PLI's constraint and border, so layouts are remembered by a hash of
+ * those.  After an edit only the PLIs it changed are laid out again.
+ */
+
+class PliLayout {
+  public:
+    int          width;
+    int          height;
+    QVector<int> left;
+    QVector<int> bot;
+    QVector<int> col;
+};
+
+static QCache<QByteArray, PliLayout> pliLayouts(500);
+
+QByteArray Pli::layoutKey(const ConstrainData &constrainData)
+{
+  QByteArray  inputs;
+  QDataStream out(&inputs,QIODevice::WriteOnly);
+  BorderData  borderData = pliMeta.border.valuePixels();
+
+  out << int(constrainData.type) << constrainData.constraint
+      << pliMeta.pack.value() << pliMeta.sort.value()
+      << borderData.thickness << borderData.margin[0] << borderData.margin[1];
+
+  for (int i = 0; i < sortedKeys.size(); i++) {
+    PliPart *part = parts[sortedKeys[i]];
+
+    out << sortedKeys[i]
+        << part->width << part->height << part->topMargin << part->annotWidth
+        << part->csiMargin.valuePixels(XX) << part->csiMargin.valuePixels(YY)
+        << part->instanceMeta.margin.valuePixels(XX)
+        << part->annotateMeta.margin.valuePixels(XX)
+        << part->leftEdge << part->rightEdge;
+  }
+  return QCryptographicHash::hash(inputs,QCryptographicHash::Sha1);
+}
+
 int Pli::resizePli(
   Meta *meta,
   ConstrainData &constrainData)
@@ -1064,6 +1652,23 @@ int Pli::resizePli(
   bool packSubs = pliMeta.pack.value();
   bool sortType = pliMeta.sort.value();
   int pliWidth,pliHeight;
+  int searched = 0;
+
+  QByteArray key    = layoutKey(constrainData);
+  PliLayout *layout = pliLayouts.object(key);
+
+  if (layout) {
+    for (int i = 0; i < sortedKeys.size(); i++) {
+      PliPart *part = parts[sortedKeys[i]];
+      part->left   = layout->left[i];
+      part->bot    = layout->bot[i];
+      part->col    = layout->col[i];
+      part->placed = true;
+    }
+    size[0] = layout->width;
+    size[1] = layout->height;
+    return 0;
+  }
 
   if (constrainData.type == ConstrainData::PliConstrainHeight) {
     int cols;
@@ -1096,18 +1701,9 @@ int Pli::resizePli(
       maxHeight += maxHeight;
 
       if (bomCols) {
-        for (height = maxHeight/(4*bomCols); height <= maxHeight; height++) {
-          int rc = placePli(sortedKeys,10000000,
-                            height,
-                            packSubs,
-                            sortType,
-                            cols,
-                            pliWidth,
-                            pliHeight);
-          if (rc == 0 && cols == bomCols) {
-            break;
-          }
-		    }
+        height = leastHeight(maxHeight/(4*bomCols),maxHeight,bomCols);
+        placeAt(height,cols,pliWidth,pliHeight);
+        searched = height;
       }
     }
   } else if (constrainData.type == ConstrainData::PliConstrainWidth) {
@@ -1117,21 +1713,16 @@ int Pli::resizePli(
       height += parts[sortedKeys[i]]->height;
     }
 
+    // the less height, the wider as a rule, so look for the least
+    // height that is narrow enough
+
     int cols;
-    int good_height = height;
+    int low = 1, high = height, good_height = height;
 
-    for ( ; height > 0; height -= 4) {
+    while (low <= high) {
+      int mid = low + (high - low)/2;
 
-      int rc = placePli(sortedKeys,10000000,
-                        height,
-                        packSubs,
-                        sortType,
-                        cols,
-                        pliWidth,
-                        pliHeight);
-      if (rc) {
-        break;
-      }
+      placeAt(mid,cols,pliWidth,pliHeight);
 
       int w = 0;
 
@@ -1143,17 +1734,27 @@ int Pli::resizePli(
         }
       }
       if (w < constrainData.constraint) {
-        good_height = height;
+        good_height = mid;
+        high = mid - 1;
+      } else {
+        low = mid + 1;
       }
     }
-    placePli(sortedKeys,10000000,
-             good_height,
-             packSubs,
-             sortType,
-             cols,
-             pliWidth,
-             pliHeight);
-  } else if (constrainData.type == ConstrainData::PliConstrainArea) {
+    placeAt(good_height,cols,pliWidth,pliHeight);
+    searched = good_height;
+
+  } else if (constrainData.type == ConstrainData::PliConstrainArea ||
+             constrainData.type == ConstrainData::PliConstrainSquare) {
+
+    /*
+     * The layout mostly changes when the height gets small enough to
+     * need another column, and the least height that gives a number of
+     * columns is usually the tightest layout with that many.  So we try
+     * each number of columns, from one up, at the height leastHeight
+     * finds for it, rather than every height.
+     */
+
+    bool area = constrainData.type == ConstrainData::PliConstrainArea;
 
     int height = 0;
     for (int i = 0; i < parts.size(); i++) {
@@ -1161,26 +1762,14 @@ int Pli::resizePli(
     }
 
     int cols;
-    int min_area = height*height;
+    int best = -1;
     int good_height = height;
 
-    // step by 1/10 of inch or centimeter
-
-    int step = int(toPixels(0.1,DPI));
-
-    for ( ; height > 0; height -= step) {
+    placeAt(height,cols,pliWidth,pliHeight);
 
-      int rc = placePli(sortedKeys,10000000,
-                        height,
-                        packSubs,
-                        sortType,
-                        cols,
-                        pliWidth,
-                        pliHeight);
-
-      if (rc) {
-        break;
-      }
+    while (height > 0) {
+      height = leastHeight(1,height,cols);
+      placeAt(height,cols,pliWidth,pliHeight);
 
       int h = 0;
       int w = 0;
@@ -1196,70 +1785,56 @@ int Pli::resizePli(
           w = t;
         }
       }
-      if (w*h < min_area) {
-        min_area = w*h;
-        good_height = height;
-      }
-    }
-    placePli(sortedKeys,10000000,
-             good_height,
-             packSubs,
-             sortType,
-             cols,
-             pliWidth,
-             pliHeight);
-  } else if (constrainData.type == ConstrainData::PliConstrainSquare) {
-
-    int height = 0;
-    for (int i = 0; i < parts.size(); i++) {
-      height += parts[sortedKeys[i]]->height;
-    }
 
-    int cols;
-    int min_delta = height;
-    int good_height = height;
-    int step = int(toPixels(0.1,DPI));
+      int measure = area ? w*h : qAbs(pliWidth - pliHeight);
 
-    for ( ; height > 0; height -= step) {
+      if (best < 0 || measure < best) {
+        best = measure;
+        good_height = height;
+      }
 
-      int rc = placePli(sortedKeys,10000000,
-                        height,
-                        packSubs,
-                        sortType,
-                        cols,
-                        pliWidth,
-                        pliHeight);
+      // with more columns the PLI gets no narrower, and no shorter than
+      // the tallest part
 
-      if (rc) {
+      if (cols >= parts.size() ||
+          (area ? w*tallestPart >= best : pliWidth - pliHeight > best)) {
         break;
       }
 
-      int h = pliWidth;
-      int w = pliHeight;
+      // one pixel less needs more columns
 
-      int delta = 0;
-      if (w < h) {
-        delta = h - w;
-      } else if (h < w) {
-        delta = w - h;
-      }
-      if (delta < min_delta) {
-        min_delta = delta;
-        good_height = height;
+      height--;
+      if (height > 0) {
+        placeAt(height,cols,pliWidth,pliHeight);
       }
     }
-    placePli(sortedKeys,10000000,
-             good_height,
-             packSubs,
-             sortType,
-             cols,
-             pliWidth,
-             pliHeight);
+    placeAt(good_height,cols,pliWidth,pliHeight);
+    searched = good_height;
   }
 
+#ifdef PLI_SEARCH_CHECK
+  if (searched > 0) {
+    checkSearch(constrainData,searched);
+    placeAt(searched,cols,pliWidth,pliHeight);
+  }
+#else
+  Q_UNUSED(searched);
+#endif
+
   size[0] = pliWidth;
   size[1] = pliHeight;
 
+  layout = new PliLayout;
+  layout->width  = pliWidth;
+  layout->height = pliHeight;
+  for (int i = 0; i < sortedKeys.size(); i++) {
+    PliPart *part = parts[sortedKeys[i]];
+    layout->left << part->left;
+    layout->bot  << part->bot;
+    layout->col  << part->col;
+  }
+  pliLayouts.insert(key,layout);
+
   return 0;
 }
 
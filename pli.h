@@ -40,7 +40,7 @@
 #include <QString>
 #include <QList>
 #include <QHash>
-#include <QCache>
+#include <QVector>
 #include <QTextDocument>
 #include "meta.h"
 #include "placement.h"
@@ -48,6 +48,7 @@
 #include "where.h"
 #include "name.h"
 #include "resize.h"
+#include "pagearena.h"
 
 class Pli;
 
@@ -62,6 +63,8 @@ class PliBackgroundItem;
 
 class PliPart {
   public:
+    PAGE_ARENA_ALLOCATED
+
     // where the exist in an LDraw file
     QList<Where>         instances; 
     QString              type;
@@ -89,8 +92,8 @@ class PliPart {
     int           partTopMargin;
     int           partBotMargin;
 
-    QList<int>    leftEdge;
-    QList<int>    rightEdge;
+    QVector<int>  leftEdge;
+    QVector<int>  rightEdge;
   
     // placement info
     bool          placed;
@@ -121,17 +124,47 @@ class PliPart {
 
 #define INSTANCE_SEP ":"
 
+/*
+ * A part image as read from its file, and its left and right edges.
+ */
+
+class PartImage {
+  public:
+    QPixmap      pixmap;
+    QVector<int> leftEdge;
+    QVector<int> rightEdge;
+};
+
 class Step;
 class Steps;
 class Callout;
 
 class Pli : public Placement {
   private:
-    static QCache<QString, QString> orientation;
+    static QHash<QString, QVector<float> > orientations;
+    static QString                         orientationFiles;
+
+    static void loadOrientations(const QString &fileName);
 
     QHash<QString, PliPart*> parts;
     QList<QString>           sortedKeys;
 
+    QHash<QPair<PliPart *, PliPart *>, int> underCache;
+    QHash<QPair<PliPart *, PliPart *>, int> dropCache;
+
+    bool fitsUnder(PliPart *prevPart, PliPart *part);
+    int  dropInto (PliPart *prevPart, PliPart *part);
+    int  placeAt  (int yConstraint, int &cols, int &width, int &height);
+    int  leastHeight(int low, int high, int maxCols);
+#ifdef PLI_SEARCH_CHECK
+    int  layoutMeasure(const ConstrainData &constrainData, int height);
+    void checkSearch  (const ConstrainData &constrainData, int searched);
+#endif
+
+    QByteArray layoutKey(const ConstrainData &constrainData);
+    QString    libraryKey(const QString &ldr, const QString &type,
+                          bool resample, float modelScale);
+
   public:
     PlacementType      parentRelativeType;
     bool               perStep;
@@ -198,10 +231,13 @@ class Pli : public Placement {
     
 	  void placeCols(QList<QString> &);
     bool initAnnotationString();
-    void getAnnotate(QString &, QString &);
+    void getAnnotate(QString &, QString &, QString &);
     void partClass(QString &, QString &);
     int  createPartImage(QString &, QString &, QString &, QPixmap*);
-    QString orient(QString &color, QString part);
+    int  renderPartImage(QString &, QString &, QString &, QString &);
+    bool loadPartImage(const QString &, PartImage &);
+    static void orientation(const QString &type, float matrix[3][3]);
+    QString orient(QString &color, QString part, float matrix[3][3]);
 
     void operator= (Pli& from)
     {
@@ -215,8 +251,8 @@ class Pli : public Placement {
       bom       = from.bom;
     }
 
-    void getLeftEdge(QImage &, QList<int> &);
-    void getRightEdge(QImage &, QList<int> &);
+    void getLeftEdge(QImage &, QVector<int> &);
+    void getRightEdge(QImage &, QVector<int> &);
 };
 
 class PliBackgroundItem : public BackgroundItem, public AbstractResize, public Placement
@@ -139,6 +139,10 @@ GlobalPliDialog::GlobalPliDialog(
   data->children.append(child);
   partsLayout->addWidget(child);
 
+  child = new CheckBoxGui("Recolor One Rendering Per Part",&pliMeta->recolor);
+  data->children.append(child);
+  partsLayout->addWidget(child);
+
   if ( ! bom) {
     box = new QGroupBox("Submodels",this);
     grid->addWidget(box);
@@ -0,0 +1,117 @@
+
+/****************************************************************************
+**
+** Copyright (C) 2007-2009 Kevin Clague. All rights reserved.
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.trolltech.com/products/qt/opensource.html
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+/****************************************************************************
+ *
+ * This file implements the library of parts list images shared between
+ * projects.
+ *
+ * Please see lpub.h for an overall description of how the files in LPub
+ * make up the LPub program.
+ *
+ ***************************************************************************/
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include "plilibrary.h"
+#include "lpub_preferences.h"
+
+bool PliLibrary::enabled()
+{
+  return Preferences::pliLibraryPath != "";
+}
+
+QString PliLibrary::key(const QStringList &description)
+{
+  QByteArray digest = QCryptographicHash::hash(description.join("\n").toUtf8(),
+                                               QCryptographicHash::Sha1);
+  return QString(digest.toHex());
+}
+
+/*
+ * Images are spread over 256 directories so no one directory gets
+ * too big to list.
+ */
+
+QString PliLibrary::path(const QString &key)
+{
+  return Preferences::pliLibraryPath + "/" + key.left(2) + "/" + key + ".png";
+}
+
+/*
+ * Copy a file so that it shows up at its new name all at once.  If
+ * someone beats us to it, theirs is just as good as ours.
+ */
+
+bool PliLibrary::copy(const QString &from, const QString &to)
+{
+  static int copies = 0;
+
+  QString partial = QString("%1.%2.%3.tmp")
+                      .arg(to)
+                      .arg(QCoreApplication::applicationPid())
+                      .arg(copies++);
+
+  QFile::remove(partial);
+
+  if ( ! QFile::copy(from,partial)) {
+    QFile::remove(partial);
+    return false;
+  }
+
+  if ( ! QFile::rename(partial,to)) {
+    QFile::remove(partial);
+    return QFile::exists(to);
+  }
+  return true;
+}
+
+bool PliLibrary::fetch(const QString &key, const QString &imageName)
+{
+  if ( ! enabled()) {
+    return false;
+  }
+
+  QString name = path(key);
+
+  if ( ! QFile::exists(name)) {
+    return false;
+  }
+  return copy(name,imageName);
+}
+
+bool PliLibrary::publish(const QString &key, const QString &imageName)
+{
+  if ( ! enabled()) {
+    return false;
+  }
+
+  QString name = path(key);
+
+  if (QFile::exists(name)) {
+    return true;
+  }
+
+  if ( ! QDir().mkpath(QFileInfo(name).absolutePath())) {
+    return false;
+  }
+  return copy(imageName,name);
+}
@@ -0,0 +1,73 @@
+
+/****************************************************************************
+**
+** Copyright (C) 2007-2009 Kevin Clague. All rights reserved.
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.trolltech.com/products/qt/opensource.html
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+/****************************************************************************
+ *
+ * This class keeps a library of parts list images that is shared between
+ * projects, and between copies of LPub running at the same time.  An
+ * image is filed under a digest of everything that goes into rendering
+ * it: the part, its color and orientation, the file it comes from and
+ * when that last changed, the renderer and its arguments, the view
+ * angles, and the scale and resolution.  Projects
+ * look in the library before rendering a part, and put what they render
+ * into it.
+ *
+ * Images are copied into the library under a temporary name and then
+ * renamed, so nobody ever sees half an image.
+ *
+ * Please see lpub.h for an overall description of how the files in LPub
+ * make up the LPub program.
+ *
+ ***************************************************************************/
+
+#ifndef PLILIBRARY_H
+#define PLILIBRARY_H
+
+#include <QString>
+#include <QStringList>
+
+class PliLibrary {
+  public:
+    PliLibrary() {}
+
+    static bool enabled();
+
+    /*
+     * The library's name for an image, given the description of
+     * everything that goes into rendering it.
+     */
+
+    static QString key(const QStringList &description);
+
+    /*
+     * Copy the library's image to imageName, if there is one.
+     */
+
+    static bool fetch(const QString &key, const QString &imageName);
+
+    /*
+     * Put imageName into the library, unless it is there already.
+     */
+
+    static bool publish(const QString &key, const QString &imageName);
+
+  private:
+    static QString path(const QString &key);
+    static bool    copy(const QString &from, const QString &to);
+};
+
+#endif
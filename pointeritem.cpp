@@ -589,7 +589,7 @@ void CalloutPointerItem::addPointerMeta()
   QString metaString = pointer.pointerMeta.format(false,false);
   Where here = pointer.here+1;
   insertMeta(here,metaString);
-  gui->displayPage();
+  gui->redrawLater();
 }
 
 void CalloutPointerItem::contextMenuEvent(QGraphicsSceneContextMenuEvent *event)
@@ -35,6 +35,8 @@ PreferencesDialog::PreferencesDialog(QWidget     *_parent)
   ui.ldrawPath->setText(    ldrawPath);
   ui.pliName->setText(      Preferences::pliFile);
   ui.pliBox->setChecked(    Preferences::pliFile != "");
+  ui.pliLibraryPath->setText(Preferences::pliLibraryPath);
+  ui.pliLibraryBox->setChecked(Preferences::pliLibraryPath != "");
   ui.ldglitePath->setText(  Preferences::ldgliteExe);
 	ui.ldgliteBox->setChecked(Preferences::ldgliteExe != "");
 	ui.l3pPath->setText(  Preferences::l3pExe);
@@ -253,6 +255,23 @@ QString const PreferencesDialog::ldrawPath()
   return ui.ldrawPath->displayText();
 }
 
+void PreferencesDialog::on_browsePliLibrary_clicked()
+{
+  QFileDialog dialog(parent);
+
+  dialog.setWindowTitle(tr("Locate Parts List image library"));
+  dialog.setFileMode(QFileDialog::Directory);
+
+  if (dialog.exec()) {
+    QStringList selectedFiles = dialog.selectedFiles();
+
+    if (selectedFiles.size() == 1) {
+      ui.pliLibraryPath->setText(selectedFiles[0]);
+      ui.pliLibraryBox->setChecked(true);
+    }
+  }
+}
+
 QString const PreferencesDialog::lgeoPath()
 {
 	if (ui.l3pBox->isChecked() && ui.lgeoBox->isChecked()){
@@ -269,6 +288,14 @@ QString const PreferencesDialog::pliFile()
   return "";
 }
 
+QString const PreferencesDialog::pliLibraryPath()
+{
+  if (ui.pliLibraryBox->isChecked()) {
+    return ui.pliLibraryPath->displayText();
+  }
+  return "";
+}
+
 QString const PreferencesDialog::ldviewExe()
 {
   if (ui.ldviewBox->isChecked()) {
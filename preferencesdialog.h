@@ -28,6 +28,7 @@ class PreferencesDialog : public QDialog
 	QString const ldrawPath();
 	QString const lgeoPath();
 	QString const pliFile();
+	QString const pliLibraryPath();
 	QString const l3pExe();
 	QString const povrayExe();
 	QString const ldgliteExe();
@@ -39,6 +40,7 @@ class PreferencesDialog : public QDialog
   void on_browseLDraw_clicked();
 	void on_browseLGEO_clicked();
 	void on_browsePli_clicked();
+	void on_browsePliLibrary_clicked();
 	void on_browseL3P_clicked();
 	void on_browsePOVRAY_clicked();
 	void on_browseLDView_clicked();
@@ -22,6 +22,8 @@
 #include <QMessageBox>
 
 #include "lpub.h"
+#include "name.h"
+#include "lmessagebox.h"
 
 struct paperSizes {
   QPrinter::PaperSize paperSize;
@@ -188,6 +190,19 @@ void Gui::printToFile()
     fileName = fileInfo.path() + "/" + fileInfo.completeBaseName() + ".pdf";
   }
 
+  QList<int> pages;
+  for (int i = 1; i <= maxPages; i++) {
+    pages << i;
+  }
+  printToFile(fileName,pages);
+}
+
+/*
+ * Print the given pages to a PDF file, without asking the user anything.
+ */
+
+bool Gui::printToFile(const QString &fileName, const QList<int> &pages)
+{
   // determine size of output pages, in pixels
   QPrinter::PaperSize paperSize = QPrinter::PaperSize();
   QPrinter::Orientation orientation = QPrinter::Orientation();
@@ -206,7 +221,11 @@ void Gui::printToFile()
   
   // paint to the printer the scene we view
   QPainter painter;
-  painter.begin(&printer);
+  if ( ! painter.begin(&printer)) {
+    LMessageBox::critical(NULL,tr(LPUB),
+                          tr("Cannot print to %1") .arg(fileName));
+    return false;
+  }
   QGraphicsScene scene;
   LGraphicsView view(&scene);
   
@@ -226,10 +245,12 @@ void Gui::printToFile()
   clearPage(&view,&scene);
   
   int savePageNumber = displayPageNum;
-  for (displayPageNum = 1; displayPageNum <= maxPages; displayPageNum++) {
+  for (int i = 0; i < pages.size(); i++) {
 
     //qApp->processEvents();
 
+    displayPageNum = pages[i];
+
     // render this page
     drawPage(&view,&scene,true);
     scene.setSceneRect(0.0,0.0,pageWidthPx,pageHeightPx);
@@ -237,7 +258,7 @@ void Gui::printToFile()
     clearPage(&view,&scene);
     
     // prepare to print another page
-    if(displayPageNum < maxPages) {
+    if (i < pages.size() - 1) {
       printer.newPage();
     }
   }
@@ -247,6 +268,8 @@ void Gui::printToFile()
   // return to whatever page we were viewing before output
   displayPageNum = savePageNumber;
   drawPage(KpageView,KpageScene,false);
+
+  return true;
 }
 
 void Gui::exportAsPng()
@@ -270,9 +293,6 @@ void Gui::exportAsBmp()
 void Gui::exportAs(QString &suffix)
 {
   // determine location to output images
-  QFileInfo fileInfo(curFile);
-  //QDir initialDirectory = fileInfo.dir();
-  QString baseName = fileInfo.baseName();
   QString directoryName = QFileDialog::getExistingDirectory(
       this,
       tr("Save images to folder"), // needs translation! also, include suffix in here
@@ -281,7 +301,28 @@ void Gui::exportAs(QString &suffix)
   if (directoryName == "") {
     return;
   }
-  
+
+  QList<int> pages;
+  for (int i = 1; i <= maxPages; i++) {
+    pages << i;
+  }
+  exportAs(directoryName,suffix,pages);
+}
+
+/*
+ * Save the given pages as images in a directory, without asking the
+ * user anything.
+ */
+
+bool Gui::exportAs(
+  const QString    &directoryName,
+  const QString    &suffix,
+  const QList<int> &pages)
+{
+  QFileInfo fileInfo(curFile);
+  QString baseName = fileInfo.baseName();
+  bool    ok = true;
+
   // determine size of output image, in pixels
   float pageWidthPx, pageHeightPx;
   GetPixelDimensions(pageWidthPx, pageHeightPx);
@@ -313,7 +354,9 @@ void Gui::exportAs(QString &suffix)
   QColor fill = (suffix.compare(".png", Qt::CaseInsensitive) == 0) ? Qt::transparent :  Qt::white;
   
   int savePageNumber = displayPageNum;  
-  for (displayPageNum = 1; displayPageNum <= maxPages; displayPageNum++) {
+  for (int i = 0; i < pages.size(); i++) {
+
+    displayPageNum = pages[i];
     
     //qApp->processEvents();
     
@@ -334,7 +377,12 @@ void Gui::exportAs(QString &suffix)
     // save the image to the selected directory
     // internationalization of "_page_"?
     QString pn = QString("%1") .arg(displayPageNum);
-    image.save(directoryName + "/" + baseName + "_page_" + pn + suffix);
+    QString imageName = directoryName + "/" + baseName + "_page_" + pn + suffix;
+    if ( ! image.save(imageName)) {
+      LMessageBox::critical(NULL,tr(LPUB),
+                            tr("Cannot save %1") .arg(imageName));
+      ok = false;
+    }
   }
   
   painter.end();
@@ -342,4 +390,6 @@ void Gui::exportAs(QString &suffix)
   // return to whatever page we were viewing before output
   displayPageNum = savePageNumber;
   drawPage(KpageView,KpageScene,false);
+
+  return ok;
 }
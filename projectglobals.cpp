@@ -18,6 +18,7 @@
 #include <QDialog>
 #include <QVBoxLayout>
 #include <QGroupBox>
+#include <QGridLayout>
 #include <QDialogButtonBox>
 
 #include "globals.h"
@@ -63,6 +64,33 @@ GlobalProjectDialog::GlobalProjectDialog(
   layout->addWidget(box);
   MetaGui *child = new ResolutionGui(&data->meta.LPub.resolution,box);
   data->children.append(child);
+
+  box = new QGroupBox("Render Cache");
+  layout->addWidget(box);
+  QGridLayout *boxGrid = new QGridLayout();
+  box->setLayout(boxGrid);
+
+  RenderCacheMeta *renderCache = &data->meta.LPub.renderCache;
+
+  child = new CheckBoxGui("Resample From Reference Images",&renderCache->resample);
+  data->children.append(child);
+  boxGrid->addWidget(child,0,0,1,2);
+
+  child = new DoubleSpinGui(
+    "Reference Resolution (DPI)",&renderCache->resolution,
+    renderCache->resolution._min,
+    renderCache->resolution._max,
+    50);
+  data->children.append(child);
+  boxGrid->addWidget(child,1,0,1,2);
+
+  child = new DoubleSpinGui(
+    "Tolerance",&renderCache->tolerance,
+    renderCache->tolerance._min,
+    renderCache->tolerance._max,
+    0.01);
+  data->children.append(child);
+  boxGrid->addWidget(child,2,0,1,2);
   
 #if 0
 
@@ -31,6 +31,7 @@
 #include <QtGui>
 #include "meta.h"
 #include "ranges_element.h"
+#include "pagearena.h"
 
 class Step;
 class QGraphicsItem;
@@ -38,6 +39,8 @@ class AbstractRangeElement;
 
 class Range : public AbstractStepsElement {
   public:
+    PAGE_ARENA_ALLOCATED
+
     int          allocType;
     FreeFormMeta freeform;
     SepMeta      sepMeta;
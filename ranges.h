@@ -89,6 +89,7 @@ class Page : public Steps {
   public:
     QList<InsertMeta> inserts;
     QList<InsertPixmapItem *> insertPixmaps;
+    PlacementGraph graph;   // what is placed relative to what
     bool coverPage;
     Page()
     {
@@ -107,6 +108,7 @@ class Page : public Steps {
       }
       insertPixmaps.clear();
       inserts.clear();
+      graph.clear();
       freeSteps();
     }
 };
@@ -39,6 +39,11 @@
 #include "lpub.h"
 #include "lpub_preferences.h"
 #include "paths.h"
+#include "geometry.h"
+#include "resample.h"
+#include "lmessagebox.h"
+#include "renderspool.h"
+#include "ldrawzip.h"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -213,7 +218,7 @@ void clipImage(QString const &pngName){
 }
 
 // Shared calculations
-float stdCameraDistance(Meta &meta, float scale) {
+float stdCameraDistance(Meta &meta, float scale, int width) {
 	float onexone;
 	float factor;
 	
@@ -222,11 +227,78 @@ float stdCameraDistance(Meta &meta, float scale) {
 	onexone  = 20*meta.LPub.resolution.ldu(); // size of 1x1 in units
 	onexone *= meta.LPub.resolution.value();  // size of 1x1 in pixels
 	onexone *= scale;
-	factor   = meta.LPub.page.size.valuePixels(0)/onexone; // in pixels;
+	factor   = width/onexone; // in pixels;
 	
 	return factor*LduDistance;
 }
 
+/*
+ * The size of the image needed to hold a model that is modelWidth by
+ * modelHeight LDU as seen by the camera, at the given scale, with a bit
+ * of room to spare.  The camera distance is proportional to the image
+ * width, so the model comes out the same size as in a page sized image.
+ *
+ * When we don't know how big the model is, the image is page sized.
+ * Reference images are allowed to be bigger than the page, because they
+ * get resampled down by the model scale later.
+ */
+
+bool viewportSize(
+  Meta  &meta,
+  float  scale,
+  float  modelWidth,
+  float  modelHeight,
+  int   &width,
+  int   &height)
+{
+  width  = meta.LPub.page.size.valuePixels(0);
+  height = meta.LPub.page.size.valuePixels(1);
+
+  if (modelWidth <= 0 || modelHeight <= 0) {
+    return false;
+  }
+
+  float pixels = meta.LPub.resolution.ldu()*meta.LPub.resolution.value()*scale;
+
+  int modelPixelsX = int(modelWidth *pixels*1.1 + 16);
+  int modelPixelsY = int(modelHeight*pixels*1.1 + 16);
+
+  if (ReferenceRender::active()) {
+    width  *= 4;
+    height *= 4;
+  }
+
+  if (modelPixelsX >= width && modelPixelsY >= height) {
+    return false;
+  }
+
+  width  = qMin(width, modelPixelsX);
+  height = qMin(height,modelPixelsY);
+
+  return true;
+}
+
+/*
+ * A part for a PLI can be looked at from any angle, so the image has to
+ * hold the sphere around it.
+ */
+
+bool pliViewportSize(
+  Meta          &meta,
+  float          scale,
+  const QString &ldrName,
+  int           &width,
+  int           &height)
+{
+  BoundingBox box;
+  float       diameter = 0;
+
+  if (PartGeometry::fileBoundingBox(ldrName,box)) {
+    diameter = 2*box.radius();
+  }
+  return viewportSize(meta,scale,diameter,diameter,width,height);
+}
+
 
 
 /***************************************************************************
@@ -250,8 +322,8 @@ float stdCameraDistance(Meta &meta, float scale) {
  * L3P renderer
  *
  **************************************************************************/
-float L3P::cameraDistance(Meta &meta, float scale){
-	return stdCameraDistance(meta, scale);
+float L3P::cameraDistance(Meta &meta, float scale, int width){
+	return stdCameraDistance(meta, scale, width);
 }
 
 int L3P::renderCsi(
@@ -266,22 +338,24 @@ int L3P::renderCsi(
 	int rc;
 	ldrName = QDir::currentPath() + "/" + Paths::tmpDir + "/csi.ldr";
 	QString povName = ldrName +".pov";
-	if ((rc = rotateParts(addLine,meta.rotStep, csiParts, ldrName)) < 0) {
+	float size[3];
+	if ((rc = rotateParts(addLine,meta.rotStep, csiParts, ldrName, size)) < 0) {
 		return rc;
 	}
+	LDrawZip::extractFor(ldrName);
 	
 	/* determine camera distance */
 	QStringList arguments;
 	bool hasLGEO = Preferences::lgeoPath != "";
 	
-	int cd = cameraDistance(meta, meta.LPub.assem.modelScale.value());
-	int width = meta.LPub.page.size.valuePixels(0);
-	int height = meta.LPub.page.size.valuePixels(1);
+	int width, height;
+	viewportSize(meta, meta.LPub.assem.modelScale.value(), size[0], size[1], width, height);
+	int cd = cameraDistance(meta, meta.LPub.assem.modelScale.value(), width);
 	float ar = width/(float)height;
 	
 	QString cg = QString("-cg0.0,0.0,%1").arg(cd);
 	QString car = QString("-car%1").arg(ar);
-	QString ldd = QString("-ldd%1").arg(fixupDirname(QDir::toNativeSeparators(Preferences::ldrawPath)));
+	QString ldd = QString("-ldd%1").arg(fixupDirname(QDir::toNativeSeparators(LDrawZip::rendererPath())));
 	arguments << CA;
 	arguments << cg;
 	arguments << "-ld";
@@ -317,7 +391,7 @@ int L3P::renderCsi(
 			QByteArray status = l3p.readAll();
 			QString str;
 			str.append(status);
-			QMessageBox::warning(NULL,
+			LMessageBox::warning(NULL,
 								 QMessageBox::tr("LPub"),
 								 QMessageBox::tr("L3P failed with code %1\n%2").arg(l3p.exitCode()) .arg(str));
 			return -1;
@@ -365,7 +439,7 @@ int L3P::renderCsi(
 			QByteArray status = povray.readAll();
 			QString str;
 			str.append(status);
-			QMessageBox::warning(NULL,
+			LMessageBox::warning(NULL,
 								 QMessageBox::tr("LPub"),
 								 QMessageBox::tr("POV-RAY failed with code %1\n%2").arg(povray.exitCode()) .arg(str));
 			return -1;
@@ -385,22 +459,24 @@ int L3P::renderPli(const QString &ldrName,
 	
 	QString povName = ldrName +".pov";
 	
-	int width  = meta.LPub.page.size.valuePixels(0);
-	int height = meta.LPub.page.size.valuePixels(1);
-	float ar = width/(float)height;
+	LDrawZip::extractFor(ldrName);
 	
 	/* determine camera distance */
 	
 	PliMeta &pliMeta = bom ? meta.LPub.bom : meta.LPub.pli;
 	
-	int cd = cameraDistance(meta,pliMeta.modelScale.value());
+	int width, height;
+	pliViewportSize(meta, pliMeta.modelScale.value(), ldrName, width, height);
+	float ar = width/(float)height;
+	
+	int cd = cameraDistance(meta,pliMeta.modelScale.value(),width);
 	
 	QString cg = QString("-cg%1,%2,%3") .arg(pliMeta.angle.value(0))
 	.arg(pliMeta.angle.value(1))
 	.arg(cd);
 	
 	QString car = QString("-car%1").arg(ar);
-	QString ldd = QString("-ldd%1").arg(fixupDirname(QDir::toNativeSeparators(Preferences::ldrawPath)));
+	QString ldd = QString("-ldd%1").arg(fixupDirname(QDir::toNativeSeparators(LDrawZip::rendererPath())));
 	QStringList arguments;
 	bool hasLGEO = Preferences::lgeoPath != "";
 	
@@ -440,7 +516,7 @@ int L3P::renderPli(const QString &ldrName,
 			QByteArray status = l3p.readAll();
 			QString str;
 			str.append(status);
-			QMessageBox::warning(NULL,
+			LMessageBox::warning(NULL,
 								 QMessageBox::tr("LPub"),
 								 QMessageBox::tr("L3P failed\n%1") .arg(str));
 			return -1;
@@ -488,7 +564,7 @@ int L3P::renderPli(const QString &ldrName,
 			QByteArray status = povray.readAll();
 			QString str;
 			str.append(status);
-			QMessageBox::warning(NULL,
+			LMessageBox::warning(NULL,
 								 QMessageBox::tr("LPub"),
 								 QMessageBox::tr("POV-RAY failed\n%1") .arg(str));
 			return -1;
@@ -511,9 +587,10 @@ int L3P::renderPli(const QString &ldrName,
 
 float LDGLite::cameraDistance(
   Meta &meta,
-  float scale)
+  float scale,
+  int   width)
 {
-	return stdCameraDistance(meta,scale);
+	return stdCameraDistance(meta,scale,width);
 }
 
 int LDGLite::renderCsi(
@@ -526,22 +603,25 @@ int LDGLite::renderCsi(
 	QString ldrName;
 	int rc;
 	ldrName = QDir::currentPath() + "/" + Paths::tmpDir + "/csi.ldr";
-	if ((rc = rotateParts(addLine,meta.rotStep, csiParts, ldrName)) < 0) {
+	float size[3];
+	if ((rc = rotateParts(addLine,meta.rotStep, csiParts, ldrName, size)) < 0) {
 		return rc;
 	}
+	LDrawZip::extractFor(ldrName);
 
   /* determine camera distance */
   
   QStringList arguments;
 
-  int cd = cameraDistance(meta,meta.LPub.assem.modelScale.value());
+  int width, height;
+  bool tight = viewportSize(meta,meta.LPub.assem.modelScale.value(),
+                            size[0],size[1],width,height);
 
-  int width = meta.LPub.page.size.valuePixels(0);
-  int height = meta.LPub.page.size.valuePixels(1);
+  int cd = cameraDistance(meta,meta.LPub.assem.modelScale.value(),width);
 
   QString v  = QString("-v%1,%2")   .arg(width)
                                     .arg(height);
-  QString o  = QString("-o0,-%1")   .arg(height/6);
+  QString o  = QString("-o0,-%1")   .arg(tight ? 0 : height/6);
   QString mf = QString("-mF%1")     .arg(pngName);
   
   int lineThickness = resolution()/150+0.5;
@@ -574,9 +654,13 @@ int LDGLite::renderCsi(
   arguments << mf;
   arguments << ldrName;
   
+  if (RenderSpool::enabled()) {
+    return RenderSpool::render("LDGLite",arguments,ldrName,pngName);
+  }
+
   QProcess    ldglite;
   QStringList env = QProcess::systemEnvironment();
-  env << "LDRAWDIR=" + Preferences::ldrawPath;
+  env << "LDRAWDIR=" + LDrawZip::rendererPath();
   ldglite.setEnvironment(env);
   ldglite.setWorkingDirectory(QDir::currentPath()+"/"+Paths::tmpDir);
   ldglite.setStandardErrorFile(QDir::currentPath() + "/stderr");
@@ -587,7 +671,7 @@ int LDGLite::renderCsi(
       QByteArray status = ldglite.readAll();
       QString str;
       str.append(status);
-      QMessageBox::warning(NULL,
+      LMessageBox::warning(NULL,
                            QMessageBox::tr("LPub"),
                            QMessageBox::tr("LDGlite failed\n%1") .arg(str));
       return -1;
@@ -604,14 +688,16 @@ int LDGLite::renderPli(
   Meta    &meta,
   bool     bom)
 {
-  int width  = meta.LPub.page.size.valuePixels(0);
-  int height = meta.LPub.page.size.valuePixels(1);
-  
+  LDrawZip::extractFor(ldrName);
+
   /* determine camera distance */
 
   PliMeta &pliMeta = bom ? meta.LPub.bom : meta.LPub.pli;
 
-  int cd = cameraDistance(meta,pliMeta.modelScale.value());
+  int width, height;
+  bool tight = pliViewportSize(meta,pliMeta.modelScale.value(),ldrName,width,height);
+
+  int cd = cameraDistance(meta,pliMeta.modelScale.value(),width);
 
   QString cg = QString("-cg%1,%2,%3") .arg(pliMeta.angle.value(0))
                                       .arg(pliMeta.angle.value(1))
@@ -619,7 +705,7 @@ int LDGLite::renderPli(
 
   QString v  = QString("-v%1,%2")   .arg(width)
                                     .arg(height);
-  QString o  = QString("-o0,-%1")   .arg(height/6);
+  QString o  = QString("-o0,-%1")   .arg(tight ? 0 : height/6);
   QString mf = QString("-mF%1")     .arg(pngName);
                                     // ldglite always deals in 72 DPI
   QString w  = QString("-W%1")      .arg(int(resolution()/72.0+0.5));
@@ -645,9 +731,13 @@ int LDGLite::renderPli(
   arguments << mf;
   arguments << ldrName;
   
+  if (RenderSpool::enabled()) {
+    return RenderSpool::render("LDGLite",arguments,ldrName,pngName);
+  }
+
   QProcess    ldglite;
   QStringList env = QProcess::systemEnvironment();
-  env << "LDRAWDIR=" + Preferences::ldrawPath;
+  env << "LDRAWDIR=" + LDrawZip::rendererPath();
   ldglite.setEnvironment(env);  
   ldglite.setWorkingDirectory(QDir::currentPath());
   ldglite.setStandardErrorFile(QDir::currentPath() + "/stderr");
@@ -658,7 +748,7 @@ int LDGLite::renderPli(
       QByteArray status = ldglite.readAll();
       QString str;
       str.append(status);
-      QMessageBox::warning(NULL,
+      LMessageBox::warning(NULL,
                            QMessageBox::tr("LPub"),
                            QMessageBox::tr("LDGlite failed\n%1") .arg(str));
       return -1;
@@ -699,9 +789,10 @@ int LDGLite::renderPli(
 
 float LDView::cameraDistance(
   Meta &meta,
-  float scale)
+  float scale,
+  int   width)
 {
-	return stdCameraDistance(meta, scale)*0.775;
+	return stdCameraDistance(meta, scale, width)*0.775;
 }
 
 int LDView::renderCsi(
@@ -714,18 +805,21 @@ int LDView::renderCsi(
 	QString ldrName;
 	int rc;
 	ldrName = QDir::currentPath() + "/" + Paths::tmpDir + "/csi.ldr";
-	if ((rc = rotateParts(addLine,meta.rotStep, csiParts, ldrName)) < 0) {
+	float size[3];
+	if ((rc = rotateParts(addLine,meta.rotStep, csiParts, ldrName, size)) < 0) {
 		return rc;
 	}
+	LDrawZip::extractFor(ldrName);
 	
 
   /* determine camera distance */
   
   QStringList arguments;
 
-  int cd = cameraDistance(meta,meta.LPub.assem.modelScale.value())*1700/1000;
-  int width = meta.LPub.page.size.valuePixels(0);
-  int height = meta.LPub.page.size.valuePixels(1);
+  int width, height;
+  viewportSize(meta,meta.LPub.assem.modelScale.value(),size[0],size[1],width,height);
+
+  int cd = cameraDistance(meta,meta.LPub.assem.modelScale.value(),width)*1700/1000;
 
   QString w  = QString("-SaveWidth=%1") .arg(width);
   QString h  = QString("-SaveHeight=%1") .arg(height);
@@ -757,8 +851,16 @@ int LDView::renderCsi(
   }
   arguments << ldrName;
   
+  if (RenderSpool::enabled()) {
+    return RenderSpool::render("LDView",arguments,ldrName,pngName);
+  }
+
   QProcess    ldview;
-  ldview.setEnvironment(QProcess::systemEnvironment());
+  QStringList env = QProcess::systemEnvironment();
+  if (LDrawZip::isZip(Preferences::ldrawPath)) {
+    env << "LDRAWDIR=" + LDrawZip::rendererPath();
+  }
+  ldview.setEnvironment(env);
   ldview.setWorkingDirectory(QDir::currentPath()+"/"+Paths::tmpDir);
   ldview.start(Preferences::ldviewExe,arguments);
 
@@ -767,7 +869,7 @@ int LDView::renderCsi(
       QByteArray status = ldview.readAll();
       QString str;
       str.append(status);
-      QMessageBox::warning(NULL,
+      LMessageBox::warning(NULL,
                            QMessageBox::tr("LPub"),
                            QMessageBox::tr("LDView failed\n%1") .arg(str));
       return -1;
@@ -784,20 +886,22 @@ int LDView::renderPli(
   Meta    &meta,
   bool     bom)
 {
-  int width  = meta.LPub.page.size.valuePixels(0);
-  int height = meta.LPub.page.size.valuePixels(1);
-  
   QFileInfo fileInfo(ldrName);
   
   if ( ! fileInfo.exists()) {
     return -1;
   }
 
+  LDrawZip::extractFor(ldrName);
+
   /* determine camera distance */
 
   PliMeta &pliMeta = bom ? meta.LPub.bom : meta.LPub.pli;
+
+  int width, height;
+  pliViewportSize(meta,pliMeta.modelScale.value(),ldrName,width,height);
   
-  int cd = cameraDistance(meta,pliMeta.modelScale.value())*1700/1000;
+  int cd = cameraDistance(meta,pliMeta.modelScale.value(),width)*1700/1000;
 
   QString cg = QString("-cg%1,%2,%3") .arg(pliMeta.angle.value(0))
                                       .arg(pliMeta.angle.value(1))
@@ -831,8 +935,16 @@ int LDView::renderPli(
   }
   arguments << ldrName;
 
+  if (RenderSpool::enabled()) {
+    return RenderSpool::render("LDView",arguments,ldrName,pngName);
+  }
+
   QProcess    ldview;
-  ldview.setEnvironment(QProcess::systemEnvironment());
+  QStringList env = QProcess::systemEnvironment();
+  if (LDrawZip::isZip(Preferences::ldrawPath)) {
+    env << "LDRAWDIR=" + LDrawZip::rendererPath();
+  }
+  ldview.setEnvironment(env);
   ldview.setWorkingDirectory(QDir::currentPath());
   ldview.start(Preferences::ldviewExe,arguments);
   if ( ! ldview.waitForFinished()) {
@@ -840,7 +952,7 @@ int LDView::renderPli(
       QByteArray status = ldview.readAll();
       QString str;
       str.append(status);
-      QMessageBox::warning(NULL,
+      LMessageBox::warning(NULL,
                            QMessageBox::tr("LPub"),
                            QMessageBox::tr("LDView failed\n%1") .arg(str));
       return -1;
@@ -45,13 +45,15 @@ class Render
   static int rotateParts(const QString     &addLine,
                          RotStepMeta &rotStep,
                          QStringList &parts,
-                         bool         defaultRot = true);
+                         bool         defaultRot = true,
+                         float       *size = 0);
   protected:
-    virtual float cameraDistance(Meta &meta, float) = 0;
+    virtual float cameraDistance(Meta &meta, float, int width) = 0;
     int rotateParts(const QString     &addLine,
                           RotStepMeta &rotStep,
                     const QStringList &parts,
-                          QString     &ldrName);
+                          QString     &ldrName,
+                          float       *size = 0);
 };
 
 extern Render *renderer;
@@ -63,7 +65,7 @@ public:
 	virtual ~L3P() {}
 	virtual int renderCsi(const QString &,  const QStringList &, const QString &, Meta &);
     virtual int renderPli(                  const QString &,     const QString &, Meta &, bool bom);
-    virtual float cameraDistance(Meta &meta, float);
+    virtual float cameraDistance(Meta &meta, float, int width);
 };
 
 class LDGLite : public Render
@@ -73,7 +75,7 @@ class LDGLite : public Render
     virtual ~LDGLite() {}
     virtual int renderCsi(const QString &,  const QStringList &, const QString &, Meta &);
     virtual int renderPli(                  const QString &,     const QString &, Meta &, bool bom);
-    virtual float cameraDistance(Meta &meta, float);
+    virtual float cameraDistance(Meta &meta, float, int width);
 };
 
 class LDView : public Render
@@ -83,7 +85,7 @@ class LDView : public Render
     virtual ~LDView() {}
     virtual int renderCsi(const QString &,  const QStringList &, const QString &, Meta &);
     virtual int renderPli(                  const QString &,     const QString &, Meta &, bool bom);
-    virtual float cameraDistance(Meta &meta, float);
+    virtual float cameraDistance(Meta &meta, float, int width);
 };
 
 
@@ -0,0 +1,514 @@
+
+/****************************************************************************
+**
+** Copyright (C) 2007-2009 Kevin Clague. All rights reserved.
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.trolltech.com/products/qt/opensource.html
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+/****************************************************************************
+ *
+ * This file implements the render spool, both the side that asks for
+ * renders and the workers that do them.
+ *
+ * Please see lpub.h for an overall description of how the files in LPub
+ * make up the LPub program.
+ *
+ ***************************************************************************/
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QRegExp>
+#include <QSet>
+#include <QThread>
+#include <QTime>
+#include <stdio.h>
+
+#include "renderspool.h"
+#include "lpub_preferences.h"
+#include "paths.h"
+#include "name.h"
+#include "lmessagebox.h"
+#include "ldrawzip.h"
+
+QString RenderSpool::spoolPath;
+bool    RenderSpool::spoolDeferred = false;
+
+/*
+ * How long a worker can have a job before we decide it has died and
+ * give the job to someone else.  The renderers are given six minutes.
+ */
+
+#define STALE_CLAIM (10*60*1000)
+
+/*
+ * How long a job can sit in the queue before the process that wants it
+ * renders it itself.
+ */
+
+#define UNCLAIMED (2*1000)
+
+/*
+ * QThread::msleep is protected in Qt 4.
+ */
+
+class Nap : public QThread {
+  public:
+    static void ms(unsigned long ms)
+    {
+      QThread::msleep(ms);
+    }
+};
+
+void RenderSpool::setPath(const QString &spool)
+{
+  spoolPath = spool == "" ? spool : QFileInfo(spool).absoluteFilePath();
+  qsrand(QTime::currentTime().msec() ^ QCoreApplication::applicationPid());
+}
+
+bool RenderSpool::makeDirs()
+{
+  QDir dir;
+
+  return dir.mkpath(spoolPath + "/queue")   &&
+         dir.mkpath(spoolPath + "/claimed") &&
+         dir.mkpath(spoolPath + "/done")    &&
+         dir.mkpath(spoolPath + "/failed")  &&
+         dir.mkpath(spoolPath + "/tmp");
+}
+
+QString RenderSpool::name(
+  const QString &dir,
+  const QString &key,
+  const QString &suffix)
+{
+  return spoolPath + "/" + dir + "/" + key + suffix;
+}
+
+/*
+ * Several machines can share the spool, so process ids alone are not
+ * enough to keep temporary names apart.
+ */
+
+QString RenderSpool::tmpName(const QString &key)
+{
+  static int count = 0;
+
+  return QString("%1/tmp/%2.%3.%4.%5")
+           .arg(spoolPath)
+           .arg(key)
+           .arg(QCoreApplication::applicationPid())
+           .arg(count++)
+           .arg(qrand());
+}
+
+/*
+ * Copy a file into the spool so that it shows up at its new name all at
+ * once.  If someone beats us to it, theirs is just as good as ours.
+ */
+
+bool RenderSpool::publish(const QString &from, const QString &to)
+{
+  QString partial = tmpName(QFileInfo(to).completeBaseName());
+
+  if ( ! QFile::copy(from,partial)) {
+    QFile::remove(partial);
+    return false;
+  }
+  if ( ! QFile::rename(partial,to)) {
+    QFile::remove(partial);
+    return QFile::exists(to);
+  }
+  return true;
+}
+
+bool RenderSpool::submit(const QString &key, const QByteArray &job)
+{
+  QString partial = tmpName(key);
+  QFile   file(partial);
+
+  if ( ! file.open(QIODevice::WriteOnly)) {
+    return false;
+  }
+  file.write(job);
+  file.close();
+
+  QFile::remove(name("failed",key,".log"));
+
+  if ( ! QFile::rename(partial,name("queue",key,".job"))) {
+    QFile::remove(partial);
+  }
+  return true;
+}
+
+bool RenderSpool::fetch(const QString &key, const QString &pngName)
+{
+  QString done = name("done",key,".png");
+
+  if ( ! QFile::exists(done)) {
+    return false;
+  }
+  QFile::remove(pngName);
+  return QFile::copy(done,pngName);
+}
+
+/*
+ * Take the oldest job in the queue.
+ */
+
+bool RenderSpool::claim(QString &key)
+{
+  QDir queue(spoolPath + "/queue");
+
+  QStringList jobs = queue.entryList(QStringList("*.job"),
+                                     QDir::Files,
+                                     QDir::Time | QDir::Reversed);
+  foreach (QString job, jobs) {
+    if (QFile::rename(spoolPath + "/queue/" + job,
+                      spoolPath + "/claimed/" + job)) {
+      key = QFileInfo(job).completeBaseName();
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * A job is the renderer's name, then its arguments, then the LDraw files,
+ * the first of which is the one to render:
+ *
+ *   RENDERER LDGLite
+ *   ARG -l3
+ *   ARG -mF%PNG%
+ *   ARG %LDR%
+ *   FILE lpub_job.ldr
+ *   0 // ROTSTEP ...
+ *   1 4 0 0 0 1 0 0 0 1 0 0 0 1 sub.ldr
+ *   FILE sub.ldr
+ *   ...
+ *
+ * No LDraw line starts with FILE, so the files need no quoting.  The
+ * LDraw library can be somewhere else for the worker, so arguments name
+ * it as %LDRAW%, and the worker puts in its own.
+ */
+
+int RenderSpool::render(
+  const QString     &renderer,
+  const QStringList &arguments,
+  const QString     &ldrName,
+  const QString     &pngName)
+{
+  if ( ! makeDirs()) {
+    LMessageBox::warning(NULL,QMessageBox::tr(LPUB),
+                         QMessageBox::tr("Cannot set up render spool %1")
+                         .arg(spoolPath));
+    return -1;
+  }
+
+  QByteArray job = "RENDERER " + renderer.toUtf8() + "\n";
+
+  QString ldrawDir = LDrawZip::rendererPath();
+
+  foreach (QString argument, arguments) {
+    argument.replace(pngName,"%PNG%");
+    argument.replace(ldrName,"%LDR%");
+    if (ldrawDir != "") {
+      argument.replace(ldrawDir,"%LDRAW%");
+      argument.replace(QDir::toNativeSeparators(ldrawDir),"%LDRAW%");
+    }
+    job += "ARG " + argument.toUtf8() + "\n";
+  }
+
+  // submodels are written to the temporary directory, and the renderer
+  // finds them there, so they have to go along with the job
+
+  QString       tmpDir = QDir::currentPath() + "/" + Paths::tmpDir;
+  QStringList   files;
+  QSet<QString> included;
+  QRegExp       typeOne("^\\s*1\\s+(\\S+\\s+){13}(.*)$");
+
+  files << ldrName;
+
+  for (int i = 0; i < files.size(); i++) {
+    QFile file(files[i]);
+
+    if ( ! file.open(QIODevice::ReadOnly)) {
+      if (i == 0) {
+        LMessageBox::warning(NULL,QMessageBox::tr(LPUB),
+                             QMessageBox::tr("Cannot read %1:\n%2")
+                             .arg(files[i]) .arg(file.errorString()));
+        return -1;
+      }
+      continue;
+    }
+    QByteArray contents = file.readAll();
+    file.close();
+
+    QString fileName = i == 0 ? "lpub_job.ldr" : QFileInfo(files[i]).fileName();
+
+    job += "FILE " + fileName.toUtf8() + "\n" + contents;
+    if ( ! contents.endsWith('\n')) {
+      job += '\n';
+    }
+
+    QStringList lines = QString::fromUtf8(contents).split("\n");
+    foreach (QString line, lines) {
+      if (typeOne.exactMatch(line.trimmed())) {
+        QString sub = typeOne.cap(2).trimmed();
+        QString subName = tmpDir + "/" + sub;
+        if ( ! included.contains(sub.toLower()) && QFile::exists(subName)) {
+          included.insert(sub.toLower());
+          files << subName;
+        }
+      }
+    }
+  }
+
+  QString key = QString(QCryptographicHash::hash(job,QCryptographicHash::Sha1).toHex());
+
+  QString queued  = name("queue",  key,".job");
+  QString claimed = name("claimed",key,".job");
+  QString failed  = name("failed", key,".log");
+
+  if (fetch(key,pngName)) {
+    return 0;
+  }
+  if ( ! QFile::exists(queued) && ! QFile::exists(claimed)) {
+    if ( ! submit(key,job)) {
+      LMessageBox::warning(NULL,QMessageBox::tr(LPUB),
+                           QMessageBox::tr("Cannot write to render spool %1")
+                           .arg(spoolPath));
+      return -1;
+    }
+  }
+  if (spoolDeferred) {
+    return Queued;
+  }
+
+  QTime waited;
+  QTime claimTime;
+  bool  sawClaim = false;
+
+  waited.start();
+
+  forever {
+    if (fetch(key,pngName)) {
+      return 0;
+    }
+    if (QFile::exists(failed)) {
+      QFile log(failed);
+      QString str;
+      if (log.open(QIODevice::ReadOnly)) {
+        str = QString::fromLocal8Bit(log.readAll());
+      }
+      LMessageBox::warning(NULL,QMessageBox::tr(LPUB),
+                           QMessageBox::tr("%1 failed\n%2") .arg(renderer) .arg(str));
+      return -1;
+    }
+
+    if (QFile::exists(queued)) {
+
+      // nobody has taken it, so rather than wait, do it ourselves
+
+      if (waited.elapsed() > UNCLAIMED && QFile::rename(queued,claimed)) {
+        run(key);
+      }
+    } else if (QFile::exists(claimed)) {
+      if ( ! sawClaim) {
+        sawClaim = true;
+        claimTime.start();
+      } else if (claimTime.elapsed() > STALE_CLAIM) {
+
+        // the worker must have died, so give the job to someone else
+
+        QFile::rename(claimed,queued);
+        sawClaim = false;
+      }
+    } else if ( ! fetch(key,pngName)) {
+
+      // the job got lost (say the spool was cleaned out), so queue it again
+
+      submit(key,job);
+      waited.restart();
+    } else {
+      return 0;
+    }
+    Nap::ms(250);
+  }
+}
+
+/*
+ * Render a job we have claimed, in a directory of our own, and put the
+ * image (or what the renderer had to say) in the spool.
+ */
+
+bool RenderSpool::run(const QString &key)
+{
+  QString claimed = name("claimed",key,".job");
+  QString done    = name("done",   key,".png");
+
+  QFile jobFile(claimed);
+  if ( ! jobFile.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  QByteArray job = jobFile.readAll();
+  jobFile.close();
+
+  if (QFile::exists(done)) {
+    QFile::remove(claimed);
+    return true;
+  }
+
+  QString workPath = QString("%1/lpub-render-%2")
+                       .arg(QDir::tempPath())
+                       .arg(QCoreApplication::applicationPid());
+  QDir work(workPath);
+  work.mkpath(workPath);
+  foreach (QString old, work.entryList(QDir::Files)) {
+    work.remove(old);
+  }
+
+  QString     renderer;
+  QStringList arguments;
+  QString     ldrName;
+  QFile       file;
+
+  QList<QByteArray> lines = job.split('\n');
+
+  for (int i = 0; i < lines.size(); i++) {
+    const QByteArray &line = lines[i];
+
+    if (line.startsWith("FILE ")) {
+      file.close();
+
+      // never write outside our own directory
+
+      QString fileName = QFileInfo(QString::fromUtf8(line.mid(5))).fileName();
+      file.setFileName(workPath + "/" + fileName);
+      file.open(QIODevice::WriteOnly);
+      if (ldrName == "") {
+        ldrName = file.fileName();
+      }
+    } else if (file.isOpen()) {
+      file.write(line);
+      if (i + 1 < lines.size()) {
+        file.write("\n");
+      }
+    } else if (line.startsWith("RENDERER ")) {
+      renderer = QString::fromUtf8(line.mid(9));
+    } else if (line.startsWith("ARG ")) {
+      arguments << QString::fromUtf8(line.mid(4));
+    }
+  }
+  file.close();
+
+  QString pngName = workPath + "/lpub_job.png";
+
+  // our own copy of the library, with what this job uses out of the zip
+
+  QString ldrawDir = LDrawZip::rendererPath();
+
+  if (ldrName != "") {
+    LDrawZip::extractFor(ldrName,workPath);
+  }
+
+  for (int i = 0; i < arguments.size(); i++) {
+    arguments[i].replace("%PNG%",pngName);
+    arguments[i].replace("%LDR%",ldrName);
+    arguments[i].replace("%LDRAW%",QDir::toNativeSeparators(ldrawDir));
+  }
+
+  QString     program;
+  QStringList env = QProcess::systemEnvironment();
+
+  if (renderer == "LDGLite") {
+    program = Preferences::ldgliteExe;
+    env << "LDRAWDIR=" + ldrawDir;
+  } else if (renderer == "LDView") {
+    program = Preferences::ldviewExe;
+    if (LDrawZip::isZip(Preferences::ldrawPath)) {
+      env << "LDRAWDIR=" + ldrawDir;
+    }
+  }
+
+  QByteArray output;
+
+  if (program == "" || ldrName == "") {
+    output = "This worker cannot render with " + renderer.toUtf8() + "\n";
+  } else {
+    fprintf(stdout,"%s: rendering %s\n",LPUB,qPrintable(key));
+    fflush(stdout);
+
+    QProcess process;
+    process.setEnvironment(env);
+    process.setWorkingDirectory(workPath);
+    process.setProcessChannelMode(QProcess::MergedChannels);
+    process.start(program,arguments);
+    process.waitForFinished(6*60*1000);
+    output = process.readAll();
+  }
+
+  bool ok = QFileInfo(pngName).size() > 0 && publish(pngName,done);
+
+  if ( ! ok) {
+    QString partial = tmpName(key);
+    QFile   log(partial);
+    if (log.open(QIODevice::WriteOnly)) {
+      log.write(output);
+      log.close();
+      if ( ! QFile::rename(partial,name("failed",key,".log"))) {
+        QFile::remove(partial);
+      }
+    }
+  }
+
+  QFile::remove(claimed);
+  foreach (QString old, work.entryList(QDir::Files)) {
+    work.remove(old);
+  }
+  return ok;
+}
+
+int RenderSpool::work(const QString &spool, int idleSeconds)
+{
+  setPath(spool);
+
+  if ( ! makeDirs()) {
+    LMessageBox::critical(NULL,QMessageBox::tr(LPUB),
+                          QMessageBox::tr("Cannot set up render spool %1")
+                          .arg(spoolPath));
+    return 1;
+  }
+
+  Preferences::renderPreferences();
+
+  QTime idle;
+  idle.start();
+
+  forever {
+    QString key;
+
+    if (claim(key)) {
+      run(key);
+      idle.restart();
+      continue;
+    }
+    if (idleSeconds > 0 && idle.elapsed() > idleSeconds*1000) {
+      return 0;
+    }
+    Nap::ms(500);
+  }
+}
@@ -0,0 +1,120 @@
+
+/****************************************************************************
+**
+** Copyright (C) 2007-2009 Kevin Clague. All rights reserved.
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.trolltech.com/products/qt/opensource.html
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+/****************************************************************************
+ *
+ * This class hands renders to other LPub processes, possibly on other
+ * machines, through a spool directory on a shared file system:
+ *
+ *   lpub --export pdf --spool /shared/spool model.mpd
+ *   lpub --render-worker /shared/spool     (as many as you like, anywhere)
+ *
+ * A render job is the renderer's name, its arguments and the LDraw files
+ * it reads, and is named by a digest of all of those, so the same render
+ * asked for twice (or by two projects) is only done once.  The spool
+ * directory holds:
+ *
+ *   queue/<key>.job    jobs waiting for a worker
+ *   claimed/<key>.job  jobs a worker is rendering
+ *   done/<key>.png     finished images, which double as a render cache
+ *   failed/<key>.log   what the renderer said when it did not make an image
+ *   tmp/               files being written, which are renamed into place
+ *
+ * Workers claim a job by renaming it from queue to claimed.  Only one
+ * rename can succeed, so no locking or network service is needed.
+ *
+ * Only LDGLite and LDView are spooled.  L3P runs two programs whose
+ * arguments name files in the local installation, so it renders locally.
+ *
+ * Please see lpub.h for an overall description of how the files in LPub
+ * make up the LPub program.
+ *
+ ***************************************************************************/
+
+#ifndef RENDERSPOOL_H
+#define RENDERSPOOL_H
+
+#include <QString>
+#include <QStringList>
+
+class RenderSpool {
+  public:
+    RenderSpool() {}
+
+    /*
+     * What render() returns when the job was queued and the image will
+     * show up later.
+     */
+
+    enum { Queued = 1 };
+
+    static void setPath(const QString &spool);
+
+    static bool enabled()
+    {
+      return spoolPath != "";
+    }
+
+    /*
+     * While deferred, render() queues jobs and returns Queued rather
+     * than waiting for them, so that a first pass over the pages can
+     * give the workers everything to do at once.
+     */
+
+    static void setDeferred(bool deferred)
+    {
+      spoolDeferred = deferred;
+    }
+
+    /*
+     * Have renderer (LDGLite or LDView) run with arguments turn ldrName
+     * into pngName.  Arguments name ldrName and pngName just as they
+     * would for running the renderer directly.  LDraw files ldrName
+     * refers to in the LPub temporary directory go along with the job.
+     *
+     * Returns 0 when pngName has been made, Queued, or -1 on failure.
+     */
+
+    static int render(
+      const QString     &renderer,
+      const QStringList &arguments,
+      const QString     &ldrName,
+      const QString     &pngName);
+
+    /*
+     * Claim and render jobs until there has been nothing to do for
+     * idleSeconds (or forever if idleSeconds is zero).  The return value
+     * is the program's exit status.
+     */
+
+    static int work(const QString &spool, int idleSeconds);
+
+  private:
+    static QString spoolPath;
+    static bool    spoolDeferred;
+
+    static bool    makeDirs();
+    static QString name(const QString &dir, const QString &key, const QString &suffix);
+    static QString tmpName(const QString &key);
+    static bool    publish(const QString &from, const QString &to);
+    static bool    submit(const QString &key, const QByteArray &job);
+    static bool    claim(QString &key);
+    static bool    run(const QString &key);
+    static bool    fetch(const QString &key, const QString &pngName);
+};
+
+#endif
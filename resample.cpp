@@ -0,0 +1,384 @@
+
+/****************************************************************************
+**
+** Copyright (C) 2007-2009 Kevin Clague. All rights reserved.
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.trolltech.com/products/qt/opensource.html
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+/****************************************************************************
+ *
+ * This file implements rendering at the reference resolution, the
+ * resampling of reference images down to the size asked for, and the
+ * recoloring of neutral part images.
+ *
+ * Please see lpub.h for an overall description of how the files in LPub
+ * make up the LPub program.
+ *
+ ***************************************************************************/
+
+#include <QImage>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QVector>
+#include <math.h>
+
+#include "resample.h"
+#include "meta.h"
+#include "color.h"
+
+int ReferenceRender::nesting = 0;
+
+ReferenceRender::ReferenceRender(
+  Meta      &meta,
+  FloatMeta &_modelScale,
+  bool       _enabled)
+  : modelScale(_modelScale), enabled(_enabled)
+{
+  if ( ! enabled) {
+    return;
+  }
+  savedScale      = modelScale.value();
+  savedResolution = resolution();
+  savedType       = resolutionType();
+
+  setResolutionType(DPI);
+  setResolution(meta.LPub.renderCache.resolution.value());
+  modelScale.setValue(1.0);
+  nesting++;
+}
+
+ReferenceRender::~ReferenceRender()
+{
+  if ( ! enabled) {
+    return;
+  }
+  nesting--;
+  modelScale.setValue(savedScale);
+
+  // resolution is kept in inches, so put it back as DPI before
+  // restoring the units
+
+  setResolutionType(DPI);
+  setResolution(savedResolution);
+  setResolutionType(savedType);
+}
+
+bool ReferenceRender::use(
+  Meta  &meta,
+  float  modelScale,
+  float &factor)
+{
+  factor = 1.0;
+
+  if ( ! meta.LPub.renderCache.resample.value()) {
+    return false;
+  }
+
+  float reference = meta.LPub.renderCache.resolution.value();
+
+  if (reference <= 0 || modelScale <= 0) {
+    return false;
+  }
+
+  factor = resolution()*modelScale/reference;
+
+  return factor <= 1.0 + meta.LPub.renderCache.tolerance.value();
+}
+
+/*
+ * For each pixel along one axis of the resampled image, which pixels of
+ * the original it covers, and by how much.
+ */
+
+class Coverage {
+  public:
+    int first;
+    int count;
+    int offset;
+};
+
+static void coverage(
+  int                srcSize,
+  int                dstSize,
+  QVector<Coverage> &cover,
+  QVector<float>    &weights)
+{
+  double scale = double(srcSize)/dstSize;
+
+  cover.resize(dstSize);
+  weights.clear();
+
+  for (int o = 0; o < dstSize; o++) {
+    double left  = o*scale;
+    double right = (o+1)*scale;
+    int    first = int(left);
+    int    last  = qMin(int(ceil(right)),srcSize);
+
+    Coverage &c = cover[o];
+    c.first  = first;
+    c.count  = last - first;
+    c.offset = weights.size();
+
+    for (int i = first; i < last; i++) {
+      double lo = qMax(left, double(i));
+      double hi = qMin(right,double(i+1));
+      weights.append(float((hi - lo)/scale));
+    }
+  }
+}
+
+static inline int toChannel(float v, int max)
+{
+  int c = int(v + 0.5f);
+  return c < 0 ? 0 : c > max ? max : c;
+}
+
+/*
+ * Area filtered shrink, done as a horizontal pass into a floating point
+ * buffer followed by a vertical pass.  The vertical pass works on whole
+ * rows at a time so the inner loops are simple runs over contiguous
+ * floats.  Pixels are premultiplied so that transparent background does
+ * not bleed into the edges of the model.
+ */
+
+static QImage shrink(
+  const QImage &original,
+  int           dstWidth,
+  int           dstHeight)
+{
+  const QImage src = original.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+  int srcWidth  = src.width();
+  int srcHeight = src.height();
+
+  QVector<Coverage> coverX, coverY;
+  QVector<float>    weightsX, weightsY;
+
+  coverage(srcWidth, dstWidth, coverX,weightsX);
+  coverage(srcHeight,dstHeight,coverY,weightsY);
+
+  int            rowFloats = dstWidth*4;
+  QVector<float> across(srcHeight*rowFloats);
+
+  for (int y = 0; y < srcHeight; y++) {
+    const QRgb *line = reinterpret_cast<const QRgb *>(src.scanLine(y));
+    float      *out  = across.data() + y*rowFloats;
+
+    for (int o = 0; o < dstWidth; o++) {
+      const Coverage &c = coverX[o];
+      const float    *w = weightsX.constData() + c.offset;
+      float a = 0, r = 0, g = 0, b = 0;
+
+      for (int i = 0; i < c.count; i++) {
+        QRgb p = line[c.first + i];
+        a += w[i]*qAlpha(p);
+        r += w[i]*qRed(p);
+        g += w[i]*qGreen(p);
+        b += w[i]*qBlue(p);
+      }
+      out[o*4+0] = a;
+      out[o*4+1] = r;
+      out[o*4+2] = g;
+      out[o*4+3] = b;
+    }
+  }
+
+  QImage         dst(dstWidth,dstHeight,QImage::Format_ARGB32_Premultiplied);
+  QVector<float> down(rowFloats);
+
+  for (int o = 0; o < dstHeight; o++) {
+    const Coverage &c = coverY[o];
+    const float    *w = weightsY.constData() + c.offset;
+    float          *sum = down.data();
+
+    for (int x = 0; x < rowFloats; x++) {
+      sum[x] = 0;
+    }
+    for (int i = 0; i < c.count; i++) {
+      const float *row = across.constData() + (c.first + i)*rowFloats;
+      float        wi  = w[i];
+      for (int x = 0; x < rowFloats; x++) {
+        sum[x] += wi*row[x];
+      }
+    }
+
+    QRgb *line = reinterpret_cast<QRgb *>(dst.scanLine(o));
+
+    for (int x = 0; x < dstWidth; x++) {
+      int a = toChannel(sum[x*4+0],255);
+      line[x] = qRgba(toChannel(sum[x*4+1],a),
+                      toChannel(sum[x*4+2],a),
+                      toChannel(sum[x*4+3],a),
+                      a);
+    }
+  }
+  return dst;
+}
+
+bool resampleImage(
+  const QString &fileName,
+  const QString &resampledName,
+  float          factor)
+{
+  QImage original(fileName);
+
+  if (original.isNull()) {
+    return false;
+  }
+
+  int width  = qMax(1,int(original.width() *factor + 0.5));
+  int height = qMax(1,int(original.height()*factor + 0.5));
+
+  QImage resampled;
+
+  if (width == original.width() && height == original.height()) {
+    resampled = original;
+  } else if (width <= original.width() && height <= original.height()) {
+    resampled = shrink(original,width,height);
+  } else {
+    resampled = original.scaled(width,height,Qt::IgnoreAspectRatio,
+                                             Qt::SmoothTransformation);
+  }
+  return resampled.save(resampledName);
+}
+
+bool isStale(
+  const QString &derivedName,
+  const QString &sourceName)
+{
+  QFileInfo derived(derivedName);
+
+  return ! derived.exists() ||
+           derived.lastModified() < QFileInfo(sourceName).lastModified();
+}
+
+/*
+ * Light Bluish Gray shows the shading of a part without washing out
+ * the highlights the way White does.
+ */
+
+QString neutralColor()
+{
+  return LDrawColor::isPlain("71") ? "71" : "7";
+}
+
+static inline float luma(int r, int g, int b)
+{
+  return 0.299f*r + 0.587f*g + 0.114f*b;
+}
+
+static inline float luma(const QColor &color)
+{
+  return luma(color.red(),color.green(),color.blue());
+}
+
+/*
+ * Recoloring maps the neutral edge color to the part's edge color, and
+ * the neutral color to the part's color, so a color whose edges are
+ * lighter than the color itself (like Black) would come out with its
+ * shading backwards.
+ */
+
+bool recolorable(const QString &code)
+{
+  int c;
+
+  if ( ! LDrawColor::code(code,c) || ! LDrawColor::isPlain(c)) {
+    return false;
+  }
+  const LDrawColorEntry *entry = LDrawColor::entry(c);
+  return luma(entry->edge) <= luma(entry->color);
+}
+
+/*
+ * Each pixel's brightness in the neutral image is looked up in a table
+ * that goes from black up to the part's edge color, on to the part's
+ * color, and then to white for highlights.  Alpha is left alone, so the
+ * outline of the part and its antialiasing carry over.
+ */
+
+bool recolorImage(
+  const QString &neutralName,
+  const QString &coloredName,
+  const QString &code)
+{
+  QImage neutral(neutralName);
+
+  if (neutral.isNull()) {
+    return false;
+  }
+
+  int neutralCode = neutralColor().toInt();
+  int partCode;
+
+  if ( ! LDrawColor::code(code,partCode)) {
+    return false;
+  }
+
+  float neutralBase = luma(LDrawColor::color(neutralCode));
+  float neutralEdge = luma(LDrawColor::edge (neutralCode));
+
+  if (neutralBase - neutralEdge < 1) {
+    return false;
+  }
+
+  QColor base = LDrawColor::color(partCode);
+  QColor edge = LDrawColor::edge(partCode);
+
+  float baseRgb[3] = { float(base.red()), float(base.green()), float(base.blue()) };
+  float edgeRgb[3] = { float(edge.red()), float(edge.green()), float(edge.blue()) };
+
+  int table[256][3];
+
+  for (int l = 0; l < 256; l++) {
+    for (int c = 0; c < 3; c++) {
+      float v;
+      if (l <= neutralEdge) {
+        v = neutralEdge > 0 ? edgeRgb[c]*l/neutralEdge : edgeRgb[c];
+      } else if (l <= neutralBase) {
+        float t = (l - neutralEdge)/(neutralBase - neutralEdge);
+        v = edgeRgb[c] + (baseRgb[c] - edgeRgb[c])*t;
+      } else {
+        float t = neutralBase < 255 ? (l - neutralBase)/(255 - neutralBase) : 1;
+        v = baseRgb[c] + (255 - baseRgb[c])*t;
+      }
+      table[l][c] = toChannel(v,255);
+    }
+  }
+
+  const QImage src = neutral.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+  QImage       dst(src.width(),src.height(),QImage::Format_ARGB32_Premultiplied);
+
+  for (int y = 0; y < src.height(); y++) {
+    const QRgb *in  = reinterpret_cast<const QRgb *>(src.scanLine(y));
+    QRgb       *out = reinterpret_cast<QRgb *>(dst.scanLine(y));
+
+    for (int x = 0; x < src.width(); x++) {
+      QRgb p = in[x];
+      int  a = qAlpha(p);
+
+      if (a == 0) {
+        out[x] = 0;
+        continue;
+      }
+
+      int l = toChannel(luma(qRed(p),qGreen(p),qBlue(p))*255/a,255);
+
+      out[x] = qRgba((table[l][0]*a + 127)/255,
+                     (table[l][1]*a + 127)/255,
+                     (table[l][2]*a + 127)/255,
+                     a);
+    }
+  }
+  return dst.save(coloredName);
+}
@@ -0,0 +1,124 @@
+
+/****************************************************************************
+**
+** Copyright (C) 2007-2009 Kevin Clague. All rights reserved.
+**
+** This file may be used under the terms of the GNU General Public
+** License version 2.0 as published by the Free Software Foundation
+** and appearing in the file LICENSE.GPL included in the packaging of
+** this file.  Please review the following information to ensure GNU
+** General Public Licensing requirements will be met:
+** http://www.trolltech.com/products/qt/opensource.html
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+/****************************************************************************
+ *
+ * Rendering is by far the slowest thing LPub does.  When the user asks
+ * for it (0 !LPUB RENDER_CACHE RESAMPLE TRUE), assembly and part images
+ * are rendered once at a reference resolution with a model scale of one,
+ * and the images actually placed on the page are derived from those by
+ * resampling.  Changing the page size, resolution or model scale then
+ * costs a resample rather than a render.
+ *
+ * When the requested image would be bigger than the reference image by
+ * more than the project's tolerance, we render it the old way instead,
+ * because enlarging an image loses detail.
+ *
+ * Likewise, when asked to (0 !LPUB PLI RECOLOR TRUE), a part is rendered
+ * once in a neutral color and the parts list images for the plain
+ * colors are made by recoloring that one image.  Transparent, chrome,
+ * metallic and other special colors are still rendered.
+ *
+ * Please see lpub.h for an overall description of how the files in LPub
+ * make up the LPub program.
+ *
+ ***************************************************************************/
+
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include <QString>
+#include "resolution.h"
+
+class Meta;
+class FloatMeta;
+
+/*
+ * While one of these exists, the renderers draw at the reference
+ * resolution and a model scale of one, and images are not clipped to
+ * the page.  The previous resolution and scale are put back when it
+ * goes out of scope.  One made with enabled false does nothing, so the
+ * same render call serves whether or not the image is resampled.
+ */
+
+class ReferenceRender {
+  public:
+    ReferenceRender(Meta &meta, FloatMeta &modelScale, bool enabled = true);
+    ~ReferenceRender();
+
+    static bool active()
+    {
+      return nesting > 0;
+    }
+
+    /*
+     * True when images for this model scale should be derived from a
+     * reference image.  factor is how much the reference image has to
+     * be scaled to get the requested one.
+     */
+
+    static bool use(Meta &meta, float modelScale, float &factor);
+
+  private:
+    FloatMeta      &modelScale;
+    bool            enabled;
+    float           savedScale;
+    float           savedResolution;
+    ResolutionType  savedType;
+    static int      nesting;
+};
+
+/*
+ * Scale the image in fileName by factor into resampledName.  Shrinking
+ * is done with an area filter, so every pixel of the original
+ * contributes to the result in proportion to how much of it is covered.
+ */
+
+bool resampleImage(
+  const QString &fileName,
+  const QString &resampledName,
+  float          factor);
+
+/*
+ * True when the image derivedName is missing, or is older than the
+ * image it is made from.
+ */
+
+bool isStale(
+  const QString &derivedName,
+  const QString &sourceName);
+
+/*
+ * The color parts are rendered in when they are going to be recolored,
+ * and whether a color's images can be made by recoloring.
+ */
+
+QString neutralColor();
+
+bool recolorable(const QString &code);
+
+/*
+ * Make the image of a part in color code from the image of the same
+ * part rendered in the neutral color.
+ */
+
+bool recolorImage(
+  const QString &neutralName,
+  const QString &coloredName,
+  const QString &code);
+
+#endif
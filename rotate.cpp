@@ -20,11 +20,16 @@
 #include <QFile>
 #include <QTextStream>
 #include <QRegExp>
+#include <QVector>
+#include <QThread>
+#include <QtConcurrentMap>
 #include <math.h>
 #include "render.h"
 #include "ldrawfiles.h"
+#include "geometry.h"
 
 #include "lpub.h"
+#include "lmessagebox.h"
 
 /*****************************************************************************
  * Rotation routines
@@ -105,60 +110,20 @@ matrixMult(
   matrixMult3(res,t,src);
 }
 
-void rotatePoint(
-  double p[3],
-  double rm[3][3])
-{
-  double X = rm[0][0]*p[0] + rm[0][1]*p[1] + rm[0][2]*p[2];
-  double Y = rm[1][0]*p[0] + rm[1][1]*p[1] + rm[1][2]*p[2];
-  double Z = rm[2][0]*p[0] + rm[2][1]*p[1] + rm[2][2]*p[2];
-
-  p[0] = X;
-  p[1] = Y;
-  p[2] = Z;
-}
-
-void rotateMatrix(
-  double pm[3][3],
-  double rm[3][3])
-{
-
-  double res[3][3];
-
-  for (int i = 0; i < 3; i++) {
-    for (int j = 0; j < 3; j++) {
-       res[i][j] = 0.0;
-    }
-  }
-
-  for (int i = 0; i < 3; i++) {
-    for (int j = 0; j < 3; j++) {
-      for (int k = 0; k < 3; k++) {
-        res[i][j] += rm[i][k] * pm[k][j];
-      }
-    }
-  }
-
-  for (int i = 0; i < 3; i++) {
-    for (int j = 0; j < 3; j++) {
-      pm[i][j] = res[i][j];
-    }
-  }
-}
-
 int Render::rotateParts(
   const QString     &addLine,
         RotStepMeta &rotStep,
   const QStringList &parts,
-        QString     &ldrName)
+        QString     &ldrName,
+        float       *size)
 {
   QStringList rotatedParts = parts;
 
-  rotateParts(addLine,rotStep,rotatedParts);
+  rotateParts(addLine,rotStep,rotatedParts,true,size);
 
   QFile file(ldrName);
   if ( ! file.open(QFile::WriteOnly | QFile::Text)) {
-    QMessageBox::warning(NULL,
+    LMessageBox::warning(NULL,
                          QMessageBox::tr("LPub"),
                          QMessageBox::tr("Cannot open file %1 for writing:\n%2")
                          .arg(ldrName) .arg(file.errorString()));
@@ -186,17 +151,542 @@ int Render::rotateParts(
   return 0;
 }
 
+/*****************************************************************************
+ * Batch transform of a CSI's parts
+ *
+ * The parts are parsed once into a structure of arrays: all the vertices
+ * of the type 1 through 5 lines go into flat x, y and z arrays, and the
+ * orientation matrices of the type 1 lines go into nine flat arrays, one
+ * per matrix element.  Rotation, bounding box and centering are then plain
+ * loops over doubles with no branches or string handling in them, which
+ * the compiler vectorizes, and the LDraw text is only produced once at the
+ * end.  Parsing and formatting of large part counts is spread across the
+ * available cores.
+ *
+ * The bounding box includes the real geometry of the type 1 parts (see
+ * geometry.h), not just their origins, so that the renderers can be handed
+ * an image size that fits what is drawn.
+ ****************************************************************************/
+
+#define ROTATE_PARALLEL_LINES 2048
+
+class RotateBuffer {
+  public:
+    int              numLines;
+    QVector<int>     lineIndex;    // index of the line in parts
+    QVector<char>    lineType;     // LDraw line type 1-5, or 0 when unusable
+    QVector<int>     vertexBase;   // first vertex of the line in x, y, z
+    QVector<int>     matrixBase;   // matrix of a type 1 line in m[]
+    QVector<int>     matrixVertex; // the type 1 line's position in x, y, z
+    QVector<QString> color;
+    QVector<QString> name;         // the type 1 line's sub-file
+    QVector<QString> result;
+
+    QVector<double>  x, y, z;
+    QVector<double>  m[9];
+    QVector<double>  boxCenter[3]; // the part's own bounding box, per matrix
+    QVector<double>  boxHalf[3];
+
+    RotateBuffer()
+    {
+      numLines = 0;
+    }
+};
+
+class RotateChunk {
+  public:
+    RotateBuffer      *buffer;
+    const QStringList *parts;
+    int                begin;
+    int                end;
+};
+
+static inline int vertexCount(char type)
+{
+  static const int count[6] = { 0, 1, 2, 3, 4, 4 };
+  return count[int(type)];
+}
+
+static inline bool isBlank(const QChar *p)
+{
+  ushort c = p->unicode();
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static inline void skipBlanks(const QChar *&p, const QChar *end)
+{
+  while (p < end && isBlank(p)) {
+    p++;
+  }
+}
+
+static inline QString scanToken(const QChar *&p, const QChar *end)
+{
+  skipBlanks(p,end);
+  const QChar *start = p;
+  while (p < end && ! isBlank(p)) {
+    p++;
+  }
+  return QString(start,int(p - start));
+}
+
+static const double powersOfTen[19] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,
+  1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18
+};
+
+/*
+ * Plain decimal numbers, which is what LDraw files are made of, are
+ * converted by hand.  Anything else (exponents, oddities) is left to Qt.
+ */
+
+static inline bool scanNumber(
+  const QChar *&p,
+  const QChar  *end,
+        double &value)
+{
+  skipBlanks(p,end);
+
+  const QChar *start = p;
+  bool negative = false;
+
+  if (p < end && (p->unicode() == '-' || p->unicode() == '+')) {
+    negative = p->unicode() == '-';
+    p++;
+  }
+
+  qint64 mantissa = 0;
+  int    digits = 0;
+  int    decimals = 0;
+
+  while (p < end && p->unicode() >= '0' && p->unicode() <= '9') {
+    if (digits < 18) {
+      mantissa = mantissa*10 + (p->unicode() - '0');
+      digits++;
+    } else {
+      decimals--;
+    }
+    p++;
+  }
+  if (p < end && p->unicode() == '.') {
+    p++;
+    while (p < end && p->unicode() >= '0' && p->unicode() <= '9') {
+      if (digits < 18) {
+        mantissa = mantissa*10 + (p->unicode() - '0');
+        digits++;
+        decimals++;
+      }
+      p++;
+    }
+  }
+
+  if (p < end && ! isBlank(p)) {
+    while (p < end && ! isBlank(p)) {
+      p++;
+    }
+    bool ok;
+    value = QString(start,int(p - start)).toDouble(&ok);
+    return ok;
+  }
+
+  if (digits == 0) {
+    return false;
+  }
+
+  if (decimals >= 0) {
+    value = mantissa/powersOfTen[decimals];
+  } else if (decimals >= -18) {
+    value = mantissa*powersOfTen[-decimals];
+  } else {
+    bool ok;
+    value = QString(start,int(p - start)).toDouble(&ok);
+    return ok;
+  }
+  if (negative) {
+    value = -value;
+  }
+  return true;
+}
+
+/*
+ * Produces the same text as QString::arg(double), which is %g with six
+ * significant digits, without going through printf for the usual LDraw
+ * magnitudes.
+ */
+
+static inline char *formatNumber(char *out, double value)
+{
+  double magnitude = value < 0 ? -value : value;
+
+  if (magnitude != magnitude ||
+      (magnitude != 0 && (magnitude < 1e-4 || magnitude >= 1e6))) {
+    return out + qsnprintf(out,32,"%g",value);
+  }
+
+  int decimals;
+
+  if (magnitude >= 1) {
+    int intDigits = 1;
+    while (magnitude >= powersOfTen[intDigits]) {
+      intDigits++;
+    }
+    decimals = 6 - intDigits;
+  } else {
+    double t = magnitude;
+    decimals = 5;
+    while (t < 1 && decimals < 9) {
+      t *= 10;
+      decimals++;
+    }
+  }
+
+  qint64 scale    = qint64(powersOfTen[decimals]);
+  double scaled   = magnitude*scale;
+  qint64 rounded  = qint64(scaled);
+  double rest     = scaled - rounded;
+
+  if (rest > 0.5 || (rest == 0.5 && (rounded & 1))) {
+    rounded++;                        // round half to even, like printf
+  }
+  qint64 integer  = rounded / scale;
+  qint64 fraction = rounded % scale;
+
+  if (rounded == 0) {
+    *out++ = '0';
+    return out;
+  }
+  if (value < 0) {
+    *out++ = '-';
+  }
+
+  char digits[20];
+  int  n = 0;
+  do {
+    digits[n++] = char('0' + integer % 10);
+    integer /= 10;
+  } while (integer);
+  while (n) {
+    *out++ = digits[--n];
+  }
+
+  if (fraction) {
+    while (fraction % 10 == 0) {
+      fraction /= 10;
+      decimals--;
+    }
+    *out++ = '.';
+    for (int d = decimals - 1; d >= 0; d--) {
+      out[d] = char('0' + fraction % 10);
+      fraction /= 10;
+    }
+    out += decimals;
+  }
+  return out;
+}
+
+/*
+ * Pass one: find the type 1-5 lines, and where their vertices and
+ * matrices go in the arrays.  This only looks at the line type.
+ */
+
+static void classifyParts(
+  const QStringList  &parts,
+        RotateBuffer &buffer)
+{
+  int numVertices = 0;
+  int numMatrices = 0;
+
+  for (int i = 0; i < parts.size(); i++) {
+    const QString &line = parts[i];
+    const QChar *p   = line.constData();
+    const QChar *end = p + line.size();
+
+    skipBlanks(p,end);
+
+    if (p + 1 >= end || ! isBlank(p + 1)) {
+      continue;
+    }
+
+    ushort type = p->unicode();
+
+    if (type < '1' || type > '5') {
+      continue;
+    }
+    buffer.lineIndex  << i;
+    buffer.lineType   << char(type - '0');
+    buffer.vertexBase << numVertices;
+    buffer.matrixBase << (type == '1' ? numMatrices : -1);
+    if (type == '1') {
+      buffer.matrixVertex << numVertices;
+    }
+
+    numVertices += vertexCount(char(type - '0'));
+    numMatrices += type == '1';
+  }
+
+  buffer.numLines = buffer.lineIndex.size();
+  buffer.color.resize(buffer.numLines);
+  buffer.name.resize(buffer.numLines);
+  buffer.result.resize(buffer.numLines);
+  buffer.x.resize(numVertices);
+  buffer.y.resize(numVertices);
+  buffer.z.resize(numVertices);
+  for (int e = 0; e < 9; e++) {
+    buffer.m[e].resize(numMatrices);
+  }
+  for (int d = 0; d < 3; d++) {
+    buffer.boxCenter[d].resize(numMatrices);
+    buffer.boxHalf[d].resize(numMatrices);
+  }
+}
+
+/*
+ * Pass two: convert the numbers of a range of lines into the arrays.
+ * Lines that don't parse are marked so they pass through unchanged.
+ */
+
+static void parseChunk(RotateChunk &chunk)
+{
+  RotateBuffer &buffer = *chunk.buffer;
+  double *x = buffer.x.data();
+  double *y = buffer.y.data();
+  double *z = buffer.z.data();
+
+  for (int l = chunk.begin; l < chunk.end; l++) {
+    const QString &line = chunk.parts->at(buffer.lineIndex[l]);
+    const QChar *p   = line.constData();
+    const QChar *end = p + line.size();
+    char  type = buffer.lineType[l];
+    int   v    = buffer.vertexBase[l];
+    bool  ok   = true;
+
+    skipBlanks(p,end);
+    p++;
+
+    buffer.color[l] = scanToken(p,end);
+    ok = buffer.color[l].size() > 0;
+
+    for (int n = 0; ok && n < vertexCount(type); n++) {
+      ok = scanNumber(p,end,x[v+n]) &&
+           scanNumber(p,end,y[v+n]) &&
+           scanNumber(p,end,z[v+n]);
+    }
+
+    if (ok && type == 1) {
+      int matrix = buffer.matrixBase[l];
+      for (int e = 0; ok && e < 9; e++) {
+        ok = scanNumber(p,end,buffer.m[e][matrix]);
+      }
+      skipBlanks(p,end);
+      buffer.name[l] = QString(p,int(end - p));
+      ok &= buffer.name[l].size() > 0;
+    }
+
+    if ( ! ok) {
+      buffer.lineType[l] = 0;
+      for (int n = 0; n < vertexCount(type); n++) {
+        x[v+n] = y[v+n] = z[v+n] = 0;
+      }
+    }
+  }
+}
+
+/*
+ * The kernels.  These work on every vertex/matrix, including those of
+ * unusable lines, which is harmless as they are never written back.
+ */
+
+static void rotateVertices(
+  double *x,
+  double *y,
+  double *z,
+  int     n,
+  double  rm[3][3])
+{
+  const double r00 = rm[0][0], r01 = rm[0][1], r02 = rm[0][2];
+  const double r10 = rm[1][0], r11 = rm[1][1], r12 = rm[1][2];
+  const double r20 = rm[2][0], r21 = rm[2][1], r22 = rm[2][2];
+
+  for (int i = 0; i < n; i++) {
+    double X = r00*x[i] + r01*y[i] + r02*z[i];
+    double Y = r10*x[i] + r11*y[i] + r12*z[i];
+    double Z = r20*x[i] + r21*y[i] + r22*z[i];
+    x[i] = X;
+    y[i] = Y;
+    z[i] = Z;
+  }
+}
+
+static void rotateMatrices(
+  QVector<double> m[9],
+  int             n,
+  double          rm[3][3])
+{
+  double *p[9];
+  for (int e = 0; e < 9; e++) {
+    p[e] = m[e].data();
+  }
+
+  for (int col = 0; col < 3; col++) {
+    double *c0 = p[col], *c1 = p[3+col], *c2 = p[6+col];
+    for (int i = 0; i < n; i++) {
+      double a = c0[i], b = c1[i], c = c2[i];
+      c0[i] = rm[0][0]*a + rm[0][1]*b + rm[0][2]*c;
+      c1[i] = rm[1][0]*a + rm[1][1]*b + rm[1][2]*c;
+      c2[i] = rm[2][0]*a + rm[2][1]*b + rm[2][2]*c;
+    }
+  }
+}
+
+static void extent(
+  const double *v,
+  const char   *valid,
+  int           n,
+  double       &min,
+  double       &max)
+{
+  double lo = 1e23, hi = -1e23;
+  for (int i = 0; i < n; i++) {
+    double t = valid[i] ? v[i] : lo;
+    lo = t < lo ? t : lo;
+    t  = valid[i] ? v[i] : hi;
+    hi = t > hi ? t : hi;
+  }
+  min = lo;
+  max = hi;
+}
+
+/*
+ * The box around each rotated part: the part's own box center goes through
+ * the part's matrix, and its half extents grow by the absolute value of the
+ * matrix.
+ */
+
+static void partExtent(
+  RotateBuffer &buffer,
+  const char   *valid,
+  int           d,
+  double       &min,
+  double       &max)
+{
+  const double *pos = d == 0 ? buffer.x.constData() :
+                      d == 1 ? buffer.y.constData() : buffer.z.constData();
+  const double *r0  = buffer.m[d*3].constData();
+  const double *r1  = buffer.m[d*3+1].constData();
+  const double *r2  = buffer.m[d*3+2].constData();
+  const double *c0  = buffer.boxCenter[0].constData();
+  const double *c1  = buffer.boxCenter[1].constData();
+  const double *c2  = buffer.boxCenter[2].constData();
+  const double *h0  = buffer.boxHalf[0].constData();
+  const double *h1  = buffer.boxHalf[1].constData();
+  const double *h2  = buffer.boxHalf[2].constData();
+  const int    *vertex = buffer.matrixVertex.constData();
+  int           n   = buffer.matrixVertex.size();
+
+  double lo = min, hi = max;
+  for (int i = 0; i < n; i++) {
+    double c = pos[vertex[i]] + r0[i]*c0[i] + r1[i]*c1[i] + r2[i]*c2[i];
+    double h = fabs(r0[i])*h0[i] + fabs(r1[i])*h1[i] + fabs(r2[i])*h2[i];
+    double t = valid[i] ? c - h : lo;
+    lo = t < lo ? t : lo;
+    t  = valid[i] ? c + h : hi;
+    hi = t > hi ? t : hi;
+  }
+  min = lo;
+  max = hi;
+}
+
+static void translate(
+  double *v,
+  int     n,
+  double  offset)
+{
+  for (int i = 0; i < n; i++) {
+    v[i] -= offset;
+  }
+}
+
+/*
+ * Pass three: put the LDraw text back together for a range of lines.
+ */
+
+static void formatChunk(RotateChunk &chunk)
+{
+  RotateBuffer &buffer = *chunk.buffer;
+  const double *x = buffer.x.constData();
+  const double *y = buffer.y.constData();
+  const double *z = buffer.z.constData();
+
+  char text[32*16];
+
+  for (int l = chunk.begin; l < chunk.end; l++) {
+    char type = buffer.lineType[l];
+    if (type == 0) {
+      continue;
+    }
+
+    int   v = buffer.vertexBase[l];
+    char *t = text;
+
+    for (int n = 0; n < vertexCount(type); n++) {
+      *t++ = ' ';
+      t = formatNumber(t,x[v+n]);
+      *t++ = ' ';
+      t = formatNumber(t,y[v+n]);
+      *t++ = ' ';
+      t = formatNumber(t,z[v+n]);
+    }
+    if (type == 1) {
+      int matrix = buffer.matrixBase[l];
+      for (int e = 0; e < 9; e++) {
+        *t++ = ' ';
+        t = formatNumber(t,buffer.m[e][matrix]);
+      }
+      *t++ = ' ';
+    }
+
+    QString &line = buffer.result[l];
+    line.reserve(int(t - text) + buffer.color[l].size() + buffer.name[l].size() + 2);
+    line += QChar('0' + type);
+    line += QChar(' ');
+    line += buffer.color[l];
+    line += QString::fromLatin1(text,int(t - text));
+    line += buffer.name[l];
+  }
+}
+
+static void runChunks(
+  const QStringList  &parts,
+        RotateBuffer &buffer,
+        void        (*work)(RotateChunk &))
+{
+  QList<RotateChunk> chunks;
+  int threads = QThread::idealThreadCount();
+
+  if (buffer.numLines < ROTATE_PARALLEL_LINES || threads < 2) {
+    RotateChunk chunk = { &buffer, &parts, 0, buffer.numLines };
+    work(chunk);
+    return;
+  }
+
+  int size = (buffer.numLines + threads*4 - 1)/(threads*4);
+  for (int begin = 0; begin < buffer.numLines; begin += size) {
+    RotateChunk chunk = { &buffer, &parts, begin, qMin(begin + size, buffer.numLines) };
+    chunks << chunk;
+  }
+  QtConcurrent::blockingMap(chunks,work);
+}
+
 int Render::rotateParts(
   const QString     &addLine,
         RotStepMeta &rotStep,
         QStringList &parts,
-        bool         defaultRot)
+        bool         defaultRot,
+        float       *size)
 {
-  double min[3], max[3];
-
-  min[0] = 1e23, max[0] = -1e23,
-  min[1] = 1e23, max[1] = -1e23,
-  min[2] = 1e23, max[2] = -1e23;
+  if (size) {
+    size[0] = size[1] = size[2] = 0;
+  }
 
   double defaultViewMatrix[3][3], defaultViewRots[3];
 
@@ -245,256 +735,86 @@ int Render::rotateParts(
     }
   }
 
-  // rotate all the parts
-
-  QString processed_parts;
-
-  for (int i = 0; i < parts.size(); i++) {
+  // convert the parts
 
-    QString line = parts[i];
-    QStringList tokens;
+  RotateBuffer buffer;
 
-    split(line,tokens);
+  classifyParts(parts,buffer);
 
-    if (tokens.size() < 2) {
-      continue;
-    }
+  if (buffer.numLines == 0) {
+    return 0;
+  }
 
-    double v[4][3];
+  runChunks(parts,buffer,parseChunk);
 
-    if (tokens[0] == "1") {
-      v[0][0] = tokens[2].toFloat();
-      v[0][1] = tokens[3].toFloat();
-      v[0][2] = tokens[4].toFloat();
+  int numVertices = buffer.x.size();
+  int numMatrices = buffer.m[0].size();
 
-      rotatePoint(v[0],rm);
+  // the real size of the parts, unusable lines get an empty box at the
+  // origin
 
+  for (int l = 0; l < buffer.numLines; l++) {
+    if (buffer.lineType[l] == 1) {
+      BoundingBox box;
+      PartGeometry::boundingBox(buffer.name[l],box);
+      int matrix = buffer.matrixBase[l];
       for (int d = 0; d < 3; d++) {
-        if (v[0][d] < min[d]) {
-          min[d] = v[0][d];
-        }
-        if (v[0][d] > max[d]) {
-          max[d] = v[0][d];
-        }
-      }
-    } else if (tokens[0] == "2") {
-      int c = 2;
-      for (int j = 0; j < 2; j++) {
-        v[j][0] = tokens[c].toDouble();
-        v[j][1] = tokens[c+1].toDouble();
-        v[j][2] = tokens[c+2].toDouble();
-        c += 3;
-        rotatePoint(v[j],rm);
-
-        for (int d = 0; d < 3; d++) {
-          if (v[j][d] < min[d]) {
-            min[d] = v[j][d];
-          }
-          if (v[j][d] > max[d]) {
-            max[d] = v[j][d];
-          }
-        }
-      }
-    } else if (tokens[0] == "3") {
-      int c = 2;
-      for (int j = 0; j < 3; j++) {
-        v[j][0] = tokens[c].toDouble();
-        v[j][1] = tokens[c+1].toDouble();
-        v[j][2] = tokens[c+2].toDouble();
-        c += 3;
-        rotatePoint(v[j],rm);
-
-        for (int d = 0; d < 3; d++) {
-          if (v[j][d] < min[d]) {
-            min[d] = v[j][d];
-          }
-          if (v[j][d] > max[d]) {
-            max[d] = v[j][d];
-          }
-        }
-      }
-    } else if (tokens[0] == "4") {
-      int c = 2;
-      for (int j = 0; j < 4; j++) {
-        v[j][0] = tokens[c].toDouble();
-        v[j][1] = tokens[c+1].toDouble();
-        v[j][2] = tokens[c+2].toDouble();
-        c += 3;
-        rotatePoint(v[j],rm);
-
-        for (int d = 0; d < 3; d++) {
-          if (v[j][d] < min[d]) {
-            min[d] = v[j][d];
-          }
-          if (v[j][d] > max[d]) {
-            max[d] = v[j][d];
-          }
-        }
-      }
-    } else if (tokens[0] == "5") {
-      int c = 2;
-      for (int j = 0; j < 4; j++) {
-        v[j][0] = tokens[c].toDouble();
-        v[j][1] = tokens[c+1].toDouble();
-        v[j][2] = tokens[c+2].toDouble();
-        c += 3;
-        rotatePoint(v[j],rm);
-
-        for (int d = 0; d < 3; d++) {
-          if (v[j][d] < min[d]) {
-            min[d] = v[j][d];
-          }
-          if (v[j][d] > max[d]) {
-            max[d] = v[j][d];
-          }
-        }
+        buffer.boxCenter[d][matrix] = box.center(d);
+        buffer.boxHalf[d][matrix]   = box.half(d);
       }
     }
   }
 
+  // rotate all the parts
+
+  rotateVertices(buffer.x.data(),buffer.y.data(),buffer.z.data(),numVertices,rm);
+  rotateMatrices(buffer.m,numMatrices,rm);
+
   // center the design at the LDraw origin
 
-  double center[3];
-  for (int d = 0; d < 3; d++) {
-    center[d] = (min[d] + max[d])/2;
+  QVector<char> valid(numVertices);
+  for (int l = 0; l < buffer.numLines; l++) {
+    char ok   = buffer.lineType[l] > 1;
+    int  next = l + 1 < buffer.numLines ? buffer.vertexBase[l+1] : numVertices;
+    for (int v = buffer.vertexBase[l]; v < next; v++) {
+      valid[v] = ok;
+    }
   }
 
-  for (int i = 0; i < parts.size(); i++) {
-    QString line = parts[i];
-    QStringList tokens;
+  double min[3], max[3];
 
-    split(line,tokens);
+  extent(buffer.x.constData(),valid.constData(),numVertices,min[0],max[0]);
+  extent(buffer.y.constData(),valid.constData(),numVertices,min[1],max[1]);
+  extent(buffer.z.constData(),valid.constData(),numVertices,min[2],max[2]);
 
-    if (tokens.size() < 2) {
-      continue;
+  QVector<char> validMatrix(numMatrices);
+  for (int l = 0; l < buffer.numLines; l++) {
+    if (buffer.matrixBase[l] >= 0) {
+      validMatrix[buffer.matrixBase[l]] = buffer.lineType[l] == 1;
     }
+  }
 
-    double v[4][3];
-    double pm[3][3];
-    QString t1;
-
-    if (tokens[0] == "1") {
-      int c = 2;
-      v[0][0] = tokens[c].toFloat();
-      v[0][1] = tokens[c+1].toFloat();
-      v[0][2] = tokens[c+2].toFloat();
-      c += 3;
-      for (int y = 0; y < 3; y++) {
-        for (int x = 0; x < 3; x++) {
-          pm[y][x] = tokens[c++].toDouble();
-        }
-      }
-      rotatePoint(v[0],rm);
-      v[0][0] -= center[0];
-      v[0][1] -= center[1];
-      v[0][2] -= center[2];
-      rotateMatrix(pm,rm);
-
-      t1 = QString("1 %1 "
-                   "%2 %3 %4 "
-                   "%5 %6 %7 "
-                   "%8 %9 %10 "
-                   "%11 %12 %13 "
-                   "%14")
-
-                   .arg(tokens[1])
-                   .arg( v[0][0]) .arg( v[0][1]) .arg( v[0][2])
-                   .arg(pm[0][0]) .arg(pm[0][1]) .arg(pm[0][2])
-                   .arg(pm[1][0]) .arg(pm[1][1]) .arg(pm[1][2])
-                   .arg(pm[2][0]) .arg(pm[2][1]) .arg(pm[2][2])
-                   .arg(tokens[tokens.size()-1]);
-
-      parts[i] = t1;
-    } else if (tokens[0] == "2") {
-
-      int c = 2;
-      for (int n = 0; n < 2; n++) {
-        for (int d = 0; d < 3; d++) {
-          v[n][d] = tokens[c++].toDouble();
-        }
-        rotatePoint(v[n],rm);
-        for (int d = 0; d < 3; d++) {
-          v[n][d] -= center[d];
-        }
-      }
+  for (int d = 0; d < 3; d++) {
+    partExtent(buffer,validMatrix.constData(),d,min[d],max[d]);
+  }
 
-      t1 = QString("2 %1 "
-                   "%2 %3 %4 "
-                   "%5 %6 %7")
-                   .arg(tokens[1])
-                   .arg( v[0][0]) .arg( v[0][1]) .arg( v[0][2])
-                   .arg( v[1][0]) .arg( v[1][1]) .arg( v[1][2]);
-      parts[i] = t1;
-    } else if (tokens[0] == "3") {
-
-      int c = 2;
-      for (int n = 0; n < 3; n++) {
-        for (int d = 0; d < 3; d++) {
-          v[n][d] = tokens[c++].toDouble();
-        }
-        rotatePoint(v[n],rm);
-        for (int d = 0; d < 3; d++) {
-          v[n][d] -= center[d];
-        }
-      }
+  if (size && min[0] <= max[0]) {
+    for (int d = 0; d < 3; d++) {
+      size[d] = max[d] - min[d];
+    }
+  }
 
-      t1 = QString("3 %1 "
-                   "%2 %3 %4  "
-                   "%5 %6 %7  "
-                   "%8 %9 %10")
-                     .arg(tokens[1])
-                     .arg( v[0][0]) .arg( v[0][1]) .arg( v[0][2])
-                     .arg( v[1][0]) .arg( v[1][1]) .arg( v[1][2])
-                     .arg( v[2][0]) .arg( v[2][1]) .arg( v[2][2]);
-      parts[i] = t1;
-    } else if (tokens[0] == "4") {
-
-      int c = 2;
-      for (int n = 0; n < 4; n++) {
-        for (int d = 0; d < 3; d++) {
-          v[n][d] = tokens[c++].toDouble();
-        }
-        rotatePoint(v[n],rm);
-        for (int d = 0; d < 3; d++) {
-          v[n][d] -= center[d];
-        }
-      }
+  translate(buffer.x.data(),numVertices,(min[0] + max[0])/2);
+  translate(buffer.y.data(),numVertices,(min[1] + max[1])/2);
+  translate(buffer.z.data(),numVertices,(min[2] + max[2])/2);
 
-      t1 = QString("4 %1 "
-                   "%2 %3 %4 "
-                   "%5 %6 %7 "
-                   "%8 %9 %10 "
-                   "%11 %12 %13")
-                     .arg(tokens[1])
-                     .arg( v[0][0]) .arg( v[0][1]) .arg( v[0][2])
-                     .arg( v[1][0]) .arg( v[1][1]) .arg( v[1][2])
-                     .arg( v[2][0]) .arg( v[2][1]) .arg( v[2][2])
-                     .arg( v[3][0]) .arg( v[3][1]) .arg( v[3][2]);
-      parts[i] = t1;
-    } else if (tokens[0] == "5") {
-
-      int c = 2;
-      for (int n = 0; n < 4; n++) {
-        for (int d = 0; d < 3; d++) {
-          v[n][d] = tokens[c++].toDouble();
-        }
-        rotatePoint(v[n],rm);
-        for (int d = 0; d < 3; d++) {
-          v[n][d] -= center[d];
-        }
-      }
+  // and back to LDraw
+
+  runChunks(parts,buffer,formatChunk);
 
-      t1 = QString("5 %1 "
-                   "%2 %3 %4 "
-                   "%5 %6 %7 "
-                   "%8 %9 %10 "
-                   "%11 %12 %13")
-                     .arg(tokens[1])
-                     .arg( v[0][0]) .arg( v[0][1]) .arg( v[0][2])
-                     .arg( v[1][0]) .arg( v[1][1]) .arg( v[1][2])
-                     .arg( v[2][0]) .arg( v[2][1]) .arg( v[2][2])
-                     .arg( v[3][0]) .arg( v[3][1]) .arg( v[3][2]);
-      parts[i] = t1;
+  for (int l = 0; l < buffer.numLines; l++) {
+    if (buffer.lineType[l]) {
+      parts[buffer.lineIndex[l]] = buffer.result[l];
     }
   }
   return 0;
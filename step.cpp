@@ -29,6 +29,7 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QFile>
+#include <QMessageBox>
 
 #include "lpub.h"
 #include "step.h"
@@ -47,6 +48,9 @@
 #include "dependencies.h"
 #include "paths.h"
 #include "ldrawfiles.h"
+#include "resample.h"
+#include "renderspool.h"
+#include "lmessagebox.h"
 
 /*********************************************************************
  *
@@ -170,12 +174,32 @@ int Step::createCsi(
                         .arg(modelScale);
   pngName = QDir::currentPath() + "/" +
                   Paths::assemDir + "/" + key + ".png";
-  QFile csi(pngName);
+
+  /*
+   * When resampling, the image is rendered once per step at the
+   * reference resolution, no matter the page size, resolution or scale,
+   * and pngName is made from that.
+   */
+
+  float factor;
+  bool  resample = ReferenceRender::use(meta,modelScale,factor);
+  QString renderName = pngName;
+
+  if (resample) {
+    QString refKey = QString("%1_%2_REF_%3")
+                       .arg(csiName()+orient)
+                       .arg(sn)
+                       .arg(meta.LPub.renderCache.resolution.value());
+    renderName = QDir::currentPath() + "/" +
+                   Paths::assemDir + "/" + refKey + ".png";
+  }
+
+  QFile csi(renderName);
 
   bool outOfDate = false;
   
   if (csi.exists()) {
-    QDateTime lastModified = QFileInfo(pngName).lastModified();
+    QDateTime lastModified = QFileInfo(renderName).lastModified();
     QStringList stack = submodelStack();
     stack << parent->modelName();
     if ( ! isOlder(stack,lastModified)) {
@@ -187,14 +211,34 @@ int Step::createCsi(
 
     int        rc;
 
-    // render the partially assembled model
+    // render the partially assembled model, at the reference resolution
+    // when resampling
 
-    rc = renderer->renderCsi(addLine,csiParts, pngName, meta);
+    {
+      ReferenceRender reference(meta,meta.LPub.assem.modelScale,resample);
+      rc = renderer->renderCsi(addLine,csiParts, renderName, meta);
+    }
 
     if (rc < 0) {
       return rc;
     }
+
+    // the image shows up once a render worker gets to it
+
+    if (rc == RenderSpool::Queued) {
+      return 0;
+    }
   } 
+
+  if (resample && isStale(pngName,renderName)) {
+    if ( ! resampleImage(renderName,pngName,factor)) {
+      LMessageBox::warning(NULL,QMessageBox::tr(LPUB),
+                           QMessageBox::tr("Failed to resample %1")
+                           .arg(renderName));
+      return -1;
+    }
+  }
+
   pixmap->load(pngName);
   csiPlacement.size[0] = pixmap->width();
   csiPlacement.size[1] = pixmap->height();
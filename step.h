@@ -37,6 +37,7 @@
 #include "meta.h"
 #include "csiitem.h"
 #include "callout.h"
+#include "pagearena.h"
 
 class Meta;
 class Callout;
@@ -46,6 +47,8 @@ enum PlacementType;
 class Step : public AbstractRangeElement
 {
   public: 
+    PAGE_ARENA_ALLOCATED
+
     bool              calledOut;
     QList<Callout *>  list;
     Pli               pli;
@@ -43,6 +43,8 @@
 #include "reserve.h"
 #include "step.h"
 #include "paths.h"
+#include "geometry.h"
+#include "lmessagebox.h"
 
 /*********************************************
  *
@@ -962,7 +964,7 @@ int Gui::drawPage(
         break;
         case RangeErrorRc:
           showLine(current);
-          QMessageBox::critical(NULL,
+          LMessageBox::critical(NULL,
                                QMessageBox::tr("LPub"),
                                QMessageBox::tr("Parameter(s) out of range: %1:%2\n%3")
                                .arg(current.modelName) 
@@ -975,7 +977,7 @@ int Gui::drawPage(
       }
     } else if (line != "") {
       showLine(current);
-      QMessageBox::critical(NULL,
+      LMessageBox::critical(NULL,
                             QMessageBox::tr("LPub"),
                             QMessageBox::tr("Invalid LDraw Line Type: %1:%2\n  %3")
                             .arg(current.modelName) 
@@ -1571,23 +1573,24 @@ int Gui::getBOMParts(
   return 0;
 }
 
-void Gui::attitudeAdjustment()
+void Gui::attitudeAdjustment(LDrawFile &file)
 {
   Meta meta;
   bool callout = false;
-  int numFiles = ldrawFile.subFileOrder().size();
+  int numFiles = file.subFileOrder().size();
   
   for (int i = 0; i < numFiles; i++) {
-    QString fileName = ldrawFile.subFileOrder()[i];
-    int numLines     = ldrawFile.size(fileName);
+    QString fileName = file.subFileOrder()[i];
+    int numLines     = file.size(fileName);
     
     QStringList pending;
+    LDrawEdits  edits(fileName);
     
     for (Where current(fileName,0);
       current.lineNumber < numLines;
       current.lineNumber++) {
 
-      QString line = ldrawFile.readLine(current.modelName,current.lineNumber);
+      QString line = file.readLine(current.modelName,current.lineNumber);
       QStringList argv;
       split(line,argv);
       
@@ -1600,10 +1603,8 @@ void Gui::attitudeAdjustment()
           pending.clear();
         } else if (argv[3] == "END") {
           callout = false;
-          for (int i = 0; i < pending.size(); i++) {
-            ldrawFile.insertLine(current.modelName,current.lineNumber, pending[i]);
-            ++numLines;
-            ++current;
+          for (int p = 0; p < pending.size(); p++) {
+            edits.insertLine(current.lineNumber, pending[p]);
           }
           pending.clear();
         } else if (argv[3] == "ALLOC" || 
@@ -1612,14 +1613,13 @@ void Gui::attitudeAdjustment()
                    argv[3] == "MARGINS" || 
                    argv[3] == "PLACEMENT") {
           if (callout && argv.size() >= 5 && argv[4] != "GLOBAL") {
-            ldrawFile.deleteLine(current.modelName,current.lineNumber);
+            edits.deleteLine(current.lineNumber);
             pending << line;
-            --numLines;
-            --current;
           }
         }
       }
     }
+    file.edit(edits);
   }
 }
 
@@ -1726,7 +1726,7 @@ void Gui::include(Meta &meta)
     if (fileInfo.exists()) {
       QFile file(fileName);
       if ( ! file.open(QFile::ReadOnly | QFile::Text)) {
-        QMessageBox::warning(NULL, 
+        LMessageBox::warning(NULL, 
                              QMessageBox::tr(LPUB),
                              QMessageBox::tr("Cannot read file %1:\n%2.")
                              .arg(fileName)
@@ -1786,7 +1786,7 @@ void Gui::writeToTmp(
   QString fname = QDir::currentPath() + "/" + Paths::tmpDir + "/" + fileName;
   QFile file(fname);
   if ( ! file.open(QFile::WriteOnly|QFile::Text)) {
-    QMessageBox::warning(NULL,QMessageBox::tr("LPub"),
+    LMessageBox::warning(NULL,QMessageBox::tr("LPub"),
     QMessageBox::tr("Failed to open %1 for writing: %2")
       .arg(fname) .arg(file.errorString()));
   } else {
@@ -1847,15 +1847,18 @@ void Gui::writeToTmp(
     }
     file.close();
   }
+
+  // the submodel (and whatever uses it) may have changed size
+
+  PartGeometry::clearModels();
 }
 
 void Gui::writeToTmp()
 {
   for (int i = 0; i < ldrawFile._subFileOrder.size(); i++) {
     QString fileName = ldrawFile._subFileOrder[i].toLower();
-    QStringList c = ldrawFile.contents(fileName);
     if (ldrawFile.changedSinceLastWrite(fileName)) {
-      writeToTmp(fileName,c);
+      writeToTmp(fileName,ldrawFile.contents(fileName));
     }
   }
 }
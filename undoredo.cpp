@@ -14,6 +14,8 @@
 **
 ****************************************************************************/
 
+#include <QTimer>
+
 #include "lpub.h"
 #include "commands.h"
 
@@ -52,6 +54,13 @@ void Gui::deleteLine(const Where &here, QUndoCommand *parent)
     undoStack->push(new DeleteLineCommand(&ldrawFile,here,parent));
   }
 }
+void Gui::editLines(const LDrawEdits &edits, QUndoCommand *parent)
+{
+  if ( ! edits.isEmpty() && ldrawFile.contains(edits.fileName())) {
+    undoStack->push(new EditLinesCommand(&ldrawFile,edits,parent));
+  }
+}
+
 QString Gui::readLine(const Where &here)
 {
   return ldrawFile.readLine(here.modelName,here.lineNumber);
@@ -67,6 +76,36 @@ void Gui::endMacro()
 {
   undoStack->endMacro();
   --macroNesting;
+  redrawLater();
+}
+
+void Gui::redrawLater()
+{
+  redrawTimer->start(0);
+}
+
+void Gui::redrawLater(const Where &here)
+{
+  redrawLine     = here;
+  redrawShowLine = true;
+  redrawTimer->start(0);
+}
+
+void Gui::redrawNow()
+{
+  /*
+   * A dialog opened in the middle of a macro runs the event loop, so we
+   * can get here before the macro is done.  endMacro asks again.
+   */
+
+  if (macroNesting > 0) {
+    return;
+  }
+
+  if (redrawShowLine) {
+    redrawShowLine = false;
+    showLine(redrawLine);
+  }
   displayPage();
 }
 
@@ -81,10 +120,7 @@ void Gui::contentsChange(
   /* Calculate the characters removed from the LDrawFile */
 
   if (_charsRemoved && ldrawFile.contains(fileName)) {
-
-    QString contents = ldrawFile.contents(fileName).join("\n");
-
-    charsRemoved = contents.mid(position,_charsRemoved);
+    charsRemoved = ldrawFile.readChars(fileName,position,_charsRemoved);
   }
   
   undoStack->push(new ContentsChangeCommand(&ldrawFile,
@@ -96,18 +132,12 @@ void Gui::contentsChange(
 
 void Gui::undo()
 {
-  macroNesting++;
   undoStack->undo();
-  macroNesting--;
-  displayPage();
 }
 
 void Gui::redo()
 {
-  macroNesting++;
   undoStack->redo();
-  macroNesting--;
-  displayPage();
 }
 
 void Gui::canRedoChanged(bool enabled)